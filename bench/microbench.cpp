@@ -0,0 +1,508 @@
+// microbench.cpp
+/**\file
+ * ss_microbench: costs of session internals in isolation. Sessions are run
+ * on in-process pair of unix sockets by single thread, so results doesn't
+ * depend on network stack and scheduling of threads.
+ */
+
+#include "EchoHandler.hpp"
+#include "RequestBuffer.hpp"
+#include "ResponseCache.hpp"
+#include "Session.hpp"
+#include "StreamCodec.hpp"
+#include "ss/Client.hpp"
+#include "ss/Hpack.hpp"
+#include "ss/HttpParser.hpp"
+#include "ss/WebSocketHandler.hpp"
+#include <benchmark/benchmark.h>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <unistd.h>
+
+namespace asio   = boost::asio;
+using Protocol   = asio::local::stream_protocol;
+using Socket     = asio::basic_stream_socket<Protocol>;
+using SessionPtr = std::shared_ptr<ss::Session<Protocol>>;
+
+using ss::test::EchoFactory;
+using ss::test::LineEchoHandler;
+
+
+/**\brief session, connected to client socket in the same process
+ */
+struct SessionPair {
+  explicit SessionPair(ss::SessionOptions     options = ss::SessionOptions{},
+                       ss::MiddlewareChainPtr middleware = nullptr)
+      : client{ioContext} {
+    Socket server{ioContext};
+    asio::local::connect_pair(client, server);
+
+    session = std::make_shared<ss::Session<Protocol>>(
+        std::move(server),
+        std::make_shared<LineEchoHandler>(),
+        options,
+        ss::SocketOptions{});
+    session->setMiddleware(std::move(middleware));
+    session->start();
+  }
+
+  ~SessionPair() {
+    session->close();
+    ioContext.run();
+  }
+
+  /**\brief send request and run the session until whole response is
+   * received
+   */
+  void roundTrip(std::string_view request, size_t responseSize) {
+    asio::write(client, asio::buffer(request));
+    while (client.available() < responseSize) {
+      ioContext.run_one();
+    }
+
+    response.resize(responseSize);
+    asio::read(client, asio::buffer(response));
+  }
+
+  asio::io_context ioContext{1};
+  Socket           client;
+  SessionPtr       session;
+  std::string      response;
+};
+
+
+/**\brief read, handling and write of single request
+ */
+static void BM_RoundTrip(benchmark::State &state) {
+  SessionPair pair;
+  std::string request(state.range(0) - 1, 'x');
+  request.push_back('\n');
+
+  for (auto _ : state) {
+    pair.roundTrip(request, request.size());
+  }
+
+  state.SetBytesProcessed(state.iterations() * request.size());
+}
+BENCHMARK(BM_RoundTrip)->Arg(16)->Arg(1024)->Arg(64 * 1024);
+
+/**\brief many requests in one read: cost of handler dispatch and of
+ * consuming of the request buffer
+ */
+static void BM_PipelinedRequests(benchmark::State &state) {
+  SessionPair pair;
+  std::string request;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    request += "0123456789abcdef0123456789abcde\n";
+  }
+
+  for (auto _ : state) {
+    pair.roundTrip(request, request.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PipelinedRequests)->Arg(1)->Arg(16)->Arg(128);
+
+/**\brief request, splitted to several reads, so handler returns PartialData
+ * for every read except last
+ */
+static void BM_PartialRequest(benchmark::State &state) {
+  SessionPair pair;
+  size_t      parts = state.range(0);
+  std::string part(64, 'x');
+
+  for (auto _ : state) {
+    for (size_t i = 0; i + 1 < parts; ++i) {
+      asio::write(pair.client, asio::buffer(part));
+      pair.ioContext.poll();
+    }
+    pair.roundTrip("\n", part.size() * (parts - 1) + 1);
+  }
+
+  state.SetItemsProcessed(state.iterations() * parts);
+}
+BENCHMARK(BM_PartialRequest)->Arg(2)->Arg(8)->Arg(64);
+
+/**\brief direct virtual call of the handler, without session
+ */
+static void BM_HandlerDispatch(benchmark::State &state) {
+  ss::RequestHandler handler = std::make_shared<LineEchoHandler>();
+  std::string        request = "0123456789abcdef0123456789abcde\n";
+  std::string        response;
+
+  for (auto _ : state) {
+    size_t reqIgnoreLength = 0;
+    benchmark::DoNotOptimize(
+        handler->handle(request, std::back_inserter(response), reqIgnoreLength));
+    response.clear();
+  }
+}
+BENCHMARK(BM_HandlerDispatch);
+
+/**\brief read cycle of request buffer: prepare, commit and consume of
+ * requests, which leave partial tail in the buffer, so the buffer must be
+ * compacted time after time
+ */
+static void BM_RequestBufferCycle(benchmark::State &state) {
+  ss::RequestBuffer buffer;
+  size_t            readSize    = state.range(0);
+  size_t            consumeSize = readSize - readSize / 8;
+
+  for (auto _ : state) {
+    asio::mutable_buffer space = buffer.prepare();
+    size_t               readed = std::min(readSize, space.size());
+    std::memset(space.data(), 'x', readed);
+    buffer.commit(readed);
+
+    while (buffer.size() >= consumeSize) {
+      buffer.consume(consumeSize);
+    }
+    benchmark::DoNotOptimize(buffer.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * readSize);
+}
+BENCHMARK(BM_RequestBufferCycle)->Arg(64)->Arg(4 * 1024)->Arg(64 * 1024);
+
+/**\brief post of handler to a strand and its execution
+ */
+static void BM_StrandHop(benchmark::State &state) {
+  asio::io_context                              ioContext{1};
+  asio::strand<asio::io_context::executor_type> strand{
+      ioContext.get_executor()};
+  size_t                                        counter = 0;
+
+  for (auto _ : state) {
+    asio::post(strand, [&counter]() {
+      ++counter;
+    });
+    ioContext.run_one();
+  }
+
+  benchmark::DoNotOptimize(counter);
+}
+BENCHMARK(BM_StrandHop);
+
+/**\brief construction, start and close of session
+ */
+static void BM_SessionLifetime(benchmark::State &state) {
+  for (auto _ : state) {
+    SessionPair pair;
+    benchmark::DoNotOptimize(pair.session.get());
+  }
+}
+BENCHMARK(BM_SessionLifetime);
+
+/**\brief message, pushed to the session from the same thread
+ */
+static void BM_Push(benchmark::State &state) {
+  SessionPair pair;
+  std::string message(state.range(0) - 1, 'x');
+  message.push_back('\n');
+
+  for (auto _ : state) {
+    pair.session->push(message);
+    while (pair.client.available() < message.size()) {
+      pair.ioContext.run_one();
+    }
+    pair.response.resize(message.size());
+    asio::read(pair.client, asio::buffer(pair.response));
+  }
+
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+BENCHMARK(BM_Push)->Arg(16)->Arg(64 * 1024);
+
+/**\brief parsing of typical HTTP request, readed by one read and by parts
+ * of the size
+ */
+static void BM_HttpParse(benchmark::State &state) {
+  std::string_view request = "GET /api/v1/items?id=42 HTTP/1.1\r\n"
+                             "Host: example.com\r\n"
+                             "User-Agent: microbench\r\n"
+                             "Accept: */*\r\n"
+                             "Accept-Encoding: gzip, deflate\r\n"
+                             "Connection: keep-alive\r\n"
+                             "\r\n";
+  size_t partSize = state.range(0) == 0 ? request.size() : state.range(0);
+
+  ss::http::RequestParser parser;
+  ss::http::Request       parsed;
+  for (auto _ : state) {
+    for (size_t size = partSize;; size += partSize) {
+      ss::http::ParseStatus status =
+          parser.parse(request.substr(0, size), parsed);
+      if (status != ss::http::ParseStatus::Partial) {
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(parsed.headersCount);
+    parser.reset();
+  }
+
+  state.SetBytesProcessed(state.iterations() * request.size());
+}
+BENCHMARK(BM_HttpParse)->Arg(0)->Arg(16);
+
+/**\brief unmasking of websocket payload
+ */
+static void BM_WebSocketUnmask(benchmark::State &state) {
+  std::string src(state.range(0), 'x');
+  std::string dst(state.range(0), '\0');
+  const char  mask[4] = {0x12, 0x34, 0x56, 0x78};
+
+  for (auto _ : state) {
+    ss::ws::unmask(dst.data(), src.data(), src.size(), mask);
+    benchmark::DoNotOptimize(dst.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_WebSocketUnmask)->Arg(125)->Arg(64 * 1024);
+
+/**\brief decoding of typical HTTP/2 request headers
+ */
+static void BM_HpackDecode(benchmark::State &state) {
+  std::string block;
+  ss::hpack::encodeHeader(block, ":method", "GET");
+  ss::hpack::encodeHeader(block, ":scheme", "http");
+  ss::hpack::encodeHeader(block, ":path", "/api/v1/items?id=42");
+  ss::hpack::encodeHeader(block, ":authority", "example.com");
+  ss::hpack::encodeHeader(block, "user-agent", "microbench");
+  ss::hpack::encodeHeader(block, "accept", "*/*");
+  ss::hpack::encodeHeader(block, "accept-encoding", "gzip, deflate");
+
+  ss::hpack::Decoder    decoder;
+  ss::hpack::HeaderList headers;
+  for (auto _ : state) {
+    headers.clear();
+    decoder.decode(block, headers);
+    benchmark::DoNotOptimize(headers.size());
+  }
+
+  state.SetBytesProcessed(state.iterations() * block.size());
+}
+BENCHMARK(BM_HpackDecode);
+
+#ifdef SS_HAS_ZLIB
+/**\brief compression of typical JSON response by persistent session codec,
+ * with sync flush as at every write
+ */
+static void BM_StreamCompress(benchmark::State &state) {
+  std::string response;
+  for (int i = 0; i < 16; ++i) {
+    response += R"({"id":)" + std::to_string(i) +
+                R"(,"name":"item","tags":["a","b"],"price":12.5})";
+  }
+
+  ss::CompressionOptions options;
+  options.level = state.range(0);
+
+  ss::StreamCodec codec{std::make_shared<ss::CompressionContext>(options)};
+  std::string     output;
+  for (auto _ : state) {
+    output.clear();
+    codec.compress(response, output, true);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * response.size());
+}
+BENCHMARK(BM_StreamCompress)->Arg(1)->Arg(6);
+#endif
+
+
+/**\brief concurrent lookups of hot responses, arg is count of shards
+ */
+static void BM_ResponseCacheFind(benchmark::State &state) {
+  static ss::ResponseCachePtr cache;
+  if (state.thread_index() == 0) {
+    ss::ResponseCacheOptions options;
+    options.shards = state.range(0);
+
+    cache = std::make_shared<ss::ResponseCache>(options);
+    for (int i = 0; i < 64; ++i) {
+      cache->insert("GET /item/" + std::to_string(i),
+                    std::make_shared<const std::string>(256, 'r'));
+    }
+  }
+
+  std::string request = "GET /item/" + std::to_string(state.thread_index());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache->find(request));
+  }
+
+  if (state.thread_index() == 0) {
+    cache.reset();
+  }
+}
+BENCHMARK(BM_ResponseCacheFind)->Arg(1)->Arg(16)->ThreadRange(1, 8);
+
+
+/**\brief pipelined requests of the client to the server in the same process
+ * by single thread, arg is count of requests in flight
+ */
+static void BM_ClientPipelined(benchmark::State &state) {
+  std::string path =
+      "/tmp/ss_microbench_" + std::to_string(::getpid()) + ".sock";
+  ::unlink(path.c_str());
+
+  asio::io_context          ioContext{1};
+  ss::RequestHandlerFactory factory = std::make_shared<EchoFactory>();
+
+  ss::ServerPtr server = ss::ServerBuilder{ioContext}
+                             .setEndpoint(ss::Server::Protocol::Unix, path)
+                             .setRequestHandlerFactory(factory)
+                             .build();
+  server->asyncRun();
+
+  ss::ClientPtr client = ss::ClientBuilder{ioContext}
+                             .setEndpoint(ss::Server::Protocol::Unix, path)
+                             .setResponseHandlerFactory(factory)
+                             .setMaxInFlight(state.range(0))
+                             .build();
+  client->asyncConnect();
+
+  std::string request   = "0123456789abcdef0123456789abcde\n";
+  int64_t     responses = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      client->asyncRequest(request, [&responses](ss::error_code, auto) {
+        ++responses;
+      });
+    }
+
+    while (responses < state.range(0)) {
+      ioContext.run_one();
+    }
+    responses = 0;
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+
+  client->close();
+  server->stop();
+  ioContext.run();
+  ::unlink(path.c_str());
+}
+BENCHMARK(BM_ClientPipelined)->Arg(1)->Arg(16)->Arg(128);
+
+
+/**\brief middlewares, which are typical for the chain: check of the
+ * request, counters and timing
+ */
+struct CheckMiddleware : ss::Middleware {
+  bool before(ss::RequestContext &context, State &) noexcept {
+    return context.request.empty() == false && context.request[0] != '!';
+  }
+};
+
+struct CountMiddleware : ss::Middleware {
+  void after(ss::RequestContext &context, State &) noexcept {
+    ++requests;
+    bytes += context.response.size();
+  }
+
+  size_t requests = 0;
+  size_t bytes    = 0;
+};
+
+struct TimingMiddleware : ss::Middleware {
+  struct State {
+    std::chrono::steady_clock::time_point start;
+  };
+
+  bool before(ss::RequestContext &, State &state) noexcept {
+    state.start = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  void after(ss::RequestContext &, State &state) noexcept {
+    total += std::chrono::steady_clock::now() - state.start;
+  }
+
+  std::chrono::steady_clock::duration total{};
+};
+
+/**\brief pipelined requests through the chain of middlewares, arg is count
+ * of middlewares (0 or 3)
+ */
+static void BM_MiddlewareChain(benchmark::State &state) {
+  ss::MiddlewareChainPtr middleware;
+  if (state.range(0) != 0) {
+    middleware = ss::makeMiddlewareChain(CheckMiddleware{},
+                                         CountMiddleware{},
+                                         TimingMiddleware{});
+  }
+
+  SessionPair pair{ss::SessionOptions{}, std::move(middleware)};
+  std::string request;
+  for (int i = 0; i < 16; ++i) {
+    request += "0123456789abcdef0123456789abcde\n";
+  }
+
+  for (auto _ : state) {
+    pair.roundTrip(request, request.size());
+  }
+
+  state.SetItemsProcessed(state.iterations() * 16);
+}
+BENCHMARK(BM_MiddlewareChain)->Arg(0)->Arg(3);
+
+
+/**\brief new connection with one request for every iteration, arg is 1 if
+ * protocol of connections is detected. Detection time is reported by counter
+ */
+static void BM_ProtocolDetection(benchmark::State &state) {
+  std::string path =
+      "/tmp/ss_microbench_" + std::to_string(::getpid()) + ".sock";
+  ::unlink(path.c_str());
+
+  asio::io_context          ioContext{1};
+  ss::RequestHandlerFactory factory = std::make_shared<EchoFactory>();
+
+  ss::ServerBuilder builder{ioContext};
+  builder.setEndpoint(ss::Server::Protocol::Unix, path)
+      .setRequestHandlerFactory(factory);
+  if (state.range(0) != 0) {
+    builder.addProtocol("\x16\x03", factory)
+        .addProtocol("GET ", factory)
+        .addProtocol("POST ", factory);
+  }
+
+  ss::ServerPtr server = builder.build();
+  server->asyncRun();
+
+  std::string request = "GET /0123456789abcdef0123456789\n";
+  std::string response(request.size(), '\0');
+  for (auto _ : state) {
+    Socket client{ioContext};
+    client.connect(Protocol::endpoint{path});
+    asio::write(client, asio::buffer(request));
+    while (client.available() < response.size()) {
+      ioContext.run_one();
+    }
+
+    asio::read(client, asio::buffer(response));
+  }
+
+  ss::ProtocolDetectionStats stats = server->protocolDetectionStats();
+  state.counters["detection_ns"]     = stats.averageTime().count();
+  state.counters["max_detection_ns"] = stats.maxTime.count();
+  state.SetItemsProcessed(state.iterations());
+
+  server->stop();
+  ioContext.run();
+  ::unlink(path.c_str());
+}
+BENCHMARK(BM_ProtocolDetection)->Arg(0)->Arg(1);
+
+
+// logger has no sinks here, so logs of sessions are dropped
+BENCHMARK_MAIN();
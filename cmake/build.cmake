@@ -31,6 +31,8 @@ set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/lib")
 option(leak_check "set leak_check" 0)
 option(profiling "set profiling" 0)
 option(thread_check "set thread_check" 0)
+option(use_coroutines "use C++20 coroutines instead of stackless asio::coroutine" 0)
+option(usdt_probes "set usdt_probes" 0)
 
 if(${CMAKE_BUILD_TYPE} STREQUAL Debug AND leak_check)
   set(CMAKE_CXX_FLAGS_DEBUG "${CMAKE_CXX_FLAGS_DEBUG} -fsanitize=address -fno-omit-frame-pointer")
@@ -62,3 +64,5 @@ message(STATUS "build shared     " ${BUILD_SHARED_LIBS})
 message(STATUS "leak   sanitizer " ${leak_check})
 message(STATUS "thread sanitizer " ${thread_check})
 message(STATUS "profiling        " ${profiling})
+message(STATUS "coroutines       " ${use_coroutines})
+message(STATUS "usdt probes      " ${usdt_probes})
@@ -2,11 +2,33 @@
 
 #pragma once
 
+#include "ss/SessionHandle.hpp"
 #include "ss/errors.hpp"
 #include <memory>
 
 namespace ss {
+class AbstractRequestHandlerFactory;
+
+/**\brief base class for state, which is shared between handlers, but should
+ * not be locked. Every I/O thread has its own instance of the context for
+ * every factory
+ * \see AbstractRequestHandlerFactory::makeThreadContext
+ */
+class AbstractThreadContext {
+public:
+  virtual ~AbstractThreadContext() = default;
+};
+
+using ThreadContext = std::unique_ptr<AbstractThreadContext>;
+
 class AbstractRequestHandler {
+  template <typename Protocol>
+  friend class Session;
+  template <typename Protocol>
+  friend class ServerImplStream;
+  template <typename Protocol>
+  friend class ClientConnection;
+
 public:
   using ResponseInserter = std::back_insert_iterator<std::string>;
 
@@ -22,6 +44,20 @@ public:
 
   virtual void atSessionClose() noexcept {};
 
+  /**\brief called when count of not writed bytes of the session reaches high
+   * watermark. After that the session doesn't read new requests until
+   * `atLowWatermark`. Pushed messages are still accepted (up to
+   * SessionOptions::pushQueueLimit), so it is a good place for stop producing
+   * them
+   * \see SessionOptions::highWatermark
+   */
+  virtual void atHighWatermark() noexcept {};
+
+  /**\brief called when count of not writed bytes of the session falls to low
+   * watermark after `atHighWatermark`, and the session continue reading
+   */
+  virtual void atLowWatermark() noexcept {};
+
   /**\brief handle request and produce responce
    * \param reqIgnoreLength by default is 0. If 0, then request buffer will be
    * completely cleared, otherwise will be cleared directly n-bytes in request
@@ -34,14 +70,94 @@ public:
   virtual ss::error_code handle(std::string_view requestBuffer,
                                 ResponseInserter respIter,
                                 size_t &         reqIgnoreLength) noexcept = 0;
+
+  /**\brief opt-in for response cache, called before `handle` only if the
+   * server has the cache. If the response is found in the cache, then it is
+   * written instead of calling `handle`. Otherwise response, produced by
+   * `handle` for exactly this request, is inserted to the cache
+   * \return size of first request in the buffer, if it is complete and its
+   * response depends only on bytes of the request. 0 (default) means, that
+   * the request is not cacheable
+   * \see ServerBuilder::setResponseCache
+   */
+  virtual size_t cacheableRequestSize(
+      [[maybe_unused]] std::string_view requestBuffer) noexcept {
+    return 0;
+  }
+
+protected:
+  /**\brief handle of session, which uses the handler. Valid since
+   * `atSessionStart`, can be copied and used from other threads for sending
+   * messages to the client without request
+   */
+  const SessionHandle &sessionHandle() const noexcept {
+    return sessionHandle_;
+  }
+
+  /**\brief request write of all produced responses right after handling, even
+   * if write coalescing is enabled. Has sense only inside `handle`
+   */
+  void flush() noexcept {
+    flushRequested_ = true;
+  }
+
+  /**\brief close the session after all produced responses are written.
+   * Next requests are not readed anymore, so the handler must not produce
+   * responses for rest of the request buffer. Has sense only inside `handle`
+   */
+  void closeAfterWrite() noexcept {
+    closeRequested_ = true;
+  }
+
+  /**\brief context of current thread, created by factory of the handler.
+   * Can be used without locks, but only inside of the handler callbacks and
+   * only until the callback returns: next callback can be called from other
+   * thread, so the pointer must not be saved
+   * \return nullptr if the factory doesn't create thread contexts
+   */
+  template <typename Context = AbstractThreadContext>
+  Context *threadContext() const noexcept {
+    return static_cast<Context *>(this->currentThreadContext());
+  }
+
+private:
+  AbstractThreadContext *currentThreadContext() const noexcept;
+
+private:
+  SessionHandle                                  sessionHandle_;
+  bool                                           flushRequested_ = false;
+  bool                                           closeRequested_ = false;
+  std::shared_ptr<AbstractRequestHandlerFactory> factory_;
 };
 
 using RequestHandler = std::shared_ptr<AbstractRequestHandler>;
 
 class AbstractRequestHandlerFactory {
 public:
+  AbstractRequestHandlerFactory() noexcept;
+  AbstractRequestHandlerFactory(const AbstractRequestHandlerFactory &) noexcept;
+  AbstractRequestHandlerFactory &
+  operator=(const AbstractRequestHandlerFactory &) noexcept;
+
   virtual ~AbstractRequestHandlerFactory()             = default;
   virtual RequestHandler makeRequestHandler() noexcept = 0;
+
+  /**\brief called once for every thread, which calls handlers of the factory,
+   * at first access to the context from the thread. The context is destroyed
+   * at exit of the thread
+   * \return nullptr by default, so handlers have no thread context
+   */
+  virtual ThreadContext makeThreadContext() noexcept {
+    return nullptr;
+  }
+
+  /**\return context of current thread for the factory. Creates it, if
+   * needed
+   */
+  AbstractThreadContext *threadContext() noexcept;
+
+private:
+  size_t id_;
 };
 
 using RequestHandlerFactory = std::shared_ptr<AbstractRequestHandlerFactory>;
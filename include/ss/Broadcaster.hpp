@@ -0,0 +1,74 @@
+// Broadcaster.hpp
+
+#pragma once
+
+#include "ss/SessionHandle.hpp"
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace ss {
+/**\brief what to do with a subscriber, which doesn't read messages fast
+ * enough, so count of its not writed bytes reaches
+ * SessionOptions::pushQueueLimit
+ */
+enum class SlowConsumerPolicy {
+  Drop,           // skip new messages while the queue is full
+  CoalesceLatest, // keep only latest not writed message of the topic
+  Disconnect,     // close the session
+};
+
+/**\brief topic based fan-out of messages to sessions. Every message is
+ * serialized once to SharedBuffer and queued to all subscribers without
+ * copying
+ * \note thread-safe
+ */
+class Broadcaster {
+public:
+  /**\brief subscribe the session to the topic. Closed sessions are
+   * unsubscribed automatically
+   */
+  void subscribe(std::string_view   topic,
+                 SessionHandle      session,
+                 SlowConsumerPolicy policy = SlowConsumerPolicy::Drop);
+
+  void unsubscribe(std::string_view topic, const SessionHandle &session);
+
+  /**\brief unsubscribe the session from all topics
+   */
+  void unsubscribe(const SessionHandle &session);
+
+  /**\return count of sessions, to which the message was queued
+   */
+  size_t publish(std::string_view topic, SharedBuffer message);
+
+  size_t publish(std::string_view topic, std::string message);
+
+  size_t subscribersCount(std::string_view topic) const;
+
+private:
+  struct Subscriber {
+    SessionHandle      session;
+    SlowConsumerPolicy policy;
+  };
+
+  /**\brief id is used as coalesce key. Ids are not reused, so messages of
+   * erased topic can not be replaced by messages of new one
+   */
+  struct Topic {
+    uint64_t                id = 0;
+    std::vector<Subscriber> subscribers;
+  };
+
+  void removeClosedSubscribers(std::string_view topic);
+
+private:
+  mutable std::shared_mutex                 mutex_;
+  std::map<std::string, Topic, std::less<>> topics_;
+  uint64_t                                  lastTopicId_ = 0;
+};
+
+using BroadcasterPtr = std::shared_ptr<Broadcaster>;
+} // namespace ss
@@ -0,0 +1,167 @@
+// Client.hpp
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include "ss/Server.hpp"
+#include "ss/SocketOptions.hpp"
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace ss {
+namespace asio = boost::asio;
+
+class ClientBuilder;
+class ClientImpl;
+
+/**\brief options of every connection of a client
+ */
+struct ClientOptions {
+  /**\brief count of connections in the pool. Every request is sent by the
+   * connection with the least count of requests in flight
+   */
+  size_t connections = 1;
+
+  /**\brief max count of requests of one connection, which are sent (or
+   * queued for sending), but not responded yet. Requests are pipelined, so
+   * next request doesn't wait for response of previous one
+   */
+  size_t maxInFlight = 1024;
+
+  /**\brief max size of response buffer, same as SessionOptions::maxRequestSize
+   * for the server. 0 (default) means unlimited
+   */
+  size_t maxResponseSize = 0;
+
+  /**\brief delay before reconnection of a connection, which is failed or
+   * closed by the server
+   */
+  std::chrono::milliseconds reconnectDelay{1000};
+};
+
+/**\brief counters of a client
+ */
+struct ClientStats {
+  size_t connected = 0; // currently connected connections of the pool
+  size_t inFlight  = 0; // requests, which are waiting for response
+
+  size_t requests   = 0; // accepted by `asyncRequest`
+  size_t rejected   = 0; // not accepted by `asyncRequest`
+  size_t responses  = 0;
+  size_t failed     = 0; // completed with error
+  size_t reconnects = 0;
+};
+
+/**\brief pool of pipelined connections to one server. Responses are framed by
+ * request handlers (one handler per connection), so the same handler
+ * abstraction, which parses requests on the server side, parses responses on
+ * the client side:
+ * - every call of `handle`, which succeeds, completes the oldest request of
+ * the connection, and bytes produced by the handler are passed to its
+ * callback as the response;
+ * - SessionError::PartialData means, that the response is not complete yet;
+ * - any other error closes the connection.
+ *
+ * `flush`, `closeAfterWrite` and `sessionHandle` of the handler have no
+ * sense for the client
+ * \note thread-safe
+ */
+class Client {
+  friend ClientBuilder;
+
+public:
+  /**\brief called once for every accepted request, from a thread, which runs
+   * the context of the client. The response is valid only until the callback
+   * returns. If the connection fails before the response, then the callback
+   * is called with the error and empty response
+   * \note must not throw
+   */
+  using ResponseCallback =
+      std::function<void(error_code err, std::string_view response)>;
+
+  /**\brief closes all connections
+   */
+  ~Client();
+
+  /**\brief start connecting of all connections of the pool. Requests can be
+   * sent right after that, they will be written after connection
+   */
+  Client &asyncConnect();
+
+  /**\brief close all connections. Callbacks of not completed requests are
+   * called with SessionError::SessionClosed
+   */
+  Client &close();
+
+  /**\brief queue the request to the least loaded connection
+   * \return SessionError::QueueOverflow if all connections have maxInFlight
+   * requests, or SessionError::SessionClosed if there is no connection,
+   * which can send the request. In both cases the callback is not called
+   * \note can be called from any thread, also from a callback
+   */
+  error_code asyncRequest(std::string      request,
+                          ResponseCallback callback) noexcept;
+
+  ClientStats stats() const noexcept;
+
+private:
+  Client() = default;
+
+private:
+  std::shared_ptr<ClientImpl> impl_;
+};
+
+using ClientPtr = std::shared_ptr<Client>;
+
+class ClientBuilder {
+public:
+  ClientBuilder(asio::io_context &context);
+
+  /**\brief factory of handlers, which parse responses
+   */
+  ClientBuilder &setResponseHandlerFactory(RequestHandlerFactory factory);
+
+  /**\param endpoint host (or ip) and port for tcp, or path for unix socket
+   */
+  ClientBuilder &setEndpoint(Server::Protocol protocol,
+                             std::string_view endpoint);
+
+  /**\brief see ClientOptions::connections
+   * \throw std::invalid_argument if count is 0
+   */
+  ClientBuilder &setConnections(size_t count);
+
+  /**\brief see ClientOptions::maxInFlight
+   * \throw std::invalid_argument if count is 0
+   */
+  ClientBuilder &setMaxInFlight(size_t count);
+
+  /**\brief see ClientOptions::maxResponseSize
+   */
+  ClientBuilder &setMaxResponseSize(size_t bytes);
+
+  /**\brief see ClientOptions::reconnectDelay
+   */
+  ClientBuilder &setReconnectDelay(std::chrono::milliseconds delay);
+
+  /**\brief set profile of options for every connection. Options, which have
+   * sense only for acceptor, are ignored
+   */
+  ClientBuilder &setSocketOptions(SocketOptions options);
+
+  /**\note tcp endpoint is resolved by the method, so it can block
+   */
+  ClientPtr build() const noexcept(false);
+
+private:
+  asio::io_context &ioContext_;
+
+  RequestHandlerFactory resHandlerFactory_;
+  Server::Protocol      protocol_ = Server::Protocol::Tcp;
+  std::string           endpoint_;
+  ClientOptions         clientOptions_;
+  SocketOptions         socketOptions_;
+};
+} // namespace ss
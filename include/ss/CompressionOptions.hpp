@@ -0,0 +1,73 @@
+// CompressionOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace ss {
+/**\brief profile of transparent compression of sessions. Whole byte stream of
+ * a session is compressed by zlib (RFC 1950) in both directions, so handlers
+ * see only decompressed requests. Every session has own persistent contexts,
+ * so repeated content of different requests and responses is compressed by
+ * back references. Every write is ended by sync flush, so the client can
+ * decompress every response as soon as it is readed.
+ *
+ * \note capture (ServerBuilder::setCapture) records compressed stream, as it
+ * is readed from the socket, so it must be replayed to a server with the same
+ * compression options
+ * \note compressed output is not sent with MSG_ZEROCOPY
+ */
+struct CompressionOptions {
+  /**\brief level of compression, from 1 (fastest, default) to 9 (best)
+   */
+  int level = 1;
+
+  /**\brief log2 of window size, from 9 to 15. Every session keeps windows for
+   * both directions, so it is the main memory cost of compression. Client
+   * must use window of the same or smaller size
+   */
+  int windowBits = 15;
+
+  /**\brief pre-trained dictionary for both directions, client must use the
+   * same one. Empty (default) means no dictionary
+   */
+  std::string dictionary;
+};
+
+/**\brief counters of compression for all sessions of a server
+ */
+struct CompressionStats {
+  /**\brief compressed bytes, readed from sockets, and the same bytes after
+   * decompression
+   */
+  uint64_t readBytes         = 0;
+  uint64_t decompressedBytes = 0;
+
+  /**\brief bytes of responses before compression, and the same bytes after
+   * compression
+   */
+  uint64_t responseBytes = 0;
+  uint64_t writtenBytes  = 0;
+
+  /**\brief time, spent by I/O threads in the codec
+   */
+  std::chrono::nanoseconds decompressTime{0};
+  std::chrono::nanoseconds compressTime{0};
+
+  /**\return compression ratio of input, or 0 if nothing is readed
+   */
+  double inputRatio() const noexcept {
+    return readBytes == 0 ? 0. : double(decompressedBytes) / readBytes;
+  }
+
+  /**\return compression ratio of output, or 0 if nothing is writed
+   */
+  double outputRatio() const noexcept {
+    return writtenBytes == 0 ? 0. : double(responseBytes) / writtenBytes;
+  }
+};
+} // namespace ss
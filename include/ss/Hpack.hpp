@@ -0,0 +1,138 @@
+// Hpack.hpp
+/**\file
+ * HPACK (RFC 7541): compression of HTTP/2 headers. Decoder supports all
+ * representations, including huffman coded strings and dynamic table.
+ * Encoder never adds headers to dynamic table of the peer and doesn't use
+ * huffman coding, so it has no state, and encoded header block is always
+ * valid for the peer.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ss {
+namespace hpack {
+constexpr size_t DEFAULT_TABLE_SIZE = 4096;
+
+/**\brief decoded headers. All strings are stored in single buffer, which
+ * capacity is reused after clear
+ */
+class HeaderList final {
+public:
+  size_t size() const noexcept {
+    return fields_.size();
+  }
+
+  std::string_view name(size_t i) const noexcept {
+    return std::string_view{storage_}.substr(fields_[i].nameOffset,
+                                             fields_[i].nameSize);
+  }
+
+  std::string_view value(size_t i) const noexcept {
+    return std::string_view{storage_}.substr(fields_[i].valueOffset,
+                                             fields_[i].valueSize);
+  }
+
+  /**\return value of first header with the name, or empty string
+   */
+  std::string_view find(std::string_view name) const noexcept;
+
+  /**\return summary size of headers, as it is defined for
+   * SETTINGS_MAX_HEADER_LIST_SIZE
+   */
+  size_t listSize() const noexcept {
+    return storage_.size() + fields_.size() * 32;
+  }
+
+  void add(std::string_view name, std::string_view value);
+
+  void clear() noexcept {
+    storage_.clear();
+    fields_.clear();
+  }
+
+private:
+  struct Field {
+    size_t nameOffset;
+    size_t nameSize;
+    size_t valueOffset;
+    size_t valueSize;
+  };
+
+  std::string        storage_;
+  std::vector<Field> fields_;
+};
+
+class Decoder final {
+public:
+  /**\param maxTableSize max size of dynamic table, which is announced to
+   * the peer by SETTINGS_HEADER_TABLE_SIZE
+   */
+  explicit Decoder(size_t maxTableSize = DEFAULT_TABLE_SIZE) noexcept
+      : maxTableSize_{maxTableSize}
+      , tableSizeLimit_{maxTableSize} {
+  }
+
+  /**\brief decode complete header block and append headers to the list
+   * \param maxListSize limit of HeaderList::listSize. Decoded headers can be
+   * much bigger than the block (every 1-byte reference to the table repeats
+   * the entry), so decoding is stopped as soon as the list exceeds the limit
+   * \return false if the block is malformed or the list is too big. It is
+   * compression error, after which state of decoder is undefined, so the
+   * connection must be closed
+   */
+  bool decode(std::string_view block,
+              HeaderList &     headers,
+              size_t maxListSize = std::numeric_limits<size_t>::max());
+
+private:
+  struct Entry {
+    std::string name;
+    std::string value;
+  };
+
+  /**\return false if there is no entry with the index
+   */
+  bool get(size_t index, std::string_view &name, std::string_view &value) const;
+
+  void insert(std::string_view name, std::string_view value);
+
+  void evict(size_t limit);
+
+private:
+  std::deque<Entry> table_;
+  size_t            tableSize_ = 0;
+  size_t            maxTableSize_;
+  size_t            tableSizeLimit_;
+
+  std::string name_;
+  std::string value_;
+};
+
+/**\brief encode integer with the prefix size and first bits of first byte
+ */
+void encodeInteger(std::string &output,
+                   uint8_t      firstBits,
+                   int          prefixBits,
+                   size_t       value);
+
+/**\brief encode header without indexing. Name must be in lower case
+ */
+void encodeHeader(std::string &    output,
+                  std::string_view name,
+                  std::string_view value);
+
+void encodeStatus(std::string &output, unsigned status);
+
+/**\brief decode huffman coded string and append it to the output
+ * \return false if the string is invalid
+ */
+bool huffmanDecode(std::string_view input, std::string &output);
+} // namespace hpack
+} // namespace ss
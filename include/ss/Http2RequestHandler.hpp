@@ -0,0 +1,231 @@
+// Http2RequestHandler.hpp
+/**\file
+ * HTTP/2 (RFC 7540) over cleartext TCP with prior knowledge (h2c): the
+ * session begins from the client connection preface. Every stream is
+ * dispatched to the handler as soon as its request is complete, so one
+ * connection carries many concurrent requests, and responses are sent
+ * interleaved, as flow control of the peer allows.
+ *
+ * Requests are passed to the handler as http::Request, so the same handler
+ * code can serve HTTP/1.1 and HTTP/2.
+ *
+ * \note server push and priorities are not supported. ALPN negotiation
+ * requires TLS, which is not provided by the session, so only prior
+ * knowledge mode is supported
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include "ss/Hpack.hpp"
+#include "ss/HttpParser.hpp"
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace ss {
+namespace http2 {
+enum ErrorCode : uint32_t {
+  NoError            = 0x0,
+  ProtocolError      = 0x1,
+  InternalError      = 0x2,
+  FlowControlError   = 0x3,
+  SettingsTimeout    = 0x4,
+  StreamClosed       = 0x5,
+  FrameSizeError     = 0x6,
+  RefusedStream      = 0x7,
+  Cancel             = 0x8,
+  CompressionError   = 0x9,
+  ConnectError       = 0xa,
+  EnhanceYourCalm    = 0xb,
+  InadequateSecurity = 0xc,
+  Http11Required     = 0xd,
+};
+
+constexpr size_t DEFAULT_MAX_CONCURRENT_STREAMS = 256;
+constexpr size_t DEFAULT_MAX_BODY_SIZE          = 16 * 1024 * 1024;
+constexpr size_t DEFAULT_MAX_HEADER_LIST_SIZE   = 64 * 1024;
+
+/**\brief writer of response for single stream. Headers are encoded by HPACK
+ * directly to header block of the connection, and body is queued to the
+ * stream, so it is sent by DATA frames as flow control allows
+ */
+class ResponseWriter final {
+public:
+  ResponseWriter(std::string &headerBlock,
+                 std::string &data,
+                 bool         headRequest) noexcept
+      : headerBlock_{headerBlock}
+      , data_{data}
+      , headRequest_{headRequest} {
+  }
+
+  /**\brief encode status. If it is not called before headers, then status
+   * is 200
+   */
+  ResponseWriter &status(unsigned code);
+
+  /**\brief encode header. Name is converted to lower case, and connection
+   * specific headers (Connection, Transfer-Encoding, etc.) are ignored
+   */
+  ResponseWriter &header(std::string_view name, std::string_view value);
+
+  /**\brief complete the response with the body. content-length is added
+   * automatically
+   */
+  void body(std::string_view body = {});
+
+  bool completed() const noexcept {
+    return state_ == State::Completed;
+  }
+
+  /**\brief complete the response, if the handler didn't it. If status is not
+   * written yet, then it will be 500
+   */
+  void finish();
+
+private:
+  enum class State {
+    Status,
+    Headers,
+    Completed,
+  };
+
+  std::string &headerBlock_;
+  std::string &data_;
+  bool         headRequest_;
+  State        state_ = State::Status;
+  std::string  name_;
+};
+} // namespace http2
+
+/**\brief base for HTTP/2 handlers
+ */
+class AbstractHttp2RequestHandler : public AbstractRequestHandler {
+public:
+  AbstractHttp2RequestHandler();
+  ~AbstractHttp2RequestHandler() override;
+
+  /**\brief handle request of one stream and write the response
+   * \note request and its body are valid only until return from the method
+   * \return error_code. If it is not success, then the stream is reset
+   */
+  virtual error_code handleRequest(const http::Request &   request,
+                                   http2::ResponseWriter &response) noexcept = 0;
+
+  error_code handle(std::string_view requestBuffer,
+                    ResponseInserter respIter,
+                    size_t &         reqIgnoreLength) noexcept final;
+
+protected:
+  /**\brief max count of concurrent streams, announced to the client. Must be
+   * set before first request
+   */
+  void setMaxConcurrentStreams(size_t count) noexcept {
+    maxStreams_ = count;
+  }
+
+  /**\brief requests with bigger body are reset
+   */
+  void setMaxBodySize(size_t size) noexcept {
+    maxBodySize_ = size;
+  }
+
+  /**\brief max size of decoded headers of one request (as it is defined for
+   * SETTINGS_MAX_HEADER_LIST_SIZE), announced to the client. Bigger header
+   * list is a connection error. Must be set before first request
+   */
+  void setMaxHeaderListSize(size_t size) noexcept {
+    maxHeaderListSize_ = size;
+  }
+
+private:
+  struct Stream;
+  using StreamPtr = std::unique_ptr<Stream>;
+
+  enum class State {
+    Preface,
+    Open,
+    Closed,
+  };
+
+  /**\return false if the frame caused connection error
+   */
+  bool handleFrame(uint8_t          type,
+                   uint8_t          flags,
+                   uint32_t         streamId,
+                   std::string_view payload);
+
+  bool handleHeaders(uint8_t flags, uint32_t streamId, std::string_view payload);
+  bool handleContinuation(uint8_t          flags,
+                          uint32_t         streamId,
+                          std::string_view payload);
+  bool handleData(uint8_t flags, uint32_t streamId, std::string_view payload);
+  bool handleSettings(uint8_t          flags,
+                      uint32_t         streamId,
+                      std::string_view payload);
+  bool handleWindowUpdate(uint32_t streamId, std::string_view payload);
+  bool handleRstStream(uint32_t streamId, std::string_view payload);
+
+  /**\brief decode completed header block of the stream
+   */
+  bool completeHeaders();
+
+  /**\brief call handler for completed request and send the response
+   */
+  void dispatch(Stream &stream);
+
+  /**\brief send queued data of the stream, as flow control allows
+   */
+  void sendData(Stream &stream);
+
+  /**\brief send queued data of all streams, which was blocked by flow
+   * control
+   */
+  void sendBlocked();
+
+  Stream *findStream(uint32_t streamId) noexcept;
+  Stream &openStream(uint32_t streamId);
+  void    closeStream(uint32_t streamId);
+
+  void writeFrame(uint8_t          type,
+                  uint8_t          flags,
+                  uint32_t         streamId,
+                  std::string_view payload);
+  void writeSettings();
+  void writeWindowUpdate(uint32_t streamId, uint32_t increment);
+  void resetStream(uint32_t streamId, http2::ErrorCode code);
+
+  /**\brief send GOAWAY and close the session after write
+   */
+  bool connectionError(http2::ErrorCode code);
+
+private:
+  State                           state_ = State::Preface;
+  std::optional<ResponseInserter> output_;
+
+  size_t maxStreams_        = http2::DEFAULT_MAX_CONCURRENT_STREAMS;
+  size_t maxBodySize_       = http2::DEFAULT_MAX_BODY_SIZE;
+  size_t maxHeaderListSize_ = http2::DEFAULT_MAX_HEADER_LIST_SIZE;
+
+  hpack::Decoder decoder_;
+
+  std::unordered_map<uint32_t, StreamPtr> streams_;
+  std::vector<StreamPtr>                  freeStreams_;
+  uint32_t                                lastStreamId_ = 0;
+
+  // header block, splitted to CONTINUATION frames
+  std::string headerBlock_;
+  uint32_t    continuationStream_ = 0;
+  bool        continuationEnd_    = false;
+
+  // settings of the peer
+  int64_t connectionWindow_ = 65535;
+  int64_t initialWindow_    = 65535;
+  size_t  peerMaxFrameSize_ = 16384;
+
+  hpack::HeaderList trailers_;
+  std::string       responseHeaders_;
+  http::Request     request_;
+};
+} // namespace ss
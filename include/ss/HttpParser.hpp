@@ -0,0 +1,156 @@
+// HttpParser.hpp
+/**\file
+ * Parser of HTTP/1.x requests. It doesn't allocate memory (except of decoded
+ * body of chunked requests, which storage is reused) and doesn't copy data:
+ * all parts of parsed request are views to the request buffer.
+ *
+ * The parser is resumable: if request is not complete, then next parse call
+ * continues from the place where previous one stopped, so a big request,
+ * readed by many small reads, is not rescanned after every read.
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace ss {
+namespace http {
+constexpr size_t MAX_HEADERS = 64;
+
+/**\brief default max size of request line and headers
+ */
+constexpr size_t MAX_HEAD_SIZE = 64 * 1024;
+
+/**\brief default max size of request body, declared by Content-Length or
+ * decoded from chunks
+ */
+constexpr size_t MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+/**\brief max size of line with size of chunk (with extensions) or of trailer
+ * field
+ */
+constexpr size_t MAX_CHUNK_LINE_SIZE = 4 * 1024;
+
+struct Header {
+  std::string_view name;
+  std::string_view value;
+};
+
+/**\brief parsed request. All views point to the request buffer (or to the
+ * parser for chunked body), so they are valid only until the handler returns
+ */
+struct Request {
+  std::string_view method;
+  std::string_view target;
+  int              versionMinor = 1;
+
+  std::array<Header, MAX_HEADERS> headers;
+  size_t                          headersCount = 0;
+
+  std::string_view body;
+  bool             keepAlive = true;
+
+  /**\return value of first header with the name (case insensitive), or empty
+   * string if the request has no such header
+   */
+  std::string_view header(std::string_view name) const noexcept;
+};
+
+enum class ParseStatus {
+  Complete,    // request is parsed
+  Partial,     // need more data
+  Invalid,     // malformed request
+  Unsupported, // valid request, but with unsupported version or encoding
+  TooLarge,    // head or body of the request is bigger than the limit
+};
+
+class RequestParser final {
+public:
+  /**\param maxHeadSize max size of request line and headers. Bigger head is
+   * not waited to the end, but reported as ParseStatus::TooLarge
+   * \param maxBodySize max size of request body. It is checked by declared
+   * Content-Length or by size of chunks, so bigger body is not waited too
+   */
+  explicit RequestParser(size_t maxHeadSize = MAX_HEAD_SIZE,
+                         size_t maxBodySize = MAX_BODY_SIZE) noexcept
+      : maxHeadSize_{maxHeadSize}
+      , maxBodySize_{maxBodySize} {
+  }
+
+  /**\param buffer data, which begins from the request. Until reset the
+   * buffer must begin from the same data, as in previous call
+   * \return ParseStatus::Complete if whole request is in the buffer, in this
+   * case the request is filled
+   */
+  ParseStatus parse(std::string_view buffer, Request &request);
+
+  /**\return size of parsed request in the buffer. Valid after completion of
+   * parsing, so next request in the buffer begins from the offset
+   */
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /**\return true if the head is parsed, so ParseStatus::TooLarge is reported
+   * for the body
+   */
+  bool headParsed() const noexcept {
+    return stage_ != Stage::Head;
+  }
+
+  /**\brief prepare for parsing of next request
+   */
+  void reset() noexcept;
+
+private:
+  struct Span {
+    size_t offset;
+    size_t size;
+  };
+
+  enum class Stage {
+    Head,
+    Body,
+    Chunks,
+    Complete,
+  };
+
+  ParseStatus parseHead(std::string_view head);
+  ParseStatus parseHeader(std::string_view head, Span name, Span value);
+  ParseStatus parseChunks(std::string_view buffer);
+  void        fill(std::string_view buffer, Request &request) const noexcept;
+
+private:
+  size_t maxHeadSize_;
+  size_t maxBodySize_;
+
+  Stage  stage_   = Stage::Head;
+  size_t scanned_ = 0;
+  size_t size_    = 0;
+
+  size_t headSize_     = 0;
+  Span   method_{};
+  Span   target_{};
+  int    versionMinor_ = 1;
+  bool   keepAlive_    = true;
+
+  std::array<std::pair<Span, Span>, MAX_HEADERS> headers_;
+  size_t                                         headersCount_ = 0;
+
+  bool   hasContentLength_ = false;
+  size_t contentLength_    = 0;
+
+  bool        chunked_   = false;
+  bool        inTrailer_ = false;
+  size_t      chunkPos_  = 0;
+  std::string chunkedBody_;
+};
+
+/**\brief case insensitive compare of ascii strings
+ */
+bool iequals(std::string_view lhs, std::string_view rhs) noexcept;
+} // namespace http
+} // namespace ss
@@ -0,0 +1,132 @@
+// HttpRequestHandler.hpp
+/**\file
+ * HTTP/1.1 on top of the session: keep-alive, pipelining and chunked
+ * encoding of requests and responses. Requests are parsed by
+ * http::RequestParser directly in the request buffer of the session, and
+ * responses are written by http::ResponseWriter directly to output of the
+ * session, so usual request doesn't cause any allocations.
+ *
+ * Pipelined requests are handled one by one in order of receiving, so
+ * responses are in the same order as requires HTTP/1.1.
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include "ss/HttpParser.hpp"
+
+namespace ss {
+namespace http {
+/**\brief writer of single response. Status line and headers are written
+ * immediately to output of the session, so they must be set in order: status,
+ * headers, body
+ */
+class ResponseWriter final {
+public:
+  using Inserter = AbstractRequestHandler::ResponseInserter;
+
+  ResponseWriter(Inserter output, const Request &request) noexcept;
+
+  /**\brief write status line. If it is not called before headers, then status
+   * is 200
+   * \param reason if empty, then default reason phrase for the code is used
+   */
+  ResponseWriter &status(unsigned code, std::string_view reason = {});
+
+  ResponseWriter &header(std::string_view name, std::string_view value);
+
+  /**\brief complete the response with the body. Content-Length is added
+   * automatically
+   */
+  void body(std::string_view body = {});
+
+  /**\brief write part of body, which size is not known in advance. First call
+   * completes head of the response with chunked encoding, and `end` must be
+   * called after last chunk
+   * \note HTTP/1.0 doesn't support chunked encoding, so in this case body is
+   * written as is and connection will be closed after the response
+   */
+  void chunk(std::string_view data);
+
+  /**\brief complete chunked response
+   */
+  void end();
+
+  /**\brief close connection after the response. Must be called before body
+   */
+  ResponseWriter &closeConnection() noexcept;
+
+  bool keepAlive() const noexcept {
+    return keepAlive_;
+  }
+
+  bool completed() const noexcept {
+    return state_ == State::Completed;
+  }
+
+  /**\brief complete the response, if the handler didn't it. If status is not
+   * written yet, then it will be "500 Internal Server Error"
+   */
+  void finish();
+
+private:
+  enum class State {
+    Status,
+    Headers,
+    Chunked,
+    Completed,
+  };
+
+  void write(std::string_view data);
+  void writeNumber(size_t number, int base = 10);
+
+  /**\brief write connection header and end of head
+   */
+  void endHead();
+
+private:
+  Inserter output_;
+  State    state_ = State::Status;
+  bool     keepAlive_;
+  bool     http10_;
+  bool     headRequest_;
+};
+
+/**\return default reason phrase for the status code
+ */
+std::string_view reasonPhrase(unsigned code) noexcept;
+} // namespace http
+
+/**\brief base for handlers of HTTP/1.1 requests. Malformed requests are
+ * answered by 400 (or 501 for unsupported version or transfer coding, 431 for
+ * too big head, or 413 for too big body), after which the session is closed
+ */
+class AbstractHttpRequestHandler : public AbstractRequestHandler {
+public:
+  /**\param maxHeadSize max size of request line and headers
+   * \param maxBodySize max size of request body
+   */
+  explicit AbstractHttpRequestHandler(
+      size_t maxHeadSize = http::MAX_HEAD_SIZE,
+      size_t maxBodySize = http::MAX_BODY_SIZE) noexcept
+      : parser_{maxHeadSize, maxBodySize} {
+  }
+
+  /**\brief handle one request and write the response
+   * \note request and its body are valid only until return from the method
+   * \return error_code. If it is not success, then session will be closed
+   */
+  virtual error_code handleRequest(const http::Request &  request,
+                                   http::ResponseWriter &response) noexcept = 0;
+
+  /**\brief handle all complete requests in the buffer
+   */
+  error_code handle(std::string_view requestBuffer,
+                    ResponseInserter respIter,
+                    size_t &         reqIgnoreLength) noexcept final;
+
+private:
+  http::RequestParser parser_;
+  http::Request       request_;
+};
+} // namespace ss
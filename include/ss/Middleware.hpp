@@ -0,0 +1,157 @@
+// Middleware.hpp
+/**\file
+ * Middlewares run before and after every call of request handler: checks of
+ * access, metrics, logging. They are composed to a chain at compile time
+ *
+ * \code
+ * struct Metrics : ss::Middleware {
+ *   struct State {
+ *     std::chrono::steady_clock::time_point start;
+ *   };
+ *
+ *   bool before(ss::RequestContext &, State &state) noexcept {
+ *     state.start = std::chrono::steady_clock::now();
+ *     return true;
+ *   }
+ *
+ *   void after(ss::RequestContext &context, State &state) noexcept;
+ * };
+ *
+ * builder.setMiddleware(ss::makeMiddlewareChain(Auth{}, Metrics{}));
+ * \endcode
+ *
+ * So the session calls whole chain by one virtual call, and states of
+ * middlewares live on the stack, so nothing is allocated per request.
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include <memory>
+#include <tuple>
+
+namespace ss {
+/**\brief the request, which is passed through middlewares
+ */
+struct RequestContext {
+  /**\brief not handled bytes of the session, as they are passed to the
+   * handler
+   */
+  std::string_view request;
+
+  const SessionHandle &session;
+
+  /**\brief output of the session. Middleware can append own response (for
+   * example, if it rejects the request), but must not change already
+   * produced bytes
+   */
+  std::string &output;
+
+  /**\brief response of the request: produced by the handler or taken from
+   * the response cache. Set before `after` calls
+   */
+  std::string_view response;
+
+  /**\brief result of the handler, as it is returned to the session. If
+   * middleware rejects the request, then it sets the result itself
+   * \see AbstractRequestHandler::handle
+   */
+  error_code result;
+  size_t     reqIgnoreLength = 0;
+};
+
+/**\brief base for middlewares with hooks, which do nothing. Derived class
+ * hides hooks, which it needs, and can define own `State`, which is
+ * constructed for every request before the chain and destroyed after it
+ * \note one instance of middleware is shared by all sessions of the server,
+ * so hooks can be called concurrently from different I/O threads
+ */
+struct Middleware {
+  struct State {};
+
+  /**\brief called before the handler
+   * \return false for reject the request: the handler and next middlewares
+   * are not called, and `context.result` and `context.reqIgnoreLength` are
+   * returned to the session. `after` is called only for previous middlewares
+   */
+  template <typename State>
+  bool before([[maybe_unused]] RequestContext &context,
+              [[maybe_unused]] State &         state) noexcept {
+    return true;
+  }
+
+  /**\brief called after the handler in reverse order
+   */
+  template <typename State>
+  void after([[maybe_unused]] RequestContext &context,
+             [[maybe_unused]] State &         state) noexcept {
+  }
+};
+
+/**\brief type-erased chain, which is called by the session
+ */
+class AbstractMiddlewareChain {
+public:
+  /**\brief end of the chain: the handler of the session. It is a plain
+   * function, so the chain doesn't allocate it
+   */
+  struct Next {
+    error_code (*function)(void *target, RequestContext &context);
+    void *target;
+  };
+
+  virtual ~AbstractMiddlewareChain() = default;
+
+  /**\brief pass the request through all middlewares to `next`
+   * \return result for the session
+   */
+  virtual error_code handle(RequestContext &context, Next next) = 0;
+};
+
+using MiddlewareChainPtr = std::shared_ptr<AbstractMiddlewareChain>;
+
+/**\brief calls middlewares in order of template arguments before the handler
+ * and in reverse order after it. All calls inside the chain are static, so
+ * they can be inlined
+ */
+template <typename... Middlewares>
+class MiddlewareChain final : public AbstractMiddlewareChain {
+public:
+  explicit MiddlewareChain(Middlewares... middlewares)
+      : middlewares_{std::move(middlewares)...} {
+  }
+
+  error_code handle(RequestContext &context, Next next) override {
+    std::tuple<typename Middlewares::State...> states;
+    this->template run<0>(context, next, states);
+    return context.result;
+  }
+
+private:
+  template <size_t I, typename States>
+  void run(RequestContext &context, Next next, States &states) {
+    if constexpr (I == sizeof...(Middlewares)) {
+      context.result = next.function(next.target, context);
+    } else {
+      auto &middleware = std::get<I>(middlewares_);
+      auto &state      = std::get<I>(states);
+      if (middleware.before(context, state) == false) {
+        return;
+      }
+
+      this->template run<I + 1>(context, next, states);
+
+      middleware.after(context, state);
+    }
+  }
+
+private:
+  std::tuple<Middlewares...> middlewares_;
+};
+
+template <typename... Middlewares>
+MiddlewareChainPtr makeMiddlewareChain(Middlewares... middlewares) {
+  return std::make_shared<MiddlewareChain<Middlewares...>>(
+      std::move(middlewares)...);
+}
+} // namespace ss
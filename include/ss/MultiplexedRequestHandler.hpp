@@ -0,0 +1,99 @@
+// MultiplexedRequestHandler.hpp
+/**\file
+ * Multiplexing of requests: every request and response is framed as
+ *
+ * | request id (4 bytes) | payload size (4 bytes) | payload |
+ *
+ * where numbers are in network byte order. Responses carry id of their
+ * request, so they can be sent in any order, as soon as they are ready, and
+ * slow request doesn't block responses for next ones.
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace ss {
+using RequestId = uint32_t;
+
+constexpr size_t MULTIPLEXED_HEADER_SIZE = 8;
+
+/**\brief default max size of payload of one request frame
+ */
+constexpr size_t MULTIPLEXED_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+/**\brief append frame with the payload to end of output
+ */
+void appendMultiplexedFrame(std::string &    output,
+                            RequestId        id,
+                            std::string_view payload);
+
+/**\brief completes one multiplexed request. Can be copied and used from any
+ * thread, after the handler returns
+ */
+class Responder {
+public:
+  Responder(SessionHandle session, RequestId id) noexcept
+      : session_{std::move(session)}
+      , id_{id} {
+  }
+
+  RequestId id() const noexcept {
+    return id_;
+  }
+
+  /**\brief send response for the request. It is written right after already
+   * queued output of the session
+   * \return error of SessionHandle::send
+   * \note can be called from any thread
+   */
+  error_code send(std::string_view payload) const noexcept;
+
+private:
+  SessionHandle session_;
+  RequestId     id_;
+};
+
+/**\brief base for handlers of multiplexed protocol. Request can be completed
+ * synchronously by `respond`, or later by the responder
+ */
+class AbstractMultiplexedRequestHandler : public AbstractRequestHandler {
+public:
+  /**\param maxFrameSize max size of payload of request frame. Size of frame
+   * is declared by the client, so if header of a frame declares bigger
+   * size, then the session is closed with SessionError::RequestTooBig
+   * without buffering of the frame
+   */
+  explicit AbstractMultiplexedRequestHandler(
+      size_t maxFrameSize = MULTIPLEXED_MAX_FRAME_SIZE) noexcept
+      : maxFrameSize_{maxFrameSize} {
+  }
+
+  /**\brief handle one request
+   * \return error_code. If it is not success, then session will be closed
+   */
+  virtual error_code handleRequest(RequestId        id,
+                                   std::string_view payload,
+                                   Responder        responder) noexcept = 0;
+
+  /**\brief split the buffer to frames and call handleRequest for every of
+   * them
+   */
+  error_code handle(std::string_view requestBuffer,
+                    ResponseInserter respIter,
+                    size_t &         reqIgnoreLength) noexcept final;
+
+protected:
+  /**\brief write response immediately. Can be used only inside of
+   * handleRequest, and it is cheaper then the responder, because the response
+   * is written directly to output of the session
+   */
+  void respond(RequestId id, std::string_view payload);
+
+private:
+  size_t                          maxFrameSize_;
+  std::optional<ResponseInserter> output_;
+};
+} // namespace ss
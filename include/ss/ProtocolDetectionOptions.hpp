@@ -0,0 +1,55 @@
+// ProtocolDetectionOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ss {
+/**\brief max size of protocol signature, so count of peeked bytes is bounded
+ */
+constexpr size_t MAX_PROTOCOL_SIGNATURE_SIZE = 32;
+
+/**\brief profile of detection of protocol on shared endpoint. First bytes of
+ * every accepted connection are peeked (so they stay in the socket for the
+ * session) and compared with signatures of registered protocols. The
+ * connection is handled by factory of the protocol, which signature is prefix
+ * of the bytes, or by default factory if there is no such protocol
+ */
+struct ProtocolDetectionOptions {
+  /**\brief max time of waiting for the signature. After that the connection
+   * is passed to the default factory, so protocols, where the server speaks
+   * first, are delayed by this time
+   */
+  std::chrono::milliseconds timeout{1000};
+
+  /**\brief if peeked bytes are shorter than some signature and match it,
+   * then they are peeked again after the interval
+   */
+  std::chrono::milliseconds retryInterval{1};
+};
+
+/**\brief counters of protocol detection
+ */
+struct ProtocolDetectionStats {
+  size_t detected    = 0; // connections, which matched some signature
+  size_t defaulted   = 0; // connections, passed to the default factory
+  size_t unknown     = 0; // closed, because there is no factory for them
+  size_t disconnects = 0; // closed by clients or failed during detection
+  size_t timeouts    = 0; // connections, which didn't send signature in time
+  size_t peeks       = 0;
+
+  std::chrono::nanoseconds totalTime{0}; // of all finished detections
+  std::chrono::nanoseconds maxTime{0};
+
+  /**\return average time of detection, or 0 if there was no detections
+   */
+  std::chrono::nanoseconds averageTime() const noexcept {
+    int64_t count = detected + defaulted + unknown + disconnects;
+    return count == 0 ? std::chrono::nanoseconds{0} : totalTime / count;
+  }
+};
+} // namespace ss
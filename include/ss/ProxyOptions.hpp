@@ -0,0 +1,44 @@
+// ProxyOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace ss {
+/**\brief profile of proxy mode. In the mode every accepted connection is
+ * forwarded to the upstream as is: bytes are moved in both directions by
+ * splice(2) through a pipe, so they are not copied to userspace. If splice
+ * can not be used (not linux, or the sockets doesn't support it), then bytes
+ * are copied through a buffer
+ * \note every session has its own upstream connection, which is closed with
+ * the session. Bytes are not parsed, so the proxy can not know, that the
+ * upstream has sent all responses, and the connection is never reused
+ */
+struct ProxyOptions {
+  /**\brief use splice if possible. If false, then bytes are always copied
+   */
+  bool splice = true;
+
+  /**\brief capacity of pipes in bytes (F_SETPIPE_SZ), which limits count of
+   * bytes moved by one splice. 0 (default) keeps the kernel default
+   */
+  size_t pipeSize = 0;
+
+  /**\brief size of buffer of every direction, if bytes are copied
+   */
+  size_t bufferSize = 64 * 1024;
+};
+
+/**\brief counters of proxy mode
+ */
+struct ProxyStats {
+  size_t sessions         = 0; // all proxied sessions
+  size_t upstreamConnects = 0; // connections to the upstream
+  size_t upstreamFailures = 0; // failed connections to the upstream
+
+  size_t splicedBytes = 0;
+  size_t copiedBytes  = 0;
+};
+} // namespace ss
@@ -0,0 +1,44 @@
+// RateLimitOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace ss {
+/**\brief limits of token buckets. 0 rate means unlimited. Burst is count of
+ * tokens, which can be spent at once after idle period, 0 burst means one
+ * second of the rate
+ */
+struct RateLimit {
+  double requestsPerSecond = 0;
+  double requestsBurst     = 0;
+
+  double bytesPerSecond = 0;
+  double bytesBurst     = 0;
+};
+
+/**\brief rate limiting of requests, enforced by sessions. Requests over the
+ * limits are not rejected: when tokens are spent, the session stops calling
+ * the handler and reading the socket until the tokens are refilled, so TCP
+ * flow control slows down the client. Every handler call, which consumes
+ * data, is counted as a request. Readed bytes are counted after the read, so
+ * one read can overdraw the bucket, and the debt delays next reads
+ */
+struct RateLimitOptions {
+  /**\brief limits of every session
+   */
+  RateLimit session;
+
+  /**\brief limits, shared by all tcp sessions from the same ip address
+   */
+  RateLimit address;
+
+  /**\brief count of slots in the table of addresses. The table has fixed
+   * size, so if there are more active addresses, then some of them share
+   * buckets. Slots of idle addresses are reused
+   */
+  size_t addressTableSize = 4096;
+};
+} // namespace ss
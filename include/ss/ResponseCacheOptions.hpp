@@ -0,0 +1,55 @@
+// ResponseCacheOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace ss {
+/**\brief profile of response cache, which is shared by all sessions of a
+ * server. Responses are cached only for requests, which are marked by
+ * handler as cacheable, and they are keyed by bytes of the request. Cached
+ * responses are immutable, so they are inserted to output of sessions without
+ * copying
+ * \see AbstractRequestHandler::cacheableRequestSize
+ */
+struct ResponseCacheOptions {
+  /**\brief memory budget for requests and responses of all entries. It is
+   * divided between shards equally, so responses, which are bigger then
+   * budget of one shard, are not cached
+   */
+  size_t maxBytes = 64 * 1024 * 1024;
+
+  /**\brief time to live of every entry. 0 (default) means that entries are
+   * removed only by eviction
+   */
+  std::chrono::milliseconds ttl{0};
+
+  /**\brief count of independently locked parts of the cache. Every entry
+   * belongs to shard by hash of the request
+   */
+  size_t shards = 16;
+};
+
+/**\brief counters of response cache
+ */
+struct ResponseCacheStats {
+  size_t hits      = 0;
+  size_t misses    = 0;
+  size_t inserts   = 0;
+  size_t evictions = 0; // including expired entries
+
+  size_t entries = 0;
+  size_t bytes   = 0;
+
+  /**\return part of lookups, which found the response, or 0 if there was no
+   * lookups
+   */
+  double hitRatio() const noexcept {
+    size_t lookups = hits + misses;
+    return lookups == 0 ? 0. : double(hits) / lookups;
+  }
+};
+} // namespace ss
@@ -3,14 +3,82 @@
 #pragma once
 
 #include "ss/AbstractRequestHandler.hpp"
+#include "ss/Broadcaster.hpp"
+#include "ss/CompressionOptions.hpp"
+#include "ss/Middleware.hpp"
+#include "ss/ProtocolDetectionOptions.hpp"
+#include "ss/ProxyOptions.hpp"
+#include "ss/RateLimitOptions.hpp"
+#include "ss/ResponseCacheOptions.hpp"
+#include "ss/SocketOptions.hpp"
+#include "ss/ThreadPoolOptions.hpp"
 #include <boost/asio/io_context.hpp>
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace ss {
 namespace asio = boost::asio;
 
+class CompressionContext;
+class ProtocolDetector;
+class Proxy;
+class ResponseCache;
 class ServerBuilder;
 class ServerImpl;
+class ThreadPool;
+
+/**\brief options, which will be applied to every accepted session
+ */
+struct SessionOptions {
+  /**\brief if not 0, then responses with size greater or equal to the value
+   * will be sent with MSG_ZEROCOPY (linux, tcp only). Every such response
+   * buffer is kept alive until kernel releases it.
+   * \note zerocopy has notable setup cost, so it has sense only for big
+   * responses (tens of Kb and more)
+   */
+  size_t zeroCopyThreshold = 0;
+
+  /**\brief max count of bytes of sent zerocopy responses, which are not
+   * released by kernel yet. They are counted as not written output for
+   * watermarks, and if the limit is reached, then next responses are sent
+   * by usual writes, so slow client can not pin unbounded memory
+   */
+  size_t zeroCopyMaxPending = 16 * 1024 * 1024;
+
+  /**\brief write coalescing. If coalesceDelay is 0 (default), then responses
+   * are written right after handling of every readed chunk. Otherwise
+   * responses are accumulated and written when size of buffered output
+   * reaches coalesceBytes (if it is not 0), when coalesceDelay passed since
+   * the oldest not written byte, or when handler requests flush
+   * \see AbstractRequestHandler::flush
+   */
+  size_t                    coalesceBytes = 0;
+  std::chrono::microseconds coalesceDelay{0};
+
+  /**\brief max count of bytes, sent by SessionHandle, but not writed yet.
+   * SessionHandle::send fails, when the limit is reached
+   */
+  size_t pushQueueLimit = 1024 * 1024 * 16;
+
+  /**\brief watermarks for count of not writed bytes of a session. If
+   * highWatermark is 0 (default), then session doesn't read next request
+   * while any write is in progress. Otherwise session continues reading
+   * until the count reaches highWatermark, and then resumes reading when the
+   * count falls to lowWatermark. Handler is notified about both events
+   * \see AbstractRequestHandler::atHighWatermark
+   */
+  size_t lowWatermark  = 0;
+  size_t highWatermark = 0;
+
+  /**\brief max size of request buffer. If handler returns PartialData, but
+   * the buffer already has the size, then session will be closed with
+   * SessionError::RequestTooBig. 0 (default) means unlimited
+   */
+  size_t maxRequestSize = 0;
+};
 
 class Server {
   friend ServerBuilder;
@@ -18,15 +86,60 @@ class Server {
 public:
   enum Protocol { Tcp, Unix };
 
+  /**\brief start accepting. If the server has thread pool, then threads of
+   * the pool are started too
+   * \see ServerBuilder::setThreadPool
+   */
   Server &asyncRun();
 
+  /**\brief stop accepting and close all sessions. Threads of the pool finish
+   * after closing of all sessions, and they are joined at destruction of the
+   * server
+   */
   Server &stop();
 
+  /**\brief broadcaster for fan-out messages to sessions of the server
+   * \see ServerBuilder::setBroadcaster
+   */
+  BroadcasterPtr broadcaster() const noexcept;
+
+  /**\return state of I/O threads. Empty if the server has no thread pool
+   * \see ServerBuilder::setThreadPool
+   */
+  ThreadPoolStats threadPoolStats() const;
+
+  /**\return counters of compression. Empty if compression is disabled
+   * \see ServerBuilder::setCompression
+   */
+  CompressionStats compressionStats() const noexcept;
+
+  /**\return counters of response cache. Empty if the cache is disabled
+   * \see ServerBuilder::setResponseCache
+   */
+  ResponseCacheStats responseCacheStats() const noexcept;
+
+  /**\return counters of proxy mode. Empty if the server is not a proxy
+   * \see ServerBuilder::setProxy
+   */
+  ProxyStats proxyStats() const noexcept;
+
+  /**\return counters and cost of protocol detection. Empty if there is no
+   * protocols on the endpoint
+   * \see ServerBuilder::addProtocol
+   */
+  ProtocolDetectionStats protocolDetectionStats() const noexcept;
+
 private:
   Server() = default;
 
 private:
-  std::shared_ptr<ServerImpl> impl_;
+  std::shared_ptr<ServerImpl>         impl_;
+  BroadcasterPtr                      broadcaster_;
+  std::shared_ptr<ThreadPool>         threadPool_;
+  std::shared_ptr<CompressionContext> compression_;
+  std::shared_ptr<ResponseCache>      responseCache_;
+  std::shared_ptr<Proxy>              proxy_;
+  std::shared_ptr<ProtocolDetector>   protocolDetector_;
 };
 
 using ServerPtr = std::shared_ptr<Server>;
@@ -42,13 +155,145 @@ public:
   ServerBuilder &setEndpoint(Server::Protocol protocol,
                              std::string_view endpoint);
 
+  /**\brief see SessionOptions::zeroCopyThreshold and
+   * SessionOptions::zeroCopyMaxPending. By default 0 (disabled)
+   */
+  ServerBuilder &setZeroCopyThreshold(size_t bytes,
+                                      size_t maxPending = 16 * 1024 * 1024);
+
+  /**\brief set profile of options for listening and accepted sockets
+   */
+  ServerBuilder &setSocketOptions(SocketOptions options);
+
+  /**\brief see SessionOptions::coalesceBytes and
+   * SessionOptions::coalesceDelay. By default disabled
+   */
+  ServerBuilder &setWriteCoalescing(size_t                    bytes,
+                                    std::chrono::microseconds delay);
+
+  /**\brief see SessionOptions::pushQueueLimit
+   */
+  ServerBuilder &setPushQueueLimit(size_t bytes);
+
+  /**\brief see SessionOptions::lowWatermark and SessionOptions::highWatermark
+   * \throw std::invalid_argument if low greater then high
+   */
+  ServerBuilder &setOutputWatermarks(size_t low, size_t high);
+
+  /**\brief see SessionOptions::maxRequestSize
+   */
+  ServerBuilder &setMaxRequestSize(size_t bytes);
+
+  /**\brief by default every server has its own broadcaster. Use the method,
+   * if the broadcaster must be accessible by request handlers before the
+   * server is built, or must be shared between several servers
+   */
+  ServerBuilder &setBroadcaster(BroadcasterPtr broadcaster);
+
+  /**\brief by default sessions are run on the context of the builder, and
+   * user must run it. With thread pool the server starts own I/O threads for
+   * sessions, optionally pinned to cpus
+   * \see ThreadPoolOptions
+   */
+  ServerBuilder &setThreadPool(ThreadPoolOptions options);
+
+  /**\brief record all requests of every session with timestamps to the file,
+   * so the traffic can be replayed later by ss_replay. Capture has notable
+   * cost, so it is disabled by default
+   * \note the file is opened by `build`, which throws std::runtime_error if
+   * it can not be opened
+   */
+  ServerBuilder &setCapture(std::string path);
+
+  /**\brief compress whole byte stream of every session, so clients must use
+   * the same codec. Disabled by default
+   * \see CompressionOptions
+   * \note the options are validated by `build`, which throws
+   * std::invalid_argument if they are invalid, or if ss is built without zlib
+   */
+  ServerBuilder &setCompression(CompressionOptions options);
+
+  /**\brief limit rate of requests and readed bytes for every session and
+   * for every client address. Disabled by default
+   * \see RateLimitOptions
+   * \note the options are validated by `build`, which throws
+   * std::invalid_argument if they are invalid
+   */
+  ServerBuilder &setRateLimit(RateLimitOptions options);
+
+  /**\brief cache responses of requests, which are marked by handlers as
+   * cacheable. Disabled by default
+   * \see ResponseCacheOptions
+   * \see AbstractRequestHandler::cacheableRequestSize
+   * \note the options are validated by `build`, which throws
+   * std::invalid_argument if they are invalid
+   */
+  ServerBuilder &setResponseCache(ResponseCacheOptions options);
+
+  /**\brief pass every request of every session through the chain. The
+   * chain is shared by all sessions, and it is called for requests, which are
+   * answered from the response cache, too
+   * \see makeMiddlewareChain
+   */
+  ServerBuilder &setMiddleware(MiddlewareChainPtr middleware);
+
+  /**\brief serve one more protocol on the same endpoint. Connections, which
+   * start by the signature, are handled by the factory. Other connections are
+   * handled by the factory of `setRequestHandlerFactory`, or closed if it is
+   * not set. If several signatures match, then the first added is used
+   * \param signature first bytes of the protocol, for example "\x16\x03" for
+   * TLS handshake or "GET " for HTTP. Several signatures can be added for
+   * the same factory
+   * \see ProtocolDetectionOptions
+   * \note the signature is validated by `build`, which throws
+   * std::invalid_argument if it is empty or longer than
+   * MAX_PROTOCOL_SIGNATURE_SIZE
+   */
+  ServerBuilder &addProtocol(std::string           signature,
+                             RequestHandlerFactory factory);
+
+  /**\brief see ProtocolDetectionOptions. Used only if some protocol is added
+   */
+  ServerBuilder &setProtocolDetection(ProtocolDetectionOptions options);
+
+  /**\brief forward every accepted connection to the upstream instead of
+   * handling requests, so the request handler factory is not needed. Other
+   * options of sessions (write coalescing, compression, rate limit, response
+   * cache, middlewares, capture) are not applied to forwarded connections.
+   * Protocols can not be added to the proxy endpoint, `build` throws
+   * std::invalid_argument in this case
+   * \param upstream endpoint in the same format as for `setEndpoint`
+   * \see ProxyOptions
+   */
+  ServerBuilder &setProxy(Server::Protocol protocol,
+                          std::string_view upstream,
+                          ProxyOptions     options = ProxyOptions{});
+
   ServerPtr build() const noexcept(false);
 
+private:
+  using ProtocolFactories =
+      std::vector<std::pair<std::string, RequestHandlerFactory>>;
+
 private:
   asio::io_context &ioContext_;
 
   std::shared_ptr<AbstractRequestHandlerFactory> reqHandlerFactory_;
   Server::Protocol                               protocol_;
   std::string                                    endpoint_;
+  SessionOptions                                 sessionOptions_;
+  SocketOptions                                  socketOptions_;
+  BroadcasterPtr                                 broadcaster_;
+  std::optional<ThreadPoolOptions>               threadPoolOptions_;
+  std::string                                    capturePath_;
+  std::optional<CompressionOptions>              compressionOptions_;
+  std::optional<RateLimitOptions>                rateLimitOptions_;
+  std::optional<ResponseCacheOptions>            responseCacheOptions_;
+  MiddlewareChainPtr                             middleware_;
+  ProtocolFactories                              protocols_;
+  ProtocolDetectionOptions                       protocolDetectionOptions_;
+  Server::Protocol                               proxyProtocol_;
+  std::string                                    proxyUpstream_;
+  std::optional<ProxyOptions>                    proxyOptions_;
 };
 } // namespace ss
@@ -0,0 +1,60 @@
+// SessionHandle.hpp
+
+#pragma once
+
+#include "ss/errors.hpp"
+#include <memory>
+#include <string>
+
+namespace ss {
+class AbstractSession;
+class Broadcaster;
+
+/**\brief immutable buffer, which can be shared between many sessions
+ * without copying
+ */
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+/**\brief thread-safe handle of a session, which can be used for sending
+ * messages to the session at any time, not only as response to request.
+ * Handle doesn't prolong life of the session
+ * \see AbstractRequestHandler::sessionHandle
+ */
+class SessionHandle {
+  friend Broadcaster;
+
+public:
+  SessionHandle() = default;
+  explicit SessionHandle(std::weak_ptr<AbstractSession> session) noexcept;
+
+  /**\brief queue message to the session output. Messages are written in
+   * order of sending, between responses of the handler
+   * \return SessionError::QueueOverflow if the session has too many not
+   * writed pushed bytes (see SessionOptions::pushQueueLimit), or
+   * SessionError::SessionClosed if the session is already closed
+   * \note can be called from any thread
+   */
+  error_code send(std::string message) const noexcept;
+
+  /**\brief same as previous, but the buffer will be written as is, without
+   * copying to the session output buffer
+   * \return errc::invalid_argument if the message is nullptr
+   */
+  error_code send(SharedBuffer message) const noexcept;
+
+  /**\brief close the session
+   * \note can be called from any thread
+   */
+  void close() const;
+
+  bool isOpen() const noexcept;
+
+  /**\return true if both handles refer to the same session
+   */
+  bool operator==(const SessionHandle &rhs) const noexcept;
+  bool operator!=(const SessionHandle &rhs) const noexcept;
+
+private:
+  std::weak_ptr<AbstractSession> session_;
+};
+} // namespace ss
@@ -0,0 +1,53 @@
+// SocketOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <optional>
+
+namespace ss {
+/**\brief profile of socket options. Every unset option keeps the kernel
+ * default. Options, which don't have sense for used protocol or platform
+ * (for example tcp options for unix sockets), are ignored
+ */
+struct SocketOptions {
+  /**\brief TCP_NODELAY for every session socket
+   */
+  std::optional<bool> noDelay;
+
+  /**\brief SO_RCVBUF and SO_SNDBUF in bytes. Set to acceptor (before listen,
+   * so the window scale is negotiated with the value) and to every session
+   * socket
+   */
+  std::optional<int> receiveBufferSize;
+  std::optional<int> sendBufferSize;
+
+  /**\brief TCP_QUICKACK for every session socket (linux only)
+   * \note kernel resets the option by itself, so it is applied again after
+   * every read
+   */
+  std::optional<bool> quickAck;
+
+  /**\brief TCP_DEFER_ACCEPT in seconds for acceptor (linux only): connection
+   * will be accepted only after first data from client
+   */
+  std::optional<int> deferAccept;
+
+  /**\brief TCP_FASTOPEN queue length for acceptor
+   */
+  std::optional<int> fastOpen;
+
+  /**\brief SO_BUSY_POLL in microseconds for every session socket (linux only)
+   */
+  std::optional<int> busyPoll;
+
+  /**\brief TCP_NOTSENT_LOWAT in bytes for every session socket
+   */
+  std::optional<int> notSentLowAt;
+
+  /**\brief backlog for listen. By default max_listen_connections
+   */
+  std::optional<int> listenBacklog;
+};
+} // namespace ss
@@ -0,0 +1,71 @@
+// ThreadPoolOptions.hpp
+/**\file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace ss {
+/**\brief profile of threads, which are started by the server itself.
+ * Sessions are run on separate I/O threads, every of them has own io_context,
+ * and accepted sessions are distributed between them by round-robin. So all
+ * buffers of a session are allocated and used by one thread, and with pinning
+ * they are allocated on NUMA node of the thread (first-touch policy). Context
+ * passed to ServerBuilder is used only for accepting
+ */
+struct ThreadPoolOptions {
+  /**\brief count of I/O threads. 0 means std::thread::hardware_concurrency
+   */
+  size_t ioThreads = 0;
+
+  /**\brief cpus for pinning I/O threads (linux only): i-th thread is pinned
+   * to `ioCpus[i % ioCpus.size()]`. Empty (default) means no pinning
+   */
+  std::vector<int> ioCpus;
+
+  /**\brief count of threads, which run context of ServerBuilder. 0 (default)
+   * means that the context is run by user
+   */
+  size_t acceptThreads = 0;
+
+  /**\brief same as ioCpus, but for accept threads
+   */
+  std::vector<int> acceptCpus;
+
+  /**\brief period of load balancing between I/O threads. Load of a thread is
+   * count of reads by its sessions for the period. If load of the busiest
+   * thread is rebalanceRatio times greater then load of the least loaded one,
+   * then one idle at the moment session is moved between them. Threads with
+   * load less then rebalanceMinLoad are not balanced, so sessions are not
+   * moved because of noise. 0 (default) interval disables balancing
+   */
+  std::chrono::milliseconds rebalanceInterval{0};
+  double                    rebalanceRatio   = 1.5;
+  size_t                    rebalanceMinLoad = 1000;
+};
+
+/**\brief state of I/O threads of the server
+ */
+struct ThreadPoolStats {
+  /**\brief count of opened sessions for every I/O thread
+   */
+  std::vector<size_t> sessions;
+
+  /**\brief load of every I/O thread for last balancing period
+   * \see ThreadPoolOptions::rebalanceInterval
+   */
+  std::vector<size_t> load;
+
+  /**\brief count of sessions, moved to other thread
+   */
+  size_t migrations = 0;
+
+  /**\brief count of migrations, which were not done, because the session was
+   * not idle
+   */
+  size_t failedMigrations = 0;
+};
+} // namespace ss
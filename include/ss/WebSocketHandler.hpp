@@ -0,0 +1,162 @@
+// WebSocketHandler.hpp
+/**\file
+ * WebSocket (RFC 6455) on top of the session. Session begins from HTTP
+ * upgrade handshake, after which the request buffer is parsed as frames.
+ *
+ * Frames are parsed incrementally: payload is unmasked directly from the
+ * request buffer to the message buffer as soon as it is readed, so big
+ * frames doesn't stay in the request buffer. Fragmented messages are
+ * assembled before calling of the handler, and control frames (ping, pong,
+ * close) are handled without the handler.
+ *
+ * \note text messages are not validated as UTF-8
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include "ss/HttpParser.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace ss {
+namespace ws {
+enum class Opcode : uint8_t {
+  Continuation = 0x0,
+  Text         = 0x1,
+  Binary       = 0x2,
+  Close        = 0x8,
+  Ping         = 0x9,
+  Pong         = 0xa,
+};
+
+enum CloseCode : uint16_t {
+  Normal          = 1000,
+  GoingAway       = 1001,
+  ProtocolError   = 1002,
+  NoStatusPresent = 1005, // close frame without status code
+  MessageTooBig   = 1009,
+  InternalError   = 1011,
+};
+
+constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+/**\brief append not masked (server) frame with the payload
+ */
+void appendFrame(std::string &output, Opcode opcode, std::string_view payload);
+
+/**\return not masked frame. Can be used for pushing of messages to clients
+ * by SessionHandle::send or Broadcaster::publish, so the same frame is shared
+ * between all subscribers
+ */
+std::string makeFrame(Opcode opcode, std::string_view payload);
+
+/**\brief XOR of the data with repeated 4-byte mask. Uses SIMD instructions,
+ * which are available for the target
+ */
+void unmask(char *      dst,
+            const char *src,
+            size_t      size,
+            const char *mask) noexcept;
+
+/**\return value of Sec-WebSocket-Accept header for the key
+ */
+std::string acceptKey(std::string_view key);
+
+/**\return true if the code can be sent in close frame (RFC 6455 7.4). Codes,
+ * which are reserved for local use (1005, 1006, 1015), not assigned codes of
+ * the protocol and codes out of range are not valid
+ */
+bool isValidCloseCode(uint16_t code) noexcept;
+} // namespace ws
+
+/**\brief base for WebSocket handlers
+ */
+class AbstractWebSocketHandler : public AbstractRequestHandler {
+public:
+  /**\brief called for upgrade request, before the handshake response
+   * \return false for rejecting of the upgrade, in this case the client gets
+   * 403 and the session will be closed
+   */
+  virtual bool
+  atUpgrade([[maybe_unused]] const http::Request &request) noexcept {
+    return true;
+  }
+
+  /**\brief handle complete (assembled from all fragments) message
+   * \param opcode Opcode::Text or Opcode::Binary
+   * \note the message is valid only until return
+   * \return error_code. If it is not success, then session will be closed
+   */
+  virtual error_code handleMessage(ws::Opcode       opcode,
+                                   std::string_view message) noexcept = 0;
+
+  error_code handle(std::string_view requestBuffer,
+                    ResponseInserter respIter,
+                    size_t &         reqIgnoreLength) noexcept final;
+
+protected:
+  /**\brief send message to the client. Can be used only inside of
+   * handleMessage or atUpgrade, for sending from other places use
+   * SessionHandle::send with ws::makeFrame
+   */
+  void send(ws::Opcode opcode, std::string_view payload);
+
+  /**\brief send close frame and close the session after write. Can be used
+   * only inside of handleMessage
+   */
+  void close(uint16_t code = ws::CloseCode::Normal);
+
+  /**\brief max size of assembled message. Bigger messages cause close of the
+   * session with MessageTooBig code
+   */
+  void setMaxMessageSize(size_t size) noexcept {
+    maxMessageSize_ = size;
+  }
+
+private:
+  enum class State {
+    Handshake,
+    Open,
+    Closed,
+  };
+
+  /**\brief handle the handshake request
+   * \return size of the request or 0 if it is not complete
+   */
+  size_t handshake(std::string_view requestBuffer);
+
+  /**\brief parse header of next frame
+   * \return size of the header or 0 if it is not complete
+   */
+  size_t parseFrameHeader(std::string_view data);
+
+  /**\brief handle frame, which payload is completely readed
+   */
+  error_code completeFrame();
+
+  void write(std::string_view data);
+
+private:
+  State                           state_ = State::Handshake;
+  std::optional<ResponseInserter> output_;
+  size_t maxMessageSize_ = ws::DEFAULT_MAX_MESSAGE_SIZE;
+
+  http::RequestParser parser_;
+  http::Request       request_;
+
+  // current frame
+  bool       inFrame_        = false;
+  ws::Opcode frameOpcode_    = ws::Opcode::Continuation;
+  bool       frameFin_       = false;
+  size_t     frameRemaining_ = 0;
+  char       mask_[4]        = {};
+  size_t     maskOffset_     = 0;
+
+  // current message
+  bool        fragmented_  = false;
+  ws::Opcode  messageType_ = ws::Opcode::Text;
+  std::string message_;
+  std::string control_;
+};
+} // namespace ss
@@ -12,7 +12,11 @@ using error_code = boost::system::error_code;
 namespace error {
 enum SessionError {
   Success = 0,
-  PartialData, // in buffer contains partial request
+  PartialData,   // in buffer contains partial request
+  QueueOverflow, // too many not writed bytes queued to the session
+  SessionClosed, // session already closed
+  RequestTooBig, // request buffer reached max size, but request still partial
+  CorruptedData, // compressed input of the session can not be decompressed
   Size,
 };
 
@@ -34,6 +38,14 @@ public:
       return "success";
     case SessionError::PartialData:
       return "partial data in request buffer";
+    case SessionError::QueueOverflow:
+      return "session output queue overflow";
+    case SessionError::SessionClosed:
+      return "session closed";
+    case SessionError::RequestTooBig:
+      return "request too big";
+    case SessionError::CorruptedData:
+      return "corrupted compressed data";
     default:
       return "Unkhnown error condition: " + std::to_string(ev);
     }
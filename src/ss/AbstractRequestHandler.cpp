@@ -0,0 +1,61 @@
+// AbstractRequestHandler.cpp
+
+#include "ss/AbstractRequestHandler.hpp"
+#include <atomic>
+#include <vector>
+
+namespace ss {
+namespace {
+struct ThreadContextSlot {
+  size_t        factoryId;
+  ThreadContext context;
+};
+
+/**\brief contexts of current thread. Usually there are one or two factories,
+ * so linear search is faster then any map
+ */
+thread_local std::vector<ThreadContextSlot> threadContexts;
+
+size_t nextFactoryId() noexcept {
+  static std::atomic<size_t> counter{0};
+  return ++counter;
+}
+} // namespace
+
+AbstractThreadContext *
+AbstractRequestHandler::currentThreadContext() const noexcept {
+  if (factory_ == nullptr) {
+    return nullptr;
+  }
+
+  return factory_->threadContext();
+}
+
+AbstractRequestHandlerFactory::AbstractRequestHandlerFactory() noexcept
+    : id_{nextFactoryId()} {
+}
+
+AbstractRequestHandlerFactory::AbstractRequestHandlerFactory(
+    const AbstractRequestHandlerFactory &) noexcept
+    : id_{nextFactoryId()} {
+}
+
+AbstractRequestHandlerFactory &AbstractRequestHandlerFactory::operator=(
+    const AbstractRequestHandlerFactory &) noexcept {
+  // every factory has own contexts, so id is not copied
+  return *this;
+}
+
+AbstractThreadContext *AbstractRequestHandlerFactory::threadContext() noexcept {
+  for (ThreadContextSlot &slot : threadContexts) {
+    if (slot.factoryId == id_) {
+      return slot.context.get();
+    }
+  }
+
+  ThreadContext          context = this->makeThreadContext();
+  AbstractThreadContext *retval  = context.get();
+  threadContexts.emplace_back(ThreadContextSlot{id_, std::move(context)});
+  return retval;
+}
+} // namespace ss
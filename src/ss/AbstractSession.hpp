@@ -0,0 +1,29 @@
+// AbstractSession.hpp
+
+#pragma once
+
+#include "ss/Broadcaster.hpp"
+#include "ss/errors.hpp"
+#include <string>
+
+namespace ss {
+/**\brief protocol independent interface of session, used by SessionHandle
+ */
+class AbstractSession {
+public:
+  virtual ~AbstractSession() = default;
+
+  virtual error_code push(std::string message) noexcept = 0;
+
+  /**\param coalesceKey if not 0 and policy is CoalesceLatest, then the
+   * message replaces previous not writed message with the same key
+   */
+  virtual error_code push(SharedBuffer       message,
+                          SlowConsumerPolicy policy,
+                          uint64_t           coalesceKey) noexcept = 0;
+
+  virtual void close() = 0;
+
+  virtual bool isOpen() const = 0;
+};
+} // namespace ss
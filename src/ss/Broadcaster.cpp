@@ -0,0 +1,160 @@
+// Broadcaster.cpp
+
+#include "ss/Broadcaster.hpp"
+#include "AbstractSession.hpp"
+#include <algorithm>
+#include <mutex>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+void Broadcaster::subscribe(std::string_view   topic,
+                            SessionHandle      session,
+                            SlowConsumerPolicy policy) {
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+
+  auto found = topics_.find(topic);
+  if (found == topics_.end()) {
+    found = topics_.emplace(std::string{topic}, Topic{}).first;
+    found->second.id = ++lastTopicId_;
+  }
+
+  std::vector<Subscriber> &subscribers = found->second.subscribers;
+  for (Subscriber &subscriber : subscribers) {
+    if (subscriber.session == session) {
+      subscriber.policy = policy;
+      return;
+    }
+  }
+
+  subscribers.emplace_back(Subscriber{std::move(session), policy});
+}
+
+void Broadcaster::unsubscribe(std::string_view     topic,
+                              const SessionHandle &session) {
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+
+  auto found = topics_.find(topic);
+  if (found == topics_.end()) {
+    return;
+  }
+
+  std::vector<Subscriber> &subscribers = found->second.subscribers;
+  subscribers.erase(std::remove_if(subscribers.begin(),
+                                   subscribers.end(),
+                                   [&session](const Subscriber &subscriber) {
+                                     return subscriber.session == session;
+                                   }),
+                    subscribers.end());
+
+  if (subscribers.empty()) {
+    topics_.erase(found);
+  }
+}
+
+void Broadcaster::unsubscribe(const SessionHandle &session) {
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+
+  for (auto iter = topics_.begin(); iter != topics_.end();) {
+    std::vector<Subscriber> &subscribers = iter->second.subscribers;
+    subscribers.erase(std::remove_if(subscribers.begin(),
+                                     subscribers.end(),
+                                     [&session](const Subscriber &subscriber) {
+                                       return subscriber.session == session;
+                                     }),
+                      subscribers.end());
+
+    if (subscribers.empty()) {
+      iter = topics_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+size_t Broadcaster::publish(std::string_view topic, SharedBuffer message) {
+  if (message == nullptr) {
+    LOG_THROW(std::invalid_argument, "invalid message");
+  }
+
+  size_t queued     = 0;
+  bool   hasClosed  = false;
+  size_t overflowed = 0;
+  {
+    std::shared_lock<std::shared_mutex> lock{mutex_};
+
+    auto found = topics_.find(topic);
+    if (found == topics_.end()) {
+      return 0;
+    }
+
+    uint64_t coalesceKey = found->second.id;
+    for (const Subscriber &subscriber : found->second.subscribers) {
+      std::shared_ptr<AbstractSession> session =
+          subscriber.session.session_.lock();
+      if (session == nullptr || session->isOpen() == false) {
+        hasClosed = true;
+        continue;
+      }
+
+      error_code err = session->push(message, subscriber.policy, coalesceKey);
+      if (err.failed()) {
+        ++overflowed;
+        continue;
+      }
+
+      ++queued;
+    }
+  }
+
+  if (overflowed != 0) {
+    LOG_DEBUG("message for topic %1% not queued to %2% slow subscribers",
+              topic,
+              overflowed);
+  }
+
+  if (hasClosed) {
+    this->removeClosedSubscribers(topic);
+  }
+
+  return queued;
+}
+
+size_t Broadcaster::publish(std::string_view topic, std::string message) {
+  return this->publish(
+      topic,
+      std::make_shared<const std::string>(std::move(message)));
+}
+
+size_t Broadcaster::subscribersCount(std::string_view topic) const {
+  std::shared_lock<std::shared_mutex> lock{mutex_};
+
+  auto found = topics_.find(topic);
+  if (found == topics_.end()) {
+    return 0;
+  }
+
+  return found->second.subscribers.size();
+}
+
+void Broadcaster::removeClosedSubscribers(std::string_view topic) {
+  std::unique_lock<std::shared_mutex> lock{mutex_};
+
+  auto found = topics_.find(topic);
+  if (found == topics_.end()) {
+    return;
+  }
+
+  std::vector<Subscriber> &subscribers = found->second.subscribers;
+  subscribers.erase(std::remove_if(subscribers.begin(),
+                                   subscribers.end(),
+                                   [](const Subscriber &subscriber) {
+                                     return subscriber.session.isOpen() ==
+                                            false;
+                                   }),
+                    subscribers.end());
+
+  if (subscribers.empty()) {
+    topics_.erase(found);
+  }
+}
+} // namespace ss
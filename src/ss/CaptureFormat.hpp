@@ -0,0 +1,117 @@
+// CaptureFormat.hpp
+/**\file
+ * Binary format of captured requests. File starts with CAPTURE_MAGIC, then
+ * records follow. Every record is:
+ * - type (1 byte, see RecordType)
+ * - id of connection (varint)
+ * - time since start of capture in microseconds (varint)
+ * - for Data records only: size (varint) and bytes of the chunk
+ *
+ * Varints are LEB128, so small values take single byte
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+
+namespace ss {
+namespace capture {
+constexpr std::string_view CAPTURE_MAGIC{"sscap001", 8};
+
+/**\brief max size of Data record. Every record is single read of a session,
+ * so bigger size means that the file is broken
+ */
+constexpr uint64_t MAX_DATA_SIZE = 16 * 1024 * 1024;
+
+enum class RecordType : uint8_t {
+  Open = 1,
+  Data,
+  Close,
+};
+
+struct Record {
+  RecordType  type;
+  uint32_t    connection;
+  uint64_t    time;
+  std::string data;
+};
+
+inline void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+inline bool readVarint(std::istream &in, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = in.get();
+    if (byte == std::istream::traits_type::eof()) {
+      return false;
+    }
+
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**\brief serialize the record to end of out
+ */
+inline void writeRecord(std::string &    out,
+                        RecordType       type,
+                        uint32_t         connection,
+                        uint64_t         time,
+                        std::string_view data = {}) {
+  out.push_back(static_cast<char>(type));
+  writeVarint(out, connection);
+  writeVarint(out, time);
+  if (type == RecordType::Data) {
+    writeVarint(out, data.size());
+    out.append(data);
+  }
+}
+
+/**\return false at end of the stream or if the record is broken
+ */
+inline bool readRecord(std::istream &in, Record &record) {
+  int type = in.get();
+  if (type == std::istream::traits_type::eof() ||
+      type < static_cast<int>(RecordType::Open) ||
+      type > static_cast<int>(RecordType::Close)) {
+    return false;
+  }
+  record.type = static_cast<RecordType>(type);
+
+  uint64_t connection = 0;
+  if (readVarint(in, connection) == false ||
+      readVarint(in, record.time) == false) {
+    return false;
+  }
+  record.connection = static_cast<uint32_t>(connection);
+
+  record.data.clear();
+  if (record.type == RecordType::Data) {
+    uint64_t size = 0;
+    if (readVarint(in, size) == false || size > MAX_DATA_SIZE) {
+      return false;
+    }
+
+    record.data.resize(size);
+    if (in.read(record.data.data(), size).gcount() !=
+        static_cast<std::streamsize>(size)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace capture
+} // namespace ss
@@ -0,0 +1,56 @@
+// CaptureWriter.cpp
+
+#include "CaptureWriter.hpp"
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+CaptureWriter::CaptureWriter(const std::string &path)
+    : file_{path, std::ios::binary | std::ios::trunc}
+    , start_{std::chrono::steady_clock::now()} {
+  if (file_.is_open() == false) {
+    LOG_THROW(std::runtime_error, "can not open capture file: %1%", path);
+  }
+
+  file_.write(capture::CAPTURE_MAGIC.data(), capture::CAPTURE_MAGIC.size());
+}
+
+CaptureWriter::~CaptureWriter() {
+  file_.flush();
+}
+
+uint32_t CaptureWriter::open() noexcept {
+  uint32_t connection = nextConnection_++;
+  this->write(capture::RecordType::Open, connection);
+  return connection;
+}
+
+void CaptureWriter::data(uint32_t connection, std::string_view data) noexcept {
+  this->write(capture::RecordType::Data, connection, data);
+}
+
+void CaptureWriter::close(uint32_t connection) noexcept {
+  this->write(capture::RecordType::Close, connection);
+}
+
+void CaptureWriter::write(capture::RecordType type,
+                          uint32_t            connection,
+                          std::string_view    data) noexcept {
+  try {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start_)
+                        .count();
+
+    record_.clear();
+    capture::writeRecord(record_, type, connection, time, data);
+    file_.write(record_.data(), record_.size());
+    if (file_.fail()) {
+      LOG_ERROR("can not write to capture file");
+      file_.clear();
+    }
+  } catch (std::exception &e) {
+    LOG_ERROR(e.what());
+  }
+}
+} // namespace ss
@@ -0,0 +1,47 @@
+// CaptureWriter.hpp
+
+#pragma once
+
+#include "CaptureFormat.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace ss {
+/**\brief writes requests of all sessions of a server to capture file
+ * \see CaptureFormat.hpp
+ * \note thread-safe
+ */
+class CaptureWriter final {
+public:
+  /**\throw std::runtime_error if the file can not be opened
+   */
+  explicit CaptureWriter(const std::string &path);
+
+  ~CaptureWriter();
+
+  /**\return id of new connection
+   */
+  uint32_t open() noexcept;
+
+  void data(uint32_t connection, std::string_view data) noexcept;
+
+  void close(uint32_t connection) noexcept;
+
+private:
+  void write(capture::RecordType type,
+             uint32_t            connection,
+             std::string_view    data = {}) noexcept;
+
+private:
+  std::mutex                            mutex_;
+  std::ofstream                         file_;
+  std::string                           record_;
+  std::chrono::steady_clock::time_point start_;
+  std::atomic<uint32_t>                 nextConnection_{0};
+};
+
+using CaptureWriterPtr = std::shared_ptr<CaptureWriter>;
+} // namespace ss
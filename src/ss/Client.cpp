@@ -0,0 +1,675 @@
+// Client.cpp
+
+#include "ss/Client.hpp"
+#include "RawSocketOption.hpp"
+#include "RequestBuffer.hpp"
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <regex>
+#include <simple_logs/logs.hpp>
+#include <sstream>
+#include <vector>
+
+namespace ss {
+using tcp             = asio::ip::tcp;
+using stream_protocol = asio::local::stream_protocol;
+
+using ResponseCallback = Client::ResponseCallback;
+
+
+/**\brief counters, shared by all connections of a client
+ */
+struct ClientCounters {
+  std::atomic<size_t> connected{0};
+  std::atomic<size_t> requests{0};
+  std::atomic<size_t> rejected{0};
+  std::atomic<size_t> responses{0};
+  std::atomic<size_t> failed{0};
+  std::atomic<size_t> reconnects{0};
+};
+
+using ClientCountersPtr = std::shared_ptr<ClientCounters>;
+
+
+class AbstractClientConnection {
+public:
+  virtual ~AbstractClientConnection() = default;
+
+  virtual void connect() noexcept = 0;
+
+  virtual void close() noexcept = 0;
+
+  /**\brief queue the request and its callback. The callback is moved only if
+   * the request is accepted
+   */
+  virtual error_code request(std::string &     request,
+                             ResponseCallback &callback) noexcept = 0;
+
+  /**\return true if the connection is connected or connecting
+   */
+  virtual bool usable() const noexcept = 0;
+
+  virtual size_t inFlight() const noexcept = 0;
+};
+
+using ClientConnectionPtr = std::shared_ptr<AbstractClientConnection>;
+
+
+/**\brief one connection of the pool. Requests are queued from any thread
+ * under the lock, and all socket operations are done in the strand of the
+ * connection. Requests, queued while previous write is in progress, are
+ * written by one write after it, so pipelined requests are batched
+ */
+template <typename Protocol>
+class ClientConnection final
+    : public AbstractClientConnection
+    , public std::enable_shared_from_this<ClientConnection<Protocol>> {
+public:
+  using Endpoint = typename Protocol::endpoint;
+  using Socket   = asio::basic_stream_socket<Protocol>;
+  using Strand   = asio::strand<asio::io_context::executor_type>;
+
+  ClientConnection(asio::io_context &    ioContext,
+                   Endpoint              endpoint,
+                   RequestHandlerFactory resHandlerFactory,
+                   const ClientOptions & options,
+                   const SocketOptions & socketOptions,
+                   ClientCountersPtr     counters)
+      : strand_{asio::make_strand(ioContext)}
+      , socket_{strand_}
+      , reconnectTimer_{strand_}
+      , endpoint_{std::move(endpoint)}
+      , resHandlerFactory_{std::move(resHandlerFactory)}
+      , options_{options}
+      , socketOptions_{socketOptions}
+      , counters_{std::move(counters)}
+      , resBuffer_{options.maxResponseSize} {
+  }
+
+  void connect() noexcept override {
+    {
+      // requests are accepted right after return, before the connection
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (state_ == State::Closed) {
+        return;
+      }
+      state_ = State::Connecting;
+    }
+
+    asio::post(strand_, [self = this->shared_from_this()]() {
+      self->startConnecting();
+    });
+  }
+
+  void close() noexcept override {
+    asio::post(strand_, [self = this->shared_from_this()]() {
+      {
+        std::lock_guard<std::mutex> lock{self->mutex_};
+        self->state_ = State::Closed;
+      }
+
+      self->reconnectTimer_.cancel();
+      self->fail(error::make_error_code(error::SessionError::SessionClosed));
+    });
+  }
+
+  error_code request(std::string &     request,
+                     ResponseCallback &callback) noexcept override {
+    bool scheduleWrite = false;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (state_ != State::Connecting && state_ != State::Connected) {
+        return error::make_error_code(error::SessionError::SessionClosed);
+      }
+      if (callbacks_.size() >= options_.maxInFlight) {
+        return error::make_error_code(error::SessionError::QueueOverflow);
+      }
+
+      output_.append(request);
+      callbacks_.emplace_back(std::move(callback));
+      inFlight_.store(callbacks_.size(), std::memory_order_relaxed);
+
+      if (writeScheduled_ == false) {
+        writeScheduled_ = true;
+        scheduleWrite   = true;
+      }
+    }
+
+    if (scheduleWrite) {
+      asio::post(strand_, [self = this->shared_from_this()]() {
+        self->write();
+      });
+    }
+    return error_code{};
+  }
+
+  bool usable() const noexcept override {
+    State state = state_.load(std::memory_order_relaxed);
+    return state == State::Connecting || state == State::Connected;
+  }
+
+  size_t inFlight() const noexcept override {
+    return inFlight_.load(std::memory_order_relaxed);
+  }
+
+private:
+  enum class State { Disconnected, Connecting, Connected, Closed };
+
+  void startConnecting() noexcept {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (state_ == State::Closed) {
+        return;
+      }
+      state_ = State::Connecting;
+    }
+
+    // completions of previous connection must be ignored
+    ++generation_;
+
+    resHandler_           = resHandlerFactory_->makeRequestHandler();
+    resHandler_->factory_ = resHandlerFactory_;
+
+    LOG_DEBUG("connect to %1%", endpoint_);
+    socket_.async_connect(endpoint_,
+                          [self       = this->shared_from_this(),
+                           generation = generation_](error_code err) {
+                            if (generation == self->generation_) {
+                              self->atConnect(err);
+                            }
+                          });
+  }
+
+  void atConnect(error_code err) noexcept {
+    if (err.failed()) {
+      LOG_WARNING("can not connect to %1%: %2%", endpoint_, err.message());
+      this->fail(err);
+      return;
+    }
+
+    applySessionSocketOptions<Protocol>(socket_, socketOptions_);
+
+    std::stringstream remoteEndpoint;
+    remoteEndpoint << endpoint_;
+    err = resHandler_->atSessionStart(remoteEndpoint.str());
+    if (err.failed()) {
+      LOG_ERROR(err.message());
+      LOG_WARNING("connection doesn't start, because get handler error");
+      this->fail(err);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      state_ = State::Connected;
+    }
+    started_ = true;
+    ++counters_->connected;
+
+    LOG_DEBUG("connected to %1%", endpoint_);
+
+    this->read();
+    this->write();
+  }
+
+  void read() noexcept {
+    socket_.async_read_some(
+        resBuffer_.prepare(),
+        [self = this->shared_from_this(),
+         generation = generation_](error_code err, size_t readed) {
+          if (generation == self->generation_) {
+            self->atRead(err, readed);
+          }
+        });
+  }
+
+  void atRead(error_code err, size_t readed) noexcept {
+    if (err.failed()) {
+      this->fail(err);
+      return;
+    }
+
+    resBuffer_.commit(readed);
+
+    err = this->handleResponses();
+    if (err.failed()) {
+      this->fail(err);
+      return;
+    }
+
+    this->read();
+  }
+
+  /**\brief same loop as handling of requests by session, but every
+   * successful call of the handler completes the oldest request
+   */
+  error_code handleResponses() {
+    while (resBuffer_.empty() == false) {
+      response_.clear();
+
+      size_t     resIgnoreLength = 0;
+      error_code err             = resHandler_->handle(resBuffer_.data(),
+                                           std::back_inserter(response_),
+                                           resIgnoreLength);
+
+      if (err == error::SessionError::PartialData) {
+        resBuffer_.consume(resIgnoreLength);
+
+        if (resBuffer_.full()) {
+          LOG_WARNING("response buffer overflow, close connection");
+          return error::make_error_code(error::SessionError::RequestTooBig);
+        }
+        return error_code{};
+      }
+
+      if (err.failed()) {
+        return err;
+      }
+
+      this->complete();
+
+      if (resIgnoreLength == 0 || resIgnoreLength >= resBuffer_.size()) {
+        resBuffer_.clear();
+      } else {
+        resBuffer_.consume(resIgnoreLength);
+      }
+    }
+
+    return error_code{};
+  }
+
+  void complete() noexcept {
+    ResponseCallback callback;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (callbacks_.empty()) {
+        LOG_WARNING("response without request, ignore it");
+        return;
+      }
+
+      callback = std::move(callbacks_.front());
+      callbacks_.pop_front();
+      inFlight_.store(callbacks_.size(), std::memory_order_relaxed);
+    }
+
+    ++counters_->responses;
+    callback(error_code{}, response_);
+  }
+
+  void write() noexcept {
+    if (writing_) {
+      // will be called again after the write
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      writeScheduled_ = false;
+      if (state_ != State::Connected || output_.empty()) {
+        return;
+      }
+
+      std::swap(output_, writeBuffer_);
+    }
+
+    writing_ = true;
+    asio::async_write(socket_,
+                      asio::buffer(writeBuffer_),
+                      [self       = this->shared_from_this(),
+                       generation = generation_](error_code err, size_t) {
+                        if (generation == self->generation_) {
+                          self->atWrite(err);
+                        }
+                      });
+  }
+
+  void atWrite(error_code err) noexcept {
+    writing_ = false;
+    if (err.failed()) {
+      this->fail(err);
+      return;
+    }
+
+    writeBuffer_.clear();
+    this->write();
+  }
+
+  /**\brief close the socket and complete all not responded requests with the
+   * error. If the connection is not closed by user, then it is reconnected
+   * after delay
+   */
+  void fail(error_code err) noexcept {
+    bool                         closed = false;
+    std::deque<ResponseCallback> callbacks;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (state_ == State::Closed) {
+        closed = true;
+      } else {
+        state_ = State::Disconnected;
+      }
+
+      callbacks.swap(callbacks_);
+      output_.clear();
+      inFlight_.store(0, std::memory_order_relaxed);
+    }
+
+    // all pending operations of the socket are ignored since the moment
+    ++generation_;
+
+    error_code closeErr;
+    socket_.close(closeErr);
+    writing_ = false;
+    writeBuffer_.clear();
+    resBuffer_.clear();
+
+    if (started_) {
+      started_ = false;
+      --counters_->connected;
+      resHandler_->atSessionClose();
+
+      LOG_DEBUG("disconnected from %1%: %2%", endpoint_, err.message());
+    }
+
+    counters_->failed += callbacks.size();
+    for (ResponseCallback &callback : callbacks) {
+      callback(err, std::string_view{});
+    }
+
+    if (closed) {
+      return;
+    }
+
+    reconnectTimer_.expires_after(options_.reconnectDelay);
+    reconnectTimer_.async_wait(
+        [self = this->shared_from_this()](error_code timerErr) {
+          if (timerErr.failed()) {
+            return;
+          }
+
+          ++self->counters_->reconnects;
+          self->startConnecting();
+        });
+  }
+
+private:
+  Strand             strand_;
+  Socket             socket_;
+  asio::steady_timer reconnectTimer_;
+
+  Endpoint              endpoint_;
+  RequestHandlerFactory resHandlerFactory_;
+  RequestHandler        resHandler_;
+  ClientOptions         options_;
+  SocketOptions         socketOptions_;
+  ClientCountersPtr     counters_;
+
+  // guards state of the connection and queued requests
+  mutable std::mutex           mutex_;
+  std::atomic<State>           state_{State::Disconnected};
+  std::string                  output_;
+  std::deque<ResponseCallback> callbacks_;
+  bool                         writeScheduled_ = false;
+  std::atomic<size_t>          inFlight_{0};
+
+  // used only in the strand
+  size_t        generation_ = 0;
+  bool          started_    = false;
+  bool          writing_    = false;
+  std::string   writeBuffer_;
+  RequestBuffer resBuffer_;
+  std::string   response_;
+};
+
+
+class ClientImpl {
+public:
+  ClientImpl(std::vector<ClientConnectionPtr> connections,
+             ClientCountersPtr                counters) noexcept
+      : connections_{std::move(connections)}
+      , counters_{std::move(counters)} {
+  }
+
+  void connect() noexcept {
+    for (const ClientConnectionPtr &connection : connections_) {
+      connection->connect();
+    }
+  }
+
+  void close() noexcept {
+    for (const ClientConnectionPtr &connection : connections_) {
+      connection->close();
+    }
+  }
+
+  error_code request(std::string &request, ResponseCallback &callback) {
+    // scan starts from different connections, so equally loaded connections
+    // are used in turn
+    size_t count = connections_.size();
+    size_t first = next_.fetch_add(1, std::memory_order_relaxed);
+
+    AbstractClientConnection *chosen = nullptr;
+    size_t chosenInFlight            = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < count; ++i) {
+      AbstractClientConnection &connection =
+          *connections_[(first + i) % count];
+      if (connection.usable() == false) {
+        continue;
+      }
+
+      size_t inFlight = connection.inFlight();
+      if (inFlight < chosenInFlight) {
+        chosen         = &connection;
+        chosenInFlight = inFlight;
+      }
+    }
+
+    error_code err =
+        chosen == nullptr
+            ? error::make_error_code(error::SessionError::SessionClosed)
+            : chosen->request(request, callback);
+    if (err.failed()) {
+      ++counters_->rejected;
+    } else {
+      ++counters_->requests;
+    }
+    return err;
+  }
+
+  ClientStats stats() const noexcept {
+    ClientStats retval;
+    retval.connected  = counters_->connected;
+    retval.requests   = counters_->requests;
+    retval.rejected   = counters_->rejected;
+    retval.responses  = counters_->responses;
+    retval.failed     = counters_->failed;
+    retval.reconnects = counters_->reconnects;
+
+    for (const ClientConnectionPtr &connection : connections_) {
+      retval.inFlight += connection->inFlight();
+    }
+    return retval;
+  }
+
+private:
+  std::vector<ClientConnectionPtr> connections_;
+  ClientCountersPtr                counters_;
+  std::atomic<size_t>              next_{0};
+};
+
+
+template <typename Protocol>
+std::vector<ClientConnectionPtr>
+makeConnections(asio::io_context &           ioContext,
+                typename Protocol::endpoint  endpoint,
+                const RequestHandlerFactory &resHandlerFactory,
+                const ClientOptions &        options,
+                const SocketOptions &        socketOptions,
+                const ClientCountersPtr &    counters) {
+  std::vector<ClientConnectionPtr> retval;
+  retval.reserve(options.connections);
+  for (size_t i = 0; i < options.connections; ++i) {
+    retval.emplace_back(
+        std::make_shared<ClientConnection<Protocol>>(ioContext,
+                                                     endpoint,
+                                                     resHandlerFactory,
+                                                     options,
+                                                     socketOptions,
+                                                     counters));
+  }
+  return retval;
+}
+
+
+Client::~Client() {
+  if (impl_ != nullptr) {
+    impl_->close();
+  }
+}
+
+Client &Client::asyncConnect() {
+  impl_->connect();
+  return *this;
+}
+
+Client &Client::close() {
+  impl_->close();
+  return *this;
+}
+
+error_code Client::asyncRequest(std::string      request,
+                                ResponseCallback callback) noexcept {
+  return impl_->request(request, callback);
+}
+
+ClientStats Client::stats() const noexcept {
+  return impl_->stats();
+}
+
+
+ClientBuilder::ClientBuilder(asio::io_context &ioContext)
+    : ioContext_{ioContext} {
+}
+
+ClientBuilder &
+ClientBuilder::setResponseHandlerFactory(RequestHandlerFactory factory) {
+  resHandlerFactory_ = std::move(factory);
+  return *this;
+}
+
+ClientBuilder &ClientBuilder::setEndpoint(Server::Protocol protocol,
+                                          std::string_view endpoint) {
+  protocol_ = protocol;
+  endpoint_ = endpoint;
+  return *this;
+}
+
+ClientBuilder &ClientBuilder::setConnections(size_t count) {
+  if (count == 0) {
+    LOG_THROW(std::invalid_argument, "client must have connections");
+  }
+
+  clientOptions_.connections = count;
+  return *this;
+}
+
+ClientBuilder &ClientBuilder::setMaxInFlight(size_t count) {
+  if (count == 0) {
+    LOG_THROW(std::invalid_argument, "max in flight requests can not be 0");
+  }
+
+  clientOptions_.maxInFlight = count;
+  return *this;
+}
+
+ClientBuilder &ClientBuilder::setMaxResponseSize(size_t bytes) {
+  clientOptions_.maxResponseSize = bytes;
+  return *this;
+}
+
+ClientBuilder &
+ClientBuilder::setReconnectDelay(std::chrono::milliseconds delay) {
+  clientOptions_.reconnectDelay = delay;
+  return *this;
+}
+
+ClientBuilder &ClientBuilder::setSocketOptions(SocketOptions options) {
+  socketOptions_ = std::move(options);
+  return *this;
+}
+
+ClientPtr ClientBuilder::build() const {
+  if (resHandlerFactory_ == nullptr) {
+    LOG_THROW(std::invalid_argument, "invalid response handler factory");
+  }
+
+
+  ClientCountersPtr counters = std::make_shared<ClientCounters>();
+
+  std::vector<ClientConnectionPtr> connections;
+  switch (protocol_) {
+  case Server::Protocol::Tcp: {
+    std::regex  hostAndPortReg{R"(([^:]+):(\d{1,5}))"};
+    std::smatch match;
+
+    if (std::regex_match(endpoint_, match, hostAndPortReg) == false) {
+      LOG_THROW(std::invalid_argument, "invalid host or port");
+    }
+
+    std::string host = match[1];
+    std::string port = match[2];
+
+
+    error_code    err;
+    tcp::resolver resolver{ioContext_};
+    auto          results = resolver.resolve(host, port, err);
+    if (err.failed() || results.empty()) {
+      LOG_THROW(std::invalid_argument,
+                "can not resolve %1%: %2%",
+                host,
+                err.message());
+    }
+
+    tcp::endpoint endpoint = results.begin()->endpoint();
+
+    LOG_DEBUG("client endpoint: %1%", endpoint);
+
+
+    connections = makeConnections<tcp>(ioContext_,
+                                       endpoint,
+                                       resHandlerFactory_,
+                                       clientOptions_,
+                                       socketOptions_,
+                                       counters);
+  } break;
+  case Server::Protocol::Unix: {
+    stream_protocol::endpoint endpoint{endpoint_};
+
+    LOG_DEBUG("client endpoint: %1%", endpoint);
+
+
+    connections = makeConnections<stream_protocol>(ioContext_,
+                                                   endpoint,
+                                                   resHandlerFactory_,
+                                                   clientOptions_,
+                                                   socketOptions_,
+                                                   counters);
+  } break;
+  }
+
+
+  ClientPtr retval = std::make_shared<Client>(Client{});
+  retval->impl_ =
+      std::make_shared<ClientImpl>(std::move(connections), std::move(counters));
+
+  return retval;
+}
+} // namespace ss
@@ -0,0 +1,440 @@
+// Hpack.cpp
+
+#include "ss/Hpack.hpp"
+#include <algorithm>
+#include <array>
+
+namespace ss {
+namespace hpack {
+namespace {
+struct StaticEntry {
+  std::string_view name;
+  std::string_view value;
+};
+
+/**\brief RFC 7541, Appendix A. Index of the entry is position + 1
+ */
+constexpr StaticEntry STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+constexpr size_t STATIC_TABLE_SIZE = std::size(STATIC_TABLE);
+
+/**\brief overhead of every entry in dynamic table, RFC 7541, 4.1
+ */
+constexpr size_t ENTRY_OVERHEAD = 32;
+
+constexpr size_t HUFFMAN_SYMBOLS  = 257;
+constexpr size_t HUFFMAN_EOS      = 256;
+constexpr size_t HUFFMAN_MAX_CODE = 30;
+
+/**\brief lengths of huffman codes for every symbol, RFC 7541, Appendix B.
+ * The code is canonical, so codes are restored from the lengths
+ */
+constexpr uint8_t HUFFMAN_CODE_LENGTHS[HUFFMAN_SYMBOLS] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+
+/**\brief tables for decoding of canonical huffman code: codes of the same
+ * length are consecutive numbers, and symbols with the same code length are
+ * sorted
+ */
+struct HuffmanTables {
+  HuffmanTables() noexcept {
+    size_t index = 0;
+    for (size_t length = 1; length <= HUFFMAN_MAX_CODE; ++length) {
+      firstIndex[length] = index;
+      for (size_t symbol = 0; symbol < HUFFMAN_SYMBOLS; ++symbol) {
+        if (HUFFMAN_CODE_LENGTHS[symbol] == length) {
+          symbols[index++] = static_cast<uint16_t>(symbol);
+        }
+      }
+      count[length] = index - firstIndex[length];
+    }
+
+    uint32_t code = 0;
+    for (size_t length = 1; length <= HUFFMAN_MAX_CODE; ++length) {
+      firstCode[length] = code;
+      code              = (code + count[length]) << 1;
+    }
+  }
+
+  std::array<uint16_t, HUFFMAN_SYMBOLS>      symbols{};
+  std::array<uint32_t, HUFFMAN_MAX_CODE + 1> firstCode{};
+  std::array<size_t, HUFFMAN_MAX_CODE + 1>   firstIndex{};
+  std::array<size_t, HUFFMAN_MAX_CODE + 1>   count{};
+};
+
+const HuffmanTables huffmanTables;
+
+/**\return false if the integer is not complete or too big
+ */
+bool decodeInteger(std::string_view &input, int prefixBits, size_t &value) {
+  if (input.empty()) {
+    return false;
+  }
+
+  size_t mask = (1 << prefixBits) - 1;
+  value       = static_cast<uint8_t>(input.front()) & mask;
+  input.remove_prefix(1);
+  if (value < mask) {
+    return true;
+  }
+
+  for (int shift = 0; input.empty() == false; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(input.front());
+    input.remove_prefix(1);
+
+    // values, used by HTTP/2, are much less then 2^28
+    if (shift > 21) {
+      return false;
+    }
+
+    value += static_cast<size_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**\param buffer used for huffman decoded strings
+ */
+bool decodeString(std::string_view &input,
+                  std::string &     buffer,
+                  std::string_view &str) {
+  if (input.empty()) {
+    return false;
+  }
+
+  bool   huffman = input.front() & 0x80;
+  size_t length  = 0;
+  if (decodeInteger(input, 7, length) == false || length > input.size()) {
+    return false;
+  }
+
+  str = input.substr(0, length);
+  input.remove_prefix(length);
+
+  if (huffman) {
+    buffer.clear();
+    if (huffmanDecode(str, buffer) == false) {
+      return false;
+    }
+    str = buffer;
+  }
+  return true;
+}
+
+void encodeString(std::string &output, std::string_view str) {
+  encodeInteger(output, 0x00, 7, str.size());
+  output.append(str);
+}
+} // namespace
+
+std::string_view HeaderList::find(std::string_view name) const noexcept {
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    if (this->name(i) == name) {
+      return this->value(i);
+    }
+  }
+  return std::string_view{};
+}
+
+void HeaderList::add(std::string_view name, std::string_view value) {
+  size_t offset = storage_.size();
+  storage_.append(name);
+  storage_.append(value);
+  fields_.emplace_back(
+      Field{offset, name.size(), offset + name.size(), value.size()});
+}
+
+bool Decoder::decode(std::string_view block,
+                     HeaderList &     headers,
+                     size_t           maxListSize) {
+  bool headerDecoded = false;
+  while (block.empty() == false) {
+    uint8_t first = static_cast<uint8_t>(block.front());
+
+    std::string_view name;
+    std::string_view value;
+    size_t           index = 0;
+
+    if (first & 0x80) {
+      // indexed header field
+      if (decodeInteger(block, 7, index) == false || index == 0 ||
+          this->get(index, name, value) == false) {
+        return false;
+      }
+    } else if ((first & 0xe0) == 0x20) {
+      // dynamic table size update, allowed only at begin of block
+      size_t size = 0;
+      if (headerDecoded || decodeInteger(block, 5, size) == false ||
+          size > maxTableSize_) {
+        return false;
+      }
+
+      tableSizeLimit_ = size;
+      this->evict(tableSizeLimit_);
+      continue;
+    } else {
+      // literal: with incremental indexing (01), without indexing (0000) or
+      // never indexed (0001)
+      bool indexing   = (first & 0xc0) == 0x40;
+      int  prefixBits = indexing ? 6 : 4;
+      if (decodeInteger(block, prefixBits, index) == false) {
+        return false;
+      }
+
+      if (index == 0) {
+        if (decodeString(block, name_, name) == false) {
+          return false;
+        }
+      } else {
+        std::string_view unused;
+        if (this->get(index, name, unused) == false) {
+          return false;
+        }
+      }
+
+      // name can point to dynamic table, which can be changed by insert, so
+      // it must be copied before
+      if (indexing && index != 0) {
+        name_.assign(name);
+        name = name_;
+      }
+
+      if (decodeString(block, value_, value) == false) {
+        return false;
+      }
+
+      if (indexing) {
+        headers.add(name, value);
+        this->insert(name, value);
+        headerDecoded = true;
+        if (headers.listSize() > maxListSize) {
+          return false;
+        }
+        continue;
+      }
+    }
+
+    headers.add(name, value);
+    headerDecoded = true;
+    if (headers.listSize() > maxListSize) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Decoder::get(size_t            index,
+                  std::string_view &name,
+                  std::string_view &value) const {
+  if (index == 0) {
+    return false;
+  }
+
+  if (index <= STATIC_TABLE_SIZE) {
+    name  = STATIC_TABLE[index - 1].name;
+    value = STATIC_TABLE[index - 1].value;
+    return true;
+  }
+
+  index -= STATIC_TABLE_SIZE + 1;
+  if (index >= table_.size()) {
+    return false;
+  }
+
+  name  = table_[index].name;
+  value = table_[index].value;
+  return true;
+}
+
+void Decoder::insert(std::string_view name, std::string_view value) {
+  size_t size = name.size() + value.size() + ENTRY_OVERHEAD;
+  if (size > tableSizeLimit_) {
+    // too big entry clears the table
+    this->evict(0);
+    return;
+  }
+
+  this->evict(tableSizeLimit_ - size);
+  table_.emplace_front(Entry{std::string{name}, std::string{value}});
+  tableSize_ += size;
+}
+
+void Decoder::evict(size_t limit) {
+  while (tableSize_ > limit) {
+    const Entry &entry = table_.back();
+    tableSize_ -= entry.name.size() + entry.value.size() + ENTRY_OVERHEAD;
+    table_.pop_back();
+  }
+}
+
+void encodeInteger(std::string &output,
+                   uint8_t      firstBits,
+                   int          prefixBits,
+                   size_t       value) {
+  size_t mask = (1 << prefixBits) - 1;
+  if (value < mask) {
+    output.push_back(static_cast<char>(firstBits | value));
+    return;
+  }
+
+  output.push_back(static_cast<char>(firstBits | mask));
+  value -= mask;
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+void encodeHeader(std::string &    output,
+                  std::string_view name,
+                  std::string_view value) {
+  // literal header field without indexing, with indexed name if the name is
+  // in static table
+  for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+    if (STATIC_TABLE[i].name == name) {
+      encodeInteger(output, 0x00, 4, i + 1);
+      encodeString(output, value);
+      return;
+    }
+  }
+
+  encodeInteger(output, 0x00, 4, 0);
+  encodeString(output, name);
+  encodeString(output, value);
+}
+
+void encodeStatus(std::string &output, unsigned status) {
+  char   buffer[3];
+  size_t size = 0;
+  for (unsigned divider = 100; divider != 0; divider /= 10) {
+    buffer[size++] = static_cast<char>('0' + status / divider % 10);
+  }
+  std::string_view str{buffer, size};
+
+  // indexed representation for statuses from static table
+  for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+    if (STATIC_TABLE[i].name == ":status" && STATIC_TABLE[i].value == str) {
+      encodeInteger(output, 0x80, 7, i + 1);
+      return;
+    }
+  }
+
+  encodeHeader(output, ":status", str);
+}
+
+bool huffmanDecode(std::string_view input, std::string &output) {
+  uint32_t code   = 0;
+  size_t   length = 0;
+  for (char c : input) {
+    uint8_t byte = static_cast<uint8_t>(c);
+    for (int bit = 7; bit >= 0; --bit) {
+      code = (code << 1) | ((byte >> bit) & 1);
+      if (++length > HUFFMAN_MAX_CODE) {
+        return false;
+      }
+
+      uint32_t offset = code - huffmanTables.firstCode[length];
+      if (offset >= huffmanTables.count[length]) {
+        continue;
+      }
+
+      uint16_t symbol =
+          huffmanTables.symbols[huffmanTables.firstIndex[length] + offset];
+      if (symbol == HUFFMAN_EOS) {
+        return false;
+      }
+
+      output.push_back(static_cast<char>(symbol));
+      code   = 0;
+      length = 0;
+    }
+  }
+
+  // padding is most significant bits of EOS (all ones) and shorter then byte
+  return length < 8 && code == (uint32_t{1} << length) - 1;
+}
+} // namespace hpack
+} // namespace ss
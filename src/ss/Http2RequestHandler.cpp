@@ -0,0 +1,829 @@
+// Http2RequestHandler.cpp
+
+#include "ss/Http2RequestHandler.hpp"
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <charconv>
+#include <cstring>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+namespace {
+constexpr std::string_view CLIENT_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+constexpr size_t  FRAME_HEADER_SIZE     = 9;
+constexpr size_t  MAX_FRAME_SIZE        = 16384; // default, so not announced
+constexpr size_t  MAX_HEADER_BLOCK_SIZE = 256 * 1024;
+constexpr int64_t MAX_WINDOW_SIZE       = 0x7fffffff;
+constexpr size_t  MIN_PEER_FRAME_SIZE   = 16384;
+constexpr size_t  MAX_PEER_FRAME_SIZE   = 16777215;
+
+enum FrameType : uint8_t {
+  Data         = 0x0,
+  Headers      = 0x1,
+  Priority     = 0x2,
+  RstStream    = 0x3,
+  Settings     = 0x4,
+  PushPromise  = 0x5,
+  Ping         = 0x6,
+  GoAway       = 0x7,
+  WindowUpdate = 0x8,
+  Continuation = 0x9,
+};
+
+enum FrameFlag : uint8_t {
+  EndStream   = 0x1,
+  Ack         = 0x1,
+  EndHeaders  = 0x4,
+  Padded      = 0x8,
+  HasPriority = 0x20,
+};
+
+enum Setting : uint16_t {
+  HeaderTableSize      = 0x1,
+  EnablePush           = 0x2,
+  MaxConcurrentStreams = 0x3,
+  InitialWindowSize    = 0x4,
+  MaxFrameSize         = 0x5,
+  MaxHeaderListSize    = 0x6,
+};
+
+uint32_t readUint32(const char *data) noexcept {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return boost::endian::big_to_native(value);
+}
+
+uint16_t readUint16(const char *data) noexcept {
+  uint16_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return boost::endian::big_to_native(value);
+}
+
+void writeUint32(char *data, uint32_t value) noexcept {
+  value = boost::endian::native_to_big(value);
+  std::memcpy(data, &value, sizeof(value));
+}
+
+void writeUint16(char *data, uint16_t value) noexcept {
+  value = boost::endian::native_to_big(value);
+  std::memcpy(data, &value, sizeof(value));
+}
+
+/**\brief headers, which are not allowed in HTTP/2, RFC 7540, 8.1.2.2
+ */
+bool isConnectionHeader(std::string_view name) noexcept {
+  return name == "connection" || name == "keep-alive" ||
+         name == "proxy-connection" || name == "transfer-encoding" ||
+         name == "upgrade";
+}
+
+/**\brief remove padding from payload of DATA or HEADERS frame
+ * \return false if the padding is invalid
+ */
+bool removePadding(uint8_t flags, std::string_view &payload) noexcept {
+  if ((flags & FrameFlag::Padded) == 0) {
+    return true;
+  }
+
+  if (payload.empty()) {
+    return false;
+  }
+
+  size_t padding = static_cast<uint8_t>(payload.front());
+  payload.remove_prefix(1);
+  if (padding > payload.size()) {
+    return false;
+  }
+
+  payload.remove_suffix(padding);
+  return true;
+}
+} // namespace
+
+namespace http2 {
+ResponseWriter &ResponseWriter::status(unsigned code) {
+  if (state_ != State::Status) {
+    LOG_THROW(std::logic_error, "status of response is already written");
+  }
+
+  hpack::encodeStatus(headerBlock_, code);
+  state_ = State::Headers;
+  return *this;
+}
+
+ResponseWriter &ResponseWriter::header(std::string_view name,
+                                       std::string_view value) {
+  if (state_ == State::Status) {
+    this->status(200);
+  }
+  if (state_ != State::Headers) {
+    LOG_THROW(std::logic_error, "response is already completed");
+  }
+
+  name_.assign(name);
+  std::transform(name_.begin(), name_.end(), name_.begin(), [](char c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+  });
+
+  // content-length is set by body
+  if (isConnectionHeader(name_) || name_ == "content-length") {
+    return *this;
+  }
+
+  hpack::encodeHeader(headerBlock_, name_, value);
+  return *this;
+}
+
+void ResponseWriter::body(std::string_view body) {
+  if (state_ == State::Status) {
+    this->status(200);
+  }
+  if (state_ != State::Headers) {
+    LOG_THROW(std::logic_error, "response is already completed");
+  }
+
+  char length[20];
+  auto [end, err] =
+      std::to_chars(length, length + sizeof(length), body.size());
+  static_cast<void>(err);
+  hpack::encodeHeader(headerBlock_,
+                      "content-length",
+                      std::string_view{length,
+                                       static_cast<size_t>(end - length)});
+
+  if (headRequest_ == false) {
+    data_.assign(body);
+  }
+
+  state_ = State::Completed;
+}
+
+void ResponseWriter::finish() {
+  if (state_ == State::Status) {
+    this->status(500);
+  }
+  if (state_ == State::Headers) {
+    this->body();
+  }
+}
+} // namespace http2
+
+
+struct AbstractHttp2RequestHandler::Stream {
+  void reset(uint32_t streamId, int64_t window) noexcept {
+    id           = streamId;
+    remoteClosed = false;
+    responded    = false;
+    outputOffset = 0;
+    sendWindow   = window;
+
+    // capacity is saved for next streams
+    headers.clear();
+    body.clear();
+    output.clear();
+  }
+
+  uint32_t          id           = 0;
+  bool              remoteClosed = false;
+  bool              responded    = false;
+  hpack::HeaderList headers;
+  std::string       body;
+  std::string       output;
+  size_t            outputOffset = 0;
+  int64_t           sendWindow   = 0;
+};
+
+AbstractHttp2RequestHandler::AbstractHttp2RequestHandler() = default;
+
+AbstractHttp2RequestHandler::~AbstractHttp2RequestHandler() = default;
+
+error_code
+AbstractHttp2RequestHandler::handle(std::string_view requestBuffer,
+                                    ResponseInserter respIter,
+                                    size_t &         reqIgnoreLength) noexcept {
+  try {
+    output_ = respIter;
+
+    size_t offset = 0;
+    if (state_ == State::Preface) {
+      size_t size = std::min(requestBuffer.size(), CLIENT_PREFACE.size());
+      if (requestBuffer.substr(0, size) != CLIENT_PREFACE.substr(0, size)) {
+        LOG_WARNING("invalid http2 connection preface");
+        this->connectionError(http2::ErrorCode::ProtocolError);
+      } else if (size < CLIENT_PREFACE.size()) {
+        output_.reset();
+        return error::make_error_code(error::SessionError::PartialData);
+      } else {
+        this->writeSettings();
+        state_ = State::Open;
+        offset = CLIENT_PREFACE.size();
+      }
+    }
+
+    while (state_ == State::Open &&
+           requestBuffer.size() - offset >= FRAME_HEADER_SIZE) {
+      const char *header   = requestBuffer.data() + offset;
+      size_t      length   = readUint32(header) >> 8;
+      uint8_t     type     = static_cast<uint8_t>(header[3]);
+      uint8_t     flags    = static_cast<uint8_t>(header[4]);
+      uint32_t    streamId = readUint32(header + 5) & 0x7fffffff;
+
+      if (length > MAX_FRAME_SIZE) {
+        this->connectionError(http2::ErrorCode::FrameSizeError);
+        break;
+      }
+
+      if (requestBuffer.size() - offset - FRAME_HEADER_SIZE < length) {
+        break;
+      }
+
+      std::string_view payload =
+          requestBuffer.substr(offset + FRAME_HEADER_SIZE, length);
+      offset += FRAME_HEADER_SIZE + length;
+
+      if (this->handleFrame(type, flags, streamId, payload) == false) {
+        break;
+      }
+    }
+
+    output_.reset();
+
+    if (state_ == State::Closed || offset >= requestBuffer.size()) {
+      // 0 means that whole buffer is handled
+      reqIgnoreLength = 0;
+      return error_code{};
+    }
+
+    // tail of the buffer is a part of next frame
+    reqIgnoreLength = offset;
+    return error::make_error_code(error::SessionError::PartialData);
+  } catch (std::exception &e) {
+    LOG_ERROR(e.what());
+    output_.reset();
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+}
+
+bool AbstractHttp2RequestHandler::handleFrame(uint8_t          type,
+                                              uint8_t          flags,
+                                              uint32_t         streamId,
+                                              std::string_view payload) {
+  // header block can not be interrupted by other frames
+  if (continuationStream_ != 0 && type != FrameType::Continuation) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  switch (type) {
+  case FrameType::Data:
+    return this->handleData(flags, streamId, payload);
+  case FrameType::Headers:
+    return this->handleHeaders(flags, streamId, payload);
+  case FrameType::Priority:
+    // priorities are ignored
+    if (streamId == 0) {
+      return this->connectionError(http2::ErrorCode::ProtocolError);
+    }
+    if (payload.size() != 5) {
+      this->resetStream(streamId, http2::ErrorCode::FrameSizeError);
+    }
+    return true;
+  case FrameType::RstStream:
+    return this->handleRstStream(streamId, payload);
+  case FrameType::Settings:
+    return this->handleSettings(flags, streamId, payload);
+  case FrameType::PushPromise:
+    // client can not push
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  case FrameType::Ping:
+    if (streamId != 0) {
+      return this->connectionError(http2::ErrorCode::ProtocolError);
+    }
+    if (payload.size() != 8) {
+      return this->connectionError(http2::ErrorCode::FrameSizeError);
+    }
+    if ((flags & FrameFlag::Ack) == 0) {
+      this->writeFrame(FrameType::Ping, FrameFlag::Ack, 0, payload);
+    }
+    return true;
+  case FrameType::GoAway:
+    if (streamId != 0) {
+      return this->connectionError(http2::ErrorCode::ProtocolError);
+    }
+    LOG_DEBUG("http2 connection closed by client");
+    state_ = State::Closed;
+    this->closeAfterWrite();
+    return false;
+  case FrameType::WindowUpdate:
+    return this->handleWindowUpdate(streamId, payload);
+  case FrameType::Continuation:
+    return this->handleContinuation(flags, streamId, payload);
+  default:
+    // unknown frames must be ignored
+    return true;
+  }
+}
+
+bool AbstractHttp2RequestHandler::handleHeaders(uint8_t          flags,
+                                                uint32_t         streamId,
+                                                std::string_view payload) {
+  if (streamId == 0 || streamId % 2 == 0 ||
+      removePadding(flags, payload) == false) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  if (flags & FrameFlag::HasPriority) {
+    if (payload.size() < 5) {
+      return this->connectionError(http2::ErrorCode::FrameSizeError);
+    }
+    payload.remove_prefix(5);
+  }
+
+  Stream *stream = this->findStream(streamId);
+  if (stream == nullptr) {
+    // new stream must have bigger id, then all previous
+    if (streamId <= lastStreamId_) {
+      return this->connectionError(http2::ErrorCode::StreamClosed);
+    }
+    lastStreamId_ = streamId;
+  } else if (stream->remoteClosed) {
+    return this->connectionError(http2::ErrorCode::StreamClosed);
+  } else if ((flags & FrameFlag::EndStream) == 0) {
+    // trailers must end the stream
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  headerBlock_.assign(payload);
+  continuationStream_ = streamId;
+  continuationEnd_    = flags & FrameFlag::EndStream;
+
+  if (flags & FrameFlag::EndHeaders) {
+    return this->completeHeaders();
+  }
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::handleContinuation(uint8_t          flags,
+                                                     uint32_t         streamId,
+                                                     std::string_view payload) {
+  if (continuationStream_ == 0 || streamId != continuationStream_) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  headerBlock_.append(payload);
+  if (headerBlock_.size() > MAX_HEADER_BLOCK_SIZE) {
+    LOG_WARNING("too big http2 header block");
+    return this->connectionError(http2::ErrorCode::EnhanceYourCalm);
+  }
+
+  if (flags & FrameFlag::EndHeaders) {
+    return this->completeHeaders();
+  }
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::completeHeaders() {
+  uint32_t streamId   = continuationStream_;
+  continuationStream_ = 0;
+
+  Stream *stream   = this->findStream(streamId);
+  bool    refused  = stream == nullptr && streams_.size() >= maxStreams_;
+  bool    trailers = stream != nullptr;
+
+  // trailers and headers of refused streams are decoded anyway, because
+  // they change state of the decoder
+  if (trailers || refused) {
+    trailers_.clear();
+    if (decoder_.decode(headerBlock_, trailers_, maxHeaderListSize_) ==
+        false) {
+      LOG_WARNING("invalid or too big http2 header block");
+      return this->connectionError(http2::ErrorCode::CompressionError);
+    }
+  } else {
+    stream = &this->openStream(streamId);
+    if (decoder_.decode(headerBlock_, stream->headers, maxHeaderListSize_) ==
+        false) {
+      LOG_WARNING("invalid or too big http2 header block");
+      return this->connectionError(http2::ErrorCode::CompressionError);
+    }
+  }
+
+  if (refused) {
+    this->resetStream(streamId, http2::ErrorCode::RefusedStream);
+    return true;
+  }
+
+  if (continuationEnd_) {
+    stream->remoteClosed = true;
+    this->dispatch(*stream);
+  }
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::handleData(uint8_t          flags,
+                                             uint32_t         streamId,
+                                             std::string_view payload) {
+  // padding is counted by flow control too
+  size_t flowLength = payload.size();
+
+  if (streamId == 0 || removePadding(flags, payload) == false) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  // received data is consumed immediately, so window is restored
+  if (flowLength != 0) {
+    this->writeWindowUpdate(0, flowLength);
+  }
+
+  Stream *stream = this->findStream(streamId);
+  if (stream == nullptr || stream->remoteClosed) {
+    if (streamId > lastStreamId_) {
+      return this->connectionError(http2::ErrorCode::ProtocolError);
+    }
+
+    this->resetStream(streamId, http2::ErrorCode::StreamClosed);
+    return true;
+  }
+
+  if (payload.size() > maxBodySize_ - stream->body.size()) {
+    LOG_WARNING("too big body of http2 request");
+    this->resetStream(streamId, http2::ErrorCode::Cancel);
+    this->closeStream(streamId);
+    return true;
+  }
+
+  stream->body.append(payload);
+
+  if (flags & FrameFlag::EndStream) {
+    stream->remoteClosed = true;
+    this->dispatch(*stream);
+  } else if (flowLength != 0) {
+    this->writeWindowUpdate(streamId, flowLength);
+  }
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::handleSettings(uint8_t          flags,
+                                                 uint32_t         streamId,
+                                                 std::string_view payload) {
+  if (streamId != 0) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  if (flags & FrameFlag::Ack) {
+    if (payload.empty() == false) {
+      return this->connectionError(http2::ErrorCode::FrameSizeError);
+    }
+    return true;
+  }
+
+  if (payload.size() % 6 != 0) {
+    return this->connectionError(http2::ErrorCode::FrameSizeError);
+  }
+
+  for (size_t i = 0; i < payload.size(); i += 6) {
+    uint16_t id    = readUint16(payload.data() + i);
+    uint32_t value = readUint32(payload.data() + i + 2);
+
+    switch (id) {
+    case Setting::EnablePush:
+      if (value > 1) {
+        return this->connectionError(http2::ErrorCode::ProtocolError);
+      }
+      break;
+    case Setting::InitialWindowSize: {
+      if (value > MAX_WINDOW_SIZE) {
+        return this->connectionError(http2::ErrorCode::FlowControlError);
+      }
+
+      // change of initial window changes windows of all open streams
+      int64_t delta  = static_cast<int64_t>(value) - initialWindow_;
+      initialWindow_ = value;
+      for (auto &entry : streams_) {
+        entry.second->sendWindow += delta;
+        if (entry.second->sendWindow > MAX_WINDOW_SIZE) {
+          return this->connectionError(http2::ErrorCode::FlowControlError);
+        }
+      }
+      break;
+    }
+    case Setting::MaxFrameSize:
+      if (value < MIN_PEER_FRAME_SIZE || value > MAX_PEER_FRAME_SIZE) {
+        return this->connectionError(http2::ErrorCode::ProtocolError);
+      }
+      peerMaxFrameSize_ = value;
+      break;
+    default:
+      // header table size is not used by encoder, and other settings are
+      // not restrictions for server
+      break;
+    }
+  }
+
+  this->writeFrame(FrameType::Settings, FrameFlag::Ack, 0, std::string_view{});
+
+  this->sendBlocked();
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::handleWindowUpdate(uint32_t streamId,
+                                                     std::string_view payload) {
+  if (payload.size() != 4) {
+    return this->connectionError(http2::ErrorCode::FrameSizeError);
+  }
+
+  uint32_t increment = readUint32(payload.data()) & 0x7fffffff;
+  if (streamId == 0) {
+    if (increment == 0) {
+      return this->connectionError(http2::ErrorCode::ProtocolError);
+    }
+
+    connectionWindow_ += increment;
+    if (connectionWindow_ > MAX_WINDOW_SIZE) {
+      return this->connectionError(http2::ErrorCode::FlowControlError);
+    }
+
+    this->sendBlocked();
+    return true;
+  }
+
+  Stream *stream = this->findStream(streamId);
+  if (stream == nullptr) {
+    // the stream is already closed
+    return true;
+  }
+
+  stream->sendWindow += increment;
+  if (increment == 0 || stream->sendWindow > MAX_WINDOW_SIZE) {
+    this->resetStream(streamId,
+                      increment == 0 ? http2::ErrorCode::ProtocolError
+                                     : http2::ErrorCode::FlowControlError);
+    this->closeStream(streamId);
+    return true;
+  }
+
+  if (stream->responded) {
+    this->sendData(*stream);
+  }
+  return true;
+}
+
+bool AbstractHttp2RequestHandler::handleRstStream(uint32_t         streamId,
+                                                  std::string_view payload) {
+  if (streamId == 0) {
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+  if (payload.size() != 4) {
+    return this->connectionError(http2::ErrorCode::FrameSizeError);
+  }
+
+  if (this->findStream(streamId) == nullptr && streamId > lastStreamId_) {
+    // idle stream
+    return this->connectionError(http2::ErrorCode::ProtocolError);
+  }
+
+  this->closeStream(streamId);
+  return true;
+}
+
+void AbstractHttp2RequestHandler::dispatch(Stream &stream) {
+  http::Request &request = request_;
+  request.method         = std::string_view{};
+  request.target         = std::string_view{};
+  request.versionMinor   = 1;
+  request.keepAlive      = true;
+  request.body           = stream.body;
+  request.headersCount   = 0;
+
+  std::string_view authority;
+  bool             tooManyHeaders = false;
+  for (size_t i = 0; i < stream.headers.size(); ++i) {
+    std::string_view name  = stream.headers.name(i);
+    std::string_view value = stream.headers.value(i);
+
+    if (name.empty() == false && name.front() == ':') {
+      if (name == ":method") {
+        request.method = value;
+      } else if (name == ":path") {
+        request.target = value;
+      } else if (name == ":authority") {
+        authority = value;
+      }
+      continue;
+    }
+
+    if (request.headersCount == http::MAX_HEADERS) {
+      tooManyHeaders = true;
+      continue;
+    }
+    request.headers[request.headersCount++] = http::Header{name, value};
+  }
+
+  // handlers of HTTP/1.1 expect host header
+  if (authority.empty() == false && request.header("host").empty() &&
+      request.headersCount < http::MAX_HEADERS) {
+    request.headers[request.headersCount++] = http::Header{"host", authority};
+  }
+
+  if (request.method.empty() || request.target.empty()) {
+    this->resetStream(stream.id, http2::ErrorCode::ProtocolError);
+    this->closeStream(stream.id);
+    return;
+  }
+
+  responseHeaders_.clear();
+  stream.output.clear();
+  http2::ResponseWriter response{responseHeaders_,
+                                 stream.output,
+                                 request.method == "HEAD"};
+
+  if (tooManyHeaders) {
+    response.status(431).body();
+  } else {
+    error_code err = this->handleRequest(request, response);
+    if (err.failed()) {
+      this->resetStream(stream.id, http2::ErrorCode::InternalError);
+      this->closeStream(stream.id);
+      return;
+    }
+
+    if (response.completed() == false) {
+      LOG_WARNING("response for %1% %2% is not completed",
+                  request.method,
+                  request.target);
+      response.finish();
+    }
+  }
+
+  // header block is splitted to HEADERS and CONTINUATION frames
+  bool             endStream = stream.output.empty();
+  std::string_view block     = responseHeaders_;
+  uint8_t          type      = FrameType::Headers;
+  do {
+    std::string_view fragment = block.substr(0, peerMaxFrameSize_);
+    block.remove_prefix(fragment.size());
+
+    uint8_t flags = block.empty() ? FrameFlag::EndHeaders : 0;
+    if (type == FrameType::Headers && endStream) {
+      flags |= FrameFlag::EndStream;
+    }
+
+    this->writeFrame(type, flags, stream.id, fragment);
+    type = FrameType::Continuation;
+  } while (block.empty() == false);
+
+  stream.responded = true;
+  this->sendData(stream);
+}
+
+void AbstractHttp2RequestHandler::sendData(Stream &stream) {
+  while (stream.outputOffset < stream.output.size()) {
+    int64_t window = std::min(connectionWindow_, stream.sendWindow);
+    if (window <= 0) {
+      // will be continued by WINDOW_UPDATE
+      return;
+    }
+
+    size_t size = std::min({stream.output.size() - stream.outputOffset,
+                            peerMaxFrameSize_,
+                            static_cast<size_t>(window)});
+    bool   last = stream.outputOffset + size == stream.output.size();
+
+    this->writeFrame(FrameType::Data,
+                     last ? FrameFlag::EndStream : 0,
+                     stream.id,
+                     std::string_view{stream.output}.substr(stream.outputOffset,
+                                                            size));
+
+    stream.outputOffset += size;
+    stream.sendWindow -= size;
+    connectionWindow_ -= size;
+  }
+
+  // both sides are closed
+  this->closeStream(stream.id);
+}
+
+void AbstractHttp2RequestHandler::sendBlocked() {
+  std::vector<uint32_t> blocked;
+  for (auto &[id, stream] : streams_) {
+    if (stream->responded) {
+      blocked.emplace_back(id);
+    }
+  }
+
+  // lower ids are older streams
+  std::sort(blocked.begin(), blocked.end());
+  for (uint32_t id : blocked) {
+    if (connectionWindow_ <= 0) {
+      break;
+    }
+
+    Stream *stream = this->findStream(id);
+    if (stream != nullptr) {
+      this->sendData(*stream);
+    }
+  }
+}
+
+AbstractHttp2RequestHandler::Stream *
+AbstractHttp2RequestHandler::findStream(uint32_t streamId) noexcept {
+  auto found = streams_.find(streamId);
+  return found == streams_.end() ? nullptr : found->second.get();
+}
+
+AbstractHttp2RequestHandler::Stream &
+AbstractHttp2RequestHandler::openStream(uint32_t streamId) {
+  StreamPtr stream;
+  if (freeStreams_.empty()) {
+    stream = std::make_unique<Stream>();
+  } else {
+    stream = std::move(freeStreams_.back());
+    freeStreams_.pop_back();
+  }
+
+  stream->reset(streamId, initialWindow_);
+
+  Stream &retval = *stream;
+  streams_.emplace(streamId, std::move(stream));
+  return retval;
+}
+
+void AbstractHttp2RequestHandler::closeStream(uint32_t streamId) {
+  auto found = streams_.find(streamId);
+  if (found == streams_.end()) {
+    return;
+  }
+
+  // buffers of closed streams are reused by next streams
+  if (freeStreams_.size() < maxStreams_) {
+    freeStreams_.emplace_back(std::move(found->second));
+  }
+  streams_.erase(found);
+}
+
+void AbstractHttp2RequestHandler::writeFrame(uint8_t          type,
+                                             uint8_t          flags,
+                                             uint32_t         streamId,
+                                             std::string_view payload) {
+  char header[FRAME_HEADER_SIZE];
+  writeUint32(header, static_cast<uint32_t>(payload.size()) << 8);
+  header[3] = static_cast<char>(type);
+  header[4] = static_cast<char>(flags);
+  writeUint32(header + 5, streamId);
+
+  *output_ = std::copy(header, header + FRAME_HEADER_SIZE, *output_);
+  *output_ = std::copy(payload.begin(), payload.end(), *output_);
+}
+
+void AbstractHttp2RequestHandler::writeSettings() {
+  char payload[12];
+  writeUint16(payload, Setting::MaxConcurrentStreams);
+  writeUint32(payload + 2, static_cast<uint32_t>(maxStreams_));
+  writeUint16(payload + 6, Setting::MaxHeaderListSize);
+  writeUint32(payload + 8,
+              static_cast<uint32_t>(std::min<size_t>(maxHeaderListSize_,
+                                                     UINT32_MAX)));
+
+  this->writeFrame(FrameType::Settings,
+                   0,
+                   0,
+                   std::string_view{payload, sizeof(payload)});
+}
+
+void AbstractHttp2RequestHandler::writeWindowUpdate(uint32_t streamId,
+                                                    uint32_t increment) {
+  char payload[4];
+  writeUint32(payload, increment);
+  this->writeFrame(FrameType::WindowUpdate,
+                   0,
+                   streamId,
+                   std::string_view{payload, sizeof(payload)});
+}
+
+void AbstractHttp2RequestHandler::resetStream(uint32_t         streamId,
+                                              http2::ErrorCode code) {
+  char payload[4];
+  writeUint32(payload, code);
+  this->writeFrame(FrameType::RstStream,
+                   0,
+                   streamId,
+                   std::string_view{payload, sizeof(payload)});
+}
+
+bool AbstractHttp2RequestHandler::connectionError(http2::ErrorCode code) {
+  LOG_WARNING("http2 connection error: %1%", static_cast<uint32_t>(code));
+
+  char payload[8];
+  writeUint32(payload, lastStreamId_);
+  writeUint32(payload + 4, code);
+  this->writeFrame(FrameType::GoAway,
+                   0,
+                   0,
+                   std::string_view{payload, sizeof(payload)});
+
+  state_ = State::Closed;
+  this->closeAfterWrite();
+  return false;
+}
+} // namespace ss
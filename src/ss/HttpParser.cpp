@@ -0,0 +1,344 @@
+// HttpParser.cpp
+
+#include "ss/HttpParser.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace ss {
+namespace http {
+namespace {
+constexpr std::string_view CRLF          = "\r\n";
+constexpr std::string_view END_OF_HEAD   = "\r\n\r\n";
+constexpr std::string_view HTTP_1_PREFIX = "HTTP/1.";
+
+char toLower(char c) noexcept {
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+bool isTokenChar(char c) noexcept {
+  return c > ' ' && c < 127 && std::string_view{"\"(),/:;<=>?@[\\]{}"}.find(
+                                   c) == std::string_view::npos;
+}
+
+bool isToken(std::string_view str) noexcept {
+  return str.empty() == false &&
+         std::all_of(str.begin(), str.end(), isTokenChar);
+}
+
+std::string_view trim(std::string_view str) noexcept {
+  while (str.empty() == false && (str.front() == ' ' || str.front() == '\t')) {
+    str.remove_prefix(1);
+  }
+  while (str.empty() == false && (str.back() == ' ' || str.back() == '\t')) {
+    str.remove_suffix(1);
+  }
+  return str;
+}
+
+/**\brief call the function for every element of comma separated list
+ */
+template <typename Function>
+void forEachToken(std::string_view list, Function function) {
+  while (list.empty() == false) {
+    size_t comma = list.find(',');
+    function(trim(list.substr(0, comma)));
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+}
+} // namespace
+
+bool iequals(std::string_view lhs, std::string_view rhs) noexcept {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char l, char r) {
+           return toLower(l) == toLower(r);
+         });
+}
+
+std::string_view Request::header(std::string_view name) const noexcept {
+  for (size_t i = 0; i < headersCount; ++i) {
+    if (iequals(headers[i].name, name)) {
+      return headers[i].value;
+    }
+  }
+  return std::string_view{};
+}
+
+ParseStatus RequestParser::parse(std::string_view buffer, Request &request) {
+  if (stage_ == Stage::Head) {
+    // end of head can be splitted between previous and current data
+    size_t from = scanned_ > END_OF_HEAD.size() - 1
+                      ? scanned_ - (END_OF_HEAD.size() - 1)
+                      : 0;
+    size_t end  = buffer.find(END_OF_HEAD, from);
+    if (end == std::string_view::npos) {
+      if (buffer.size() >= maxHeadSize_) {
+        return ParseStatus::TooLarge;
+      }
+
+      scanned_ = buffer.size();
+      return ParseStatus::Partial;
+    }
+
+    headSize_ = end + END_OF_HEAD.size();
+    if (headSize_ > maxHeadSize_) {
+      return ParseStatus::TooLarge;
+    }
+
+    // last header is terminated by CRLF too
+    ParseStatus status = this->parseHead(buffer.substr(0, end + CRLF.size()));
+    if (status != ParseStatus::Complete) {
+      return status;
+    }
+
+    chunkPos_ = headSize_;
+    stage_    = chunked_ ? Stage::Chunks : Stage::Body;
+  }
+
+  if (stage_ == Stage::Body && contentLength_ > maxBodySize_) {
+    return ParseStatus::TooLarge;
+  }
+
+  if (stage_ == Stage::Body) {
+    if (buffer.size() - headSize_ < contentLength_) {
+      return ParseStatus::Partial;
+    }
+
+    size_  = headSize_ + contentLength_;
+    stage_ = Stage::Complete;
+  } else if (stage_ == Stage::Chunks) {
+    ParseStatus status = this->parseChunks(buffer);
+    if (status != ParseStatus::Complete) {
+      return status;
+    }
+
+    stage_ = Stage::Complete;
+  }
+
+  this->fill(buffer, request);
+  return ParseStatus::Complete;
+}
+
+void RequestParser::reset() noexcept {
+  stage_            = Stage::Head;
+  scanned_          = 0;
+  size_             = 0;
+  headSize_         = 0;
+  versionMinor_     = 1;
+  keepAlive_        = true;
+  headersCount_     = 0;
+  hasContentLength_ = false;
+  contentLength_    = 0;
+  chunked_          = false;
+  inTrailer_        = false;
+  chunkPos_         = 0;
+
+  // capacity is saved for next requests
+  chunkedBody_.clear();
+}
+
+ParseStatus RequestParser::parseHead(std::string_view head) {
+  size_t           lineEnd = head.find(CRLF);
+  std::string_view line    = head.substr(0, lineEnd);
+
+  // request-line = method SP request-target SP HTTP-version
+  size_t methodEnd = line.find(' ');
+  size_t targetEnd = line.find(' ', methodEnd + 1);
+  if (methodEnd == std::string_view::npos ||
+      targetEnd == std::string_view::npos || targetEnd == methodEnd + 1) {
+    return ParseStatus::Invalid;
+  }
+
+  if (isToken(line.substr(0, methodEnd)) == false) {
+    return ParseStatus::Invalid;
+  }
+
+  std::string_view version = line.substr(targetEnd + 1);
+  if (version.size() != HTTP_1_PREFIX.size() + 1 ||
+      version.substr(0, HTTP_1_PREFIX.size()) != HTTP_1_PREFIX) {
+    return version.substr(0, 5) == "HTTP/" ? ParseStatus::Unsupported
+                                           : ParseStatus::Invalid;
+  }
+
+  if (version.back() == '0') {
+    versionMinor_ = 0;
+  } else if (version.back() == '1') {
+    versionMinor_ = 1;
+  } else {
+    return ParseStatus::Unsupported;
+  }
+
+  method_    = Span{0, methodEnd};
+  target_    = Span{methodEnd + 1, targetEnd - methodEnd - 1};
+  keepAlive_ = versionMinor_ == 1;
+
+  for (size_t pos = lineEnd + CRLF.size(); pos < head.size();) {
+    lineEnd = head.find(CRLF, pos);
+    line    = head.substr(pos, lineEnd - pos);
+
+    // field-name must be token, so obsolete line folding is not accepted too
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos ||
+        isToken(line.substr(0, colon)) == false) {
+      return ParseStatus::Invalid;
+    }
+
+    std::string_view value = trim(line.substr(colon + 1));
+    size_t           valueOffset =
+        value.empty() ? pos + colon + 1 : value.data() - head.data();
+
+    ParseStatus status = this->parseHeader(head,
+                                           Span{pos, colon},
+                                           Span{valueOffset, value.size()});
+    if (status != ParseStatus::Complete) {
+      return status;
+    }
+
+    pos = lineEnd + CRLF.size();
+  }
+
+  if (chunked_ && hasContentLength_) {
+    // ambiguous length of the body, possible request smuggling
+    return ParseStatus::Invalid;
+  }
+
+  return ParseStatus::Complete;
+}
+
+ParseStatus
+RequestParser::parseHeader(std::string_view head, Span name, Span value) {
+  if (headersCount_ == MAX_HEADERS) {
+    return ParseStatus::Invalid;
+  }
+  headers_[headersCount_++] = std::make_pair(name, value);
+
+  std::string_view nameView  = head.substr(name.offset, name.size);
+  std::string_view valueView = head.substr(value.offset, value.size);
+
+  if (iequals(nameView, "content-length")) {
+    const char *valueEnd = valueView.data() + valueView.size();
+    size_t      length   = 0;
+    auto [end, err]      = std::from_chars(valueView.data(), valueEnd, length);
+    if (err != std::errc{} || end != valueEnd ||
+        (hasContentLength_ && length != contentLength_)) {
+      return ParseStatus::Invalid;
+    }
+
+    hasContentLength_ = true;
+    contentLength_    = length;
+  } else if (iequals(nameView, "transfer-encoding")) {
+    // only chunked is supported, and it must be the last coding
+    bool unsupported = false;
+    forEachToken(valueView, [this, &unsupported](std::string_view coding) {
+      if (chunked_) {
+        unsupported = true;
+      }
+      if (iequals(coding, "chunked")) {
+        chunked_ = true;
+      } else {
+        unsupported = true;
+      }
+    });
+    if (unsupported) {
+      return ParseStatus::Unsupported;
+    }
+  } else if (iequals(nameView, "connection")) {
+    forEachToken(valueView, [this](std::string_view option) {
+      if (iequals(option, "close")) {
+        keepAlive_ = false;
+      } else if (iequals(option, "keep-alive")) {
+        keepAlive_ = true;
+      }
+    });
+  }
+
+  return ParseStatus::Complete;
+}
+
+ParseStatus RequestParser::parseChunks(std::string_view buffer) {
+  for (;;) {
+    size_t lineEnd = buffer.find(CRLF, chunkPos_);
+    if (lineEnd == std::string_view::npos) {
+      return buffer.size() - chunkPos_ > MAX_CHUNK_LINE_SIZE
+                 ? ParseStatus::Invalid
+                 : ParseStatus::Partial;
+    }
+    if (lineEnd - chunkPos_ > MAX_CHUNK_LINE_SIZE) {
+      return ParseStatus::Invalid;
+    }
+
+    std::string_view line      = buffer.substr(chunkPos_, lineEnd - chunkPos_);
+    size_t           dataBegin = lineEnd + CRLF.size();
+
+    if (inTrailer_) {
+      chunkPos_ = dataBegin;
+      if (line.empty()) {
+        size_ = chunkPos_;
+        return ParseStatus::Complete;
+      }
+      continue;
+    }
+
+    // chunk-size [ chunk-ext ] CRLF, extensions are ignored
+    size_t chunkSize = 0;
+    auto [end, err] =
+        std::from_chars(line.data(), line.data() + line.size(), chunkSize, 16);
+    if (err != std::errc{} ||
+        (end != line.data() + line.size() && *end != ';' && *end != ' ' &&
+         *end != '\t')) {
+      return ParseStatus::Invalid;
+    }
+
+    if (chunkSize == 0) {
+      inTrailer_ = true;
+      chunkPos_  = dataBegin;
+      continue;
+    }
+
+    if (chunkSize > maxBodySize_ - chunkedBody_.size()) {
+      return ParseStatus::TooLarge;
+    }
+
+    // chunk is handled only when it is complete, so partial chunk will be
+    // parsed again with next data
+    if (chunkSize > buffer.size() ||
+        buffer.size() - dataBegin < chunkSize + CRLF.size()) {
+      return ParseStatus::Partial;
+    }
+
+    if (buffer.substr(dataBegin + chunkSize, CRLF.size()) != CRLF) {
+      return ParseStatus::Invalid;
+    }
+
+    chunkedBody_.append(buffer.data() + dataBegin, chunkSize);
+    chunkPos_ = dataBegin + chunkSize + CRLF.size();
+  }
+}
+
+void RequestParser::fill(std::string_view buffer,
+                         Request &        request) const noexcept {
+  auto view = [buffer](Span span) {
+    return buffer.substr(span.offset, span.size);
+  };
+
+  request.method       = view(method_);
+  request.target       = view(target_);
+  request.versionMinor = versionMinor_;
+  request.keepAlive    = keepAlive_;
+
+  request.headersCount = headersCount_;
+  for (size_t i = 0; i < headersCount_; ++i) {
+    request.headers[i] =
+        Header{view(headers_[i].first), view(headers_[i].second)};
+  }
+
+  if (chunked_) {
+    request.body = chunkedBody_;
+  } else {
+    request.body = buffer.substr(headSize_, contentLength_);
+  }
+}
+} // namespace http
+} // namespace ss
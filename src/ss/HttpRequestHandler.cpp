@@ -0,0 +1,300 @@
+// HttpRequestHandler.cpp
+
+#include "ss/HttpRequestHandler.hpp"
+#include <algorithm>
+#include <charconv>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+namespace http {
+std::string_view reasonPhrase(unsigned code) noexcept {
+  switch (code) {
+  case 100:
+    return "Continue";
+  case 101:
+    return "Switching Protocols";
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 202:
+    return "Accepted";
+  case 204:
+    return "No Content";
+  case 206:
+    return "Partial Content";
+  case 301:
+    return "Moved Permanently";
+  case 302:
+    return "Found";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 408:
+    return "Request Timeout";
+  case 413:
+    return "Payload Too Large";
+  case 426:
+    return "Upgrade Required";
+  case 429:
+    return "Too Many Requests";
+  case 431:
+    return "Request Header Fields Too Large";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 502:
+    return "Bad Gateway";
+  case 503:
+    return "Service Unavailable";
+  case 505:
+    return "HTTP Version Not Supported";
+  default:
+    return "Unknown";
+  }
+}
+
+ResponseWriter::ResponseWriter(Inserter output, const Request &request) noexcept
+    : output_{output}
+    , keepAlive_{request.keepAlive}
+    , http10_{request.versionMinor == 0}
+    , headRequest_{request.method == "HEAD"} {
+}
+
+ResponseWriter &ResponseWriter::status(unsigned code, std::string_view reason) {
+  if (state_ != State::Status) {
+    LOG_THROW(std::logic_error, "status of response is already written");
+  }
+
+  if (reason.empty()) {
+    reason = reasonPhrase(code);
+  }
+
+  this->write("HTTP/1.1 ");
+  this->writeNumber(code);
+  this->write(" ");
+  this->write(reason);
+  this->write("\r\n");
+
+  state_ = State::Headers;
+  return *this;
+}
+
+ResponseWriter &ResponseWriter::header(std::string_view name,
+                                       std::string_view value) {
+  if (state_ == State::Status) {
+    this->status(200);
+  }
+  if (state_ != State::Headers) {
+    LOG_THROW(std::logic_error, "head of response is already written");
+  }
+
+  this->write(name);
+  this->write(": ");
+  this->write(value);
+  this->write("\r\n");
+  return *this;
+}
+
+void ResponseWriter::body(std::string_view body) {
+  if (state_ == State::Status) {
+    this->status(200);
+  }
+  if (state_ != State::Headers) {
+    LOG_THROW(std::logic_error, "head of response is already written");
+  }
+
+  this->write("Content-Length: ");
+  this->writeNumber(body.size());
+  this->write("\r\n");
+  this->endHead();
+
+  if (headRequest_ == false) {
+    this->write(body);
+  }
+
+  state_ = State::Completed;
+}
+
+void ResponseWriter::chunk(std::string_view data) {
+  if (state_ == State::Status) {
+    this->status(200);
+  }
+
+  if (state_ == State::Headers) {
+    if (http10_) {
+      // without length the body ends at close of connection
+      keepAlive_ = false;
+    } else {
+      this->write("Transfer-Encoding: chunked\r\n");
+    }
+    this->endHead();
+
+    state_ = State::Chunked;
+  }
+
+  if (state_ != State::Chunked) {
+    LOG_THROW(std::logic_error, "response is already completed");
+  }
+
+  // empty chunk means end of body
+  if (data.empty() || headRequest_) {
+    return;
+  }
+
+  if (http10_) {
+    this->write(data);
+    return;
+  }
+
+  this->writeNumber(data.size(), 16);
+  this->write("\r\n");
+  this->write(data);
+  this->write("\r\n");
+}
+
+void ResponseWriter::end() {
+  if (state_ != State::Chunked) {
+    this->chunk(std::string_view{});
+  }
+
+  if (http10_ == false && headRequest_ == false) {
+    this->write("0\r\n\r\n");
+  }
+
+  state_ = State::Completed;
+}
+
+ResponseWriter &ResponseWriter::closeConnection() noexcept {
+  keepAlive_ = false;
+  return *this;
+}
+
+void ResponseWriter::finish() {
+  switch (state_) {
+  case State::Status:
+    keepAlive_ = false;
+    this->status(500);
+    this->body();
+    break;
+  case State::Headers:
+    this->body();
+    break;
+  case State::Chunked:
+    this->end();
+    break;
+  case State::Completed:
+    break;
+  }
+}
+
+void ResponseWriter::write(std::string_view data) {
+  output_ = std::copy(data.begin(), data.end(), output_);
+}
+
+void ResponseWriter::writeNumber(size_t number, int base) {
+  char buffer[20];
+  // buffer is enough for any size_t, so conversion can not fail
+  auto [end, err] =
+      std::to_chars(buffer, buffer + sizeof(buffer), number, base);
+  static_cast<void>(err);
+  output_ = std::copy(buffer, end, output_);
+}
+
+void ResponseWriter::endHead() {
+  if (keepAlive_ == false) {
+    this->write("Connection: close\r\n");
+  } else if (http10_) {
+    this->write("Connection: keep-alive\r\n");
+  }
+  this->write("\r\n");
+}
+} // namespace http
+
+error_code
+AbstractHttpRequestHandler::handle(std::string_view requestBuffer,
+                                   ResponseInserter respIter,
+                                   size_t &         reqIgnoreLength) noexcept {
+  try {
+    size_t offset = 0;
+    while (offset < requestBuffer.size()) {
+      http::ParseStatus status =
+          parser_.parse(requestBuffer.substr(offset), request_);
+      if (status == http::ParseStatus::Partial) {
+        break;
+      }
+
+      if (status != http::ParseStatus::Complete) {
+        LOG_WARNING("invalid http request");
+
+        http::Request invalid;
+        invalid.keepAlive = false;
+
+        http::ResponseWriter response{respIter, invalid};
+        switch (status) {
+        case http::ParseStatus::Unsupported:
+          response.status(501);
+          break;
+        case http::ParseStatus::TooLarge:
+          response.status(parser_.headParsed() ? 413 : 431);
+          break;
+        default:
+          response.status(400);
+          break;
+        }
+        response.body();
+
+        this->closeAfterWrite();
+        reqIgnoreLength = 0;
+        return error_code{};
+      }
+
+      http::ResponseWriter response{respIter, request_};
+      error_code           err = this->handleRequest(request_, response);
+      if (err.failed()) {
+        return err;
+      }
+
+      if (response.completed() == false) {
+        LOG_WARNING("response for %1% %2% is not completed",
+                    request_.method,
+                    request_.target);
+        response.finish();
+      }
+
+      offset += parser_.size();
+      parser_.reset();
+
+      if (response.keepAlive() == false) {
+        // rest of the buffer is ignored
+        this->closeAfterWrite();
+        reqIgnoreLength = 0;
+        return error_code{};
+      }
+    }
+
+    if (offset == requestBuffer.size()) {
+      // 0 means that whole buffer is handled
+      reqIgnoreLength = 0;
+      return error_code{};
+    }
+
+    // tail of the buffer is a part of next request
+    reqIgnoreLength = offset;
+    return error::make_error_code(error::SessionError::PartialData);
+  } catch (std::exception &e) {
+    LOG_ERROR(e.what());
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+}
+} // namespace ss
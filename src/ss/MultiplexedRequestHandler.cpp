@@ -0,0 +1,109 @@
+// MultiplexedRequestHandler.cpp
+
+#include "ss/MultiplexedRequestHandler.hpp"
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <cstring>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+namespace {
+uint32_t readUint32(const char *data) noexcept {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return boost::endian::big_to_native(value);
+}
+
+void writeHeader(char *          header,
+                 RequestId       id,
+                 std::string_view payload) noexcept {
+  uint32_t values[2] = {boost::endian::native_to_big(id),
+                        boost::endian::native_to_big(
+                            static_cast<uint32_t>(payload.size()))};
+  std::memcpy(header, values, MULTIPLEXED_HEADER_SIZE);
+}
+} // namespace
+
+void appendMultiplexedFrame(std::string &    output,
+                            RequestId        id,
+                            std::string_view payload) {
+  char header[MULTIPLEXED_HEADER_SIZE];
+  writeHeader(header, id, payload);
+
+  output.reserve(output.size() + MULTIPLEXED_HEADER_SIZE + payload.size());
+  output.append(header, MULTIPLEXED_HEADER_SIZE);
+  output.append(payload);
+}
+
+error_code Responder::send(std::string_view payload) const noexcept {
+  try {
+    std::string frame;
+    appendMultiplexedFrame(frame, id_, payload);
+    return session_.send(std::move(frame));
+  } catch (std::exception &e) {
+    LOG_ERROR(e.what());
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+}
+
+error_code
+AbstractMultiplexedRequestHandler::handle(std::string_view requestBuffer,
+                                          ResponseInserter respIter,
+                                          size_t &reqIgnoreLength) noexcept {
+  output_ = respIter;
+
+  size_t     offset = 0;
+  error_code err;
+  while (requestBuffer.size() - offset >= MULTIPLEXED_HEADER_SIZE) {
+    const char *header = requestBuffer.data() + offset;
+    RequestId   id     = readUint32(header);
+    size_t      size   = readUint32(header + 4);
+    if (size > maxFrameSize_) {
+      LOG_WARNING("too big multiplexed frame: %1.3fKb", size / 1024.);
+      err = error::make_error_code(error::SessionError::RequestTooBig);
+      break;
+    }
+    if (requestBuffer.size() - offset - MULTIPLEXED_HEADER_SIZE < size) {
+      break;
+    }
+
+    std::string_view payload =
+        requestBuffer.substr(offset + MULTIPLEXED_HEADER_SIZE, size);
+    offset += MULTIPLEXED_HEADER_SIZE + size;
+
+    err = this->handleRequest(id, payload, Responder{this->sessionHandle(), id});
+    if (err.failed()) {
+      break;
+    }
+  }
+
+  output_.reset();
+
+  if (err.failed()) {
+    return err;
+  }
+
+  if (offset == requestBuffer.size()) {
+    // 0 means that whole buffer is handled
+    reqIgnoreLength = 0;
+    return error_code{};
+  }
+
+  // tail of the buffer is a part of next frame
+  reqIgnoreLength = offset;
+  return error::make_error_code(error::SessionError::PartialData);
+}
+
+void AbstractMultiplexedRequestHandler::respond(RequestId        id,
+                                                std::string_view payload) {
+  if (output_.has_value() == false) {
+    LOG_THROW(std::logic_error, "respond can be called only in handleRequest");
+  }
+
+  char header[MULTIPLEXED_HEADER_SIZE];
+  writeHeader(header, id, payload);
+
+  *output_ = std::copy(header, header + MULTIPLEXED_HEADER_SIZE, *output_);
+  *output_ = std::copy(payload.begin(), payload.end(), *output_);
+}
+} // namespace ss
@@ -0,0 +1,36 @@
+// Probes.hpp
+/**\file
+ * Static tracepoints (USDT) of the server. They are compiled only with
+ * SS_USDT_PROBES (cmake option usdt_probes) and require <sys/sdt.h> from
+ * systemtap. Every probe is a single nop in the code, so it costs nothing
+ * until some tracer attaches to it. Otherwise the probes are expanded to
+ * nothing, and their arguments are not evaluated.
+ *
+ * Provider is `ss`, first argument of session probes is address of the
+ * session, which is unique while the session is alive:
+ * - accept(fd)
+ * - session_start(session, fd)
+ * - read(session, bytes)
+ * - handler_enter(session, request bytes)
+ * - handler_exit(session, response bytes, error value)
+ * - write_start(session, bytes)
+ * - write_done(session, bytes, error value)
+ * - close(session)
+ *
+ * For example, time of handling by bpftrace:
+ * \code
+ * usdt:./libss.so:ss:handler_enter { @start[arg0] = nsecs; }
+ * usdt:./libss.so:ss:handler_exit /@start[arg0]/ {
+ *   @handle_ns = hist(nsecs - @start[arg0]); delete(@start[arg0]);
+ * }
+ * \endcode
+ */
+
+#pragma once
+
+#if defined(SS_USDT_PROBES)
+#  include <sys/sdt.h>
+#  define SS_PROBE(name, ...) STAP_PROBEV(ss, name, __VA_ARGS__)
+#else
+#  define SS_PROBE(name, ...) static_cast<void>(0)
+#endif
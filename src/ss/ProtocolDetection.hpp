@@ -0,0 +1,221 @@
+// ProtocolDetection.hpp
+
+#pragma once
+
+#include "ProtocolDetector.hpp"
+#include <array>
+#include <atomic>
+#include <boost/asio/basic_stream_socket.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <simple_logs/logs.hpp>
+#include <sys/socket.h>
+
+namespace ss {
+namespace asio = boost::asio;
+
+/**\brief detection of protocol of accepted connection. First bytes are
+ * peeked by MSG_PEEK, so they stay in the socket and are readed by the
+ * session as usual. Bytes are peeked again, while they are shorter than some
+ * signature and match it, but not longer than the longest signature and not
+ * longer than the timeout. Then the socket is passed to the callback with
+ * factory of detected protocol
+ */
+template <typename Protocol>
+class ProtocolDetection final
+    : public std::enable_shared_from_this<ProtocolDetection<Protocol>> {
+public:
+  using Socket   = asio::basic_stream_socket<Protocol>;
+  using Strand   = asio::strand<typename Socket::executor_type>;
+  using Clock    = std::chrono::steady_clock;
+  using Callback = std::function<void(Socket socket,
+                                      RequestHandlerFactory factory)>;
+
+  ProtocolDetection(Socket              socket,
+                    ProtocolDetectorPtr detector,
+                    Callback            callback) noexcept
+      : socket_{std::move(socket)}
+      , strand_{asio::make_strand(socket_.get_executor())}
+      , timeout_{strand_}
+      , retry_{strand_}
+      , detector_{std::move(detector)}
+      , callback_{std::move(callback)} {
+  }
+
+  void start() {
+    asio::dispatch(strand_, [self = this->shared_from_this()]() {
+      self->start_ = Clock::now();
+      self->timeout_.expires_after(self->detector_->options().timeout);
+      self->timeout_.async_wait([self](error_code err) {
+        if (err.failed() == false) {
+          self->atTimeout();
+        }
+      });
+
+      self->peek();
+    });
+  }
+
+  /**\brief close the connection without passing it to the callback
+   * \note can be called from any thread
+   */
+  void close() {
+    asio::dispatch(strand_, [self = this->shared_from_this()]() {
+      if (self->done_.exchange(true)) {
+        return;
+      }
+
+      self->cancel();
+      self->callback_ = nullptr;
+
+      error_code ignored;
+      self->socket_.close(ignored);
+    });
+  }
+
+  bool isOpen() const noexcept {
+    return done_ == false;
+  }
+
+private:
+  void peek() {
+    if (done_) {
+      return;
+    }
+
+    detector_->countPeek();
+    ssize_t peeked = ::recv(socket_.native_handle(),
+                            buffer_.data(),
+                            detector_->peekSize(),
+                            MSG_PEEK | MSG_DONTWAIT);
+    if (peeked < 0) {
+      if (errno == EINTR) {
+        this->peek();
+        return;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        this->wait();
+        return;
+      }
+
+      LOG_DEBUG("can not peek connection: %1%", std::strerror(errno));
+      this->finish(ProtocolDetector::Result::Disconnect, nullptr);
+      return;
+    }
+    if (peeked == 0) {
+      LOG_DEBUG("client close connection before protocol detection");
+      this->finish(ProtocolDetector::Result::Disconnect, nullptr);
+      return;
+    }
+
+    bool                               needMore  = false;
+    const ProtocolDetector::Signature *signature = detector_->match(
+        std::string_view{buffer_.data(), static_cast<size_t>(peeked)},
+        needMore);
+    if (signature != nullptr) {
+      this->finish(ProtocolDetector::Result::Detected, signature->factory);
+      return;
+    }
+
+    if (needMore) {
+      // the socket stays readable, while peeked bytes are not readed, so
+      // next bytes are waited by the timer
+      retry_.expires_after(detector_->options().retryInterval);
+      retry_.async_wait([self = this->shared_from_this()](error_code err) {
+        if (err.failed() == false) {
+          self->peek();
+        }
+      });
+      return;
+    }
+
+    this->finishDefault();
+  }
+
+  void wait() {
+    socket_.async_wait(
+        asio::socket_base::wait_read,
+        asio::bind_executor(strand_,
+                            [self = this->shared_from_this()](error_code err) {
+                              if (err == asio::error::operation_aborted) {
+                                return;
+                              }
+                              if (err.failed()) {
+                                self->finish(
+                                    ProtocolDetector::Result::Disconnect,
+                                    nullptr);
+                                return;
+                              }
+
+                              self->peek();
+                            }));
+  }
+
+  void atTimeout() {
+    if (done_) {
+      return;
+    }
+
+    LOG_DEBUG("protocol is not detected in time");
+    detector_->countTimeout();
+    this->finishDefault();
+  }
+
+  void finishDefault() {
+    const RequestHandlerFactory &factory = detector_->defaultFactory();
+    this->finish(factory != nullptr ? ProtocolDetector::Result::Defaulted
+                                    : ProtocolDetector::Result::Unknown,
+                 factory);
+  }
+
+  void finish(ProtocolDetector::Result result, RequestHandlerFactory factory) {
+    if (done_.exchange(true)) {
+      return;
+    }
+
+    detector_->countResult(result, Clock::now() - start_);
+    this->cancel();
+
+    Callback callback = std::move(callback_);
+    callback_         = nullptr;
+
+    if (factory == nullptr) {
+      if (result == ProtocolDetector::Result::Unknown) {
+        LOG_DEBUG("unknown protocol, close connection");
+      }
+
+      error_code ignored;
+      socket_.close(ignored);
+      return;
+    }
+
+    callback(std::move(socket_), std::move(factory));
+  }
+
+  void cancel() noexcept {
+    timeout_.cancel();
+    retry_.cancel();
+
+    error_code ignored;
+    socket_.cancel(ignored);
+  }
+
+private:
+  Socket             socket_;
+  Strand             strand_;
+  asio::steady_timer timeout_;
+  asio::steady_timer retry_;
+
+  ProtocolDetectorPtr detector_;
+  Callback            callback_;
+
+  std::array<char, MAX_PROTOCOL_SIGNATURE_SIZE> buffer_;
+  Clock::time_point                             start_;
+  std::atomic<bool>                             done_{false};
+};
+} // namespace ss
@@ -0,0 +1,94 @@
+// ProtocolDetector.cpp
+
+#include "ProtocolDetector.hpp"
+#include <algorithm>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+ProtocolDetector::ProtocolDetector(
+    std::vector<Signature>          signatures,
+    RequestHandlerFactory           defaultFactory,
+    const ProtocolDetectionOptions &options)
+    : signatures_{std::move(signatures)}
+    , defaultFactory_{std::move(defaultFactory)}
+    , options_{options} {
+  if (options_.timeout.count() <= 0) {
+    LOG_THROW(std::invalid_argument, "timeout of protocol detection is 0");
+  }
+
+  for (const Signature &signature : signatures_) {
+    if (signature.prefix.empty() ||
+        signature.prefix.size() > MAX_PROTOCOL_SIGNATURE_SIZE) {
+      LOG_THROW(std::invalid_argument,
+                "invalid size of protocol signature: %1%",
+                signature.prefix.size());
+    }
+    if (signature.factory == nullptr) {
+      LOG_THROW(std::invalid_argument, "invalid request handler factory");
+    }
+
+    peekSize_ = std::max(peekSize_, signature.prefix.size());
+  }
+}
+
+const ProtocolDetector::Signature *
+ProtocolDetector::match(std::string_view peeked, bool &needMore) const
+    noexcept {
+  needMore = false;
+  for (const Signature &signature : signatures_) {
+    std::string_view prefix = signature.prefix;
+    if (peeked.size() >= prefix.size()) {
+      if (peeked.substr(0, prefix.size()) == prefix) {
+        return &signature;
+      }
+    } else if (prefix.substr(0, peeked.size()) == peeked) {
+      needMore = true;
+    }
+  }
+
+  return nullptr;
+}
+
+void ProtocolDetector::countResult(Result                   result,
+                                   std::chrono::nanoseconds time) noexcept {
+  switch (result) {
+  case Result::Detected:
+    ++detected_;
+    break;
+  case Result::Defaulted:
+    ++defaulted_;
+    break;
+  case Result::Unknown:
+    ++unknown_;
+    break;
+  case Result::Disconnect:
+    ++disconnects_;
+    break;
+  }
+
+  int64_t count = time.count();
+  totalTime_.fetch_add(count, std::memory_order_relaxed);
+
+  int64_t max = maxTime_.load(std::memory_order_relaxed);
+  while (max < count) {
+    if (maxTime_.compare_exchange_weak(max, count)) {
+      break;
+    }
+  }
+}
+
+ProtocolDetectionStats ProtocolDetector::stats() const noexcept {
+  ProtocolDetectionStats retval;
+  retval.detected    = detected_;
+  retval.defaulted   = defaulted_;
+  retval.unknown     = unknown_;
+  retval.disconnects = disconnects_;
+  retval.timeouts    = timeouts_;
+  retval.peeks       = peeks_.load(std::memory_order_relaxed);
+  retval.totalTime =
+      std::chrono::nanoseconds{totalTime_.load(std::memory_order_relaxed)};
+  retval.maxTime =
+      std::chrono::nanoseconds{maxTime_.load(std::memory_order_relaxed)};
+  return retval;
+}
+} // namespace ss
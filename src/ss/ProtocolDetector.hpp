@@ -0,0 +1,92 @@
+// ProtocolDetector.hpp
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include "ss/ProtocolDetectionOptions.hpp"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace ss {
+/**\brief signatures of protocols on shared endpoint and counters of their
+ * detection. Shared by all connections of a server
+ * \note thread-safe
+ */
+class ProtocolDetector final {
+public:
+  struct Signature {
+    std::string           prefix;
+    RequestHandlerFactory factory;
+  };
+
+  /**\brief result of detection of one connection
+   */
+  enum class Result {
+    Detected,
+    Defaulted,
+    Unknown,
+    Disconnect,
+  };
+
+  /**\param defaultFactory handles connections without known signature, can
+   * be nullptr, then such connections are closed
+   * \throw std::invalid_argument if some signature is empty or longer than
+   * MAX_PROTOCOL_SIGNATURE_SIZE
+   */
+  ProtocolDetector(std::vector<Signature>          signatures,
+                   RequestHandlerFactory           defaultFactory,
+                   const ProtocolDetectionOptions &options);
+
+  const ProtocolDetectionOptions &options() const noexcept {
+    return options_;
+  }
+
+  const RequestHandlerFactory &defaultFactory() const noexcept {
+    return defaultFactory_;
+  }
+
+  /**\return count of bytes, which are enough for compare with any signature
+   */
+  size_t peekSize() const noexcept {
+    return peekSize_;
+  }
+
+  /**\return first registered signature, which is prefix of the bytes, or
+   * nullptr
+   * \param needMore set to true, if there is no such signature, but the bytes
+   * are prefix of some signature, so next bytes can match it
+   */
+  const Signature *match(std::string_view peeked, bool &needMore) const
+      noexcept;
+
+  void countPeek() noexcept {
+    peeks_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void countTimeout() noexcept {
+    ++timeouts_;
+  }
+
+  void countResult(Result result, std::chrono::nanoseconds time) noexcept;
+
+  ProtocolDetectionStats stats() const noexcept;
+
+private:
+  std::vector<Signature>   signatures_;
+  RequestHandlerFactory    defaultFactory_;
+  ProtocolDetectionOptions options_;
+  size_t                   peekSize_ = 0;
+
+  std::atomic<size_t>  detected_{0};
+  std::atomic<size_t>  defaulted_{0};
+  std::atomic<size_t>  unknown_{0};
+  std::atomic<size_t>  disconnects_{0};
+  std::atomic<size_t>  timeouts_{0};
+  std::atomic<size_t>  peeks_{0};
+  std::atomic<int64_t> totalTime_{0};
+  std::atomic<int64_t> maxTime_{0};
+};
+
+using ProtocolDetectorPtr = std::shared_ptr<ProtocolDetector>;
+} // namespace ss
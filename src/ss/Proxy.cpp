@@ -0,0 +1,20 @@
+// Proxy.cpp
+
+#include "Proxy.hpp"
+
+namespace ss {
+Proxy::Proxy(Endpoint upstream, const ProxyOptions &options) noexcept
+    : upstream_{std::move(upstream)}
+    , options_{options} {
+}
+
+ProxyStats Proxy::stats() const noexcept {
+  ProxyStats retval;
+  retval.sessions         = sessions_;
+  retval.upstreamConnects = upstreamConnects_;
+  retval.upstreamFailures = upstreamFailures_;
+  retval.splicedBytes     = splicedBytes_.load(std::memory_order_relaxed);
+  retval.copiedBytes      = copiedBytes_.load(std::memory_order_relaxed);
+  return retval;
+}
+} // namespace ss
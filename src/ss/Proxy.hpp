@@ -0,0 +1,61 @@
+// Proxy.hpp
+
+#pragma once
+
+#include "ss/ProxyOptions.hpp"
+#include <atomic>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <memory>
+
+namespace ss {
+namespace asio = boost::asio;
+
+/**\brief state of proxy mode, which is shared by all proxy sessions of a
+ * server: the upstream and counters
+ * \note thread-safe
+ */
+class Proxy final {
+public:
+  using Endpoint = asio::generic::stream_protocol::endpoint;
+
+  Proxy(Endpoint upstream, const ProxyOptions &options) noexcept;
+
+  const Endpoint &upstream() const noexcept {
+    return upstream_;
+  }
+
+  const ProxyOptions &options() const noexcept {
+    return options_;
+  }
+
+  void countSession() noexcept {
+    ++sessions_;
+  }
+
+  void countConnect(bool failed) noexcept {
+    ++(failed ? upstreamFailures_ : upstreamConnects_);
+  }
+
+  void countSpliced(size_t bytes) noexcept {
+    splicedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void countCopied(size_t bytes) noexcept {
+    copiedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  ProxyStats stats() const noexcept;
+
+private:
+  Endpoint     upstream_;
+  ProxyOptions options_;
+
+  std::atomic<size_t> sessions_{0};
+  std::atomic<size_t> upstreamConnects_{0};
+  std::atomic<size_t> upstreamFailures_{0};
+  std::atomic<size_t> splicedBytes_{0};
+  std::atomic<size_t> copiedBytes_{0};
+};
+
+using ProxyPtr = std::shared_ptr<Proxy>;
+} // namespace ss
@@ -0,0 +1,414 @@
+// ProxySession.hpp
+
+#pragma once
+
+#include "Proxy.hpp"
+#include "RawSocketOption.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <cstring>
+#include <optional>
+#include <simple_logs/logs.hpp>
+#include <vector>
+
+#if defined(__unix__)
+#  include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  define SS_HAS_SPLICE 1
+#endif
+
+namespace ss {
+namespace asio = boost::asio;
+
+
+/**\brief session of proxy mode: connects to the upstream and forwards bytes
+ * in both directions until both sides finish sending. Every direction moves
+ * bytes by splice(2) from the source socket to its own pipe and from the pipe
+ * to the destination socket, and waits for readiness of the sockets only when
+ * splice would block. If splice is not available, then bytes are copied
+ * through a buffer by usual async reads and writes. Both directions are
+ * serialized by the strand
+ */
+template <typename Protocol>
+class ProxySession final
+    : public std::enable_shared_from_this<ProxySession<Protocol>> {
+public:
+  using Socket   = asio::basic_stream_socket<Protocol>;
+  using Upstream = asio::generic::stream_protocol::socket;
+  using Strand   = asio::strand<typename Socket::executor_type>;
+
+  ProxySession(Socket               socket,
+               ProxyPtr             proxy,
+               const SocketOptions &socketOptions) noexcept
+      : socket_{std::move(socket)}
+      , strand_{asio::make_strand(socket_.get_executor())}
+      , upstream_{strand_}
+      , proxy_{std::move(proxy)}
+      , noDelay_{socketOptions.noDelay} {
+    LOG_TRACE("construct proxy session");
+
+    applySessionSocketOptions<Protocol>(socket_, socketOptions);
+  }
+
+  ~ProxySession() {
+    this->closePipes();
+  }
+
+  void start() {
+    LOG_TRACE("start proxy session");
+
+    proxy_->countSession();
+    asio::dispatch(strand_, [self = this->shared_from_this()]() {
+      self->connect();
+    });
+  }
+
+  /**\note can be called from any thread
+   */
+  void close() {
+    asio::dispatch(strand_, [self = this->shared_from_this()]() {
+      self->finish(asio::error::operation_aborted);
+    });
+  }
+
+  bool isOpen() const noexcept {
+    return open_;
+  }
+
+private:
+  /**\brief state of forwarding in one direction
+   */
+  struct Direction {
+    int    pipe[2]  = {-1, -1};
+    size_t capacity = 0; // of the pipe
+
+    // bytes, which are readed from the source, but not writed yet
+    size_t pending = 0;
+
+    bool eof  = false; // source finished sending
+    bool done = false; // eof is forwarded to the destination
+
+    std::vector<char> buffer; // for copying
+  };
+
+  void connect() {
+    if (open_ == false) {
+      return;
+    }
+
+    upstream_.async_connect(
+        proxy_->upstream(),
+        asio::bind_executor(strand_,
+                            [self = this->shared_from_this()](error_code err) {
+                              self->atConnect(err);
+                            }));
+  }
+
+  void atConnect(error_code err) {
+    if (open_ == false) {
+      return;
+    }
+
+    proxy_->countConnect(err.failed());
+    if (err.failed()) {
+      LOG_WARNING("can not connect to upstream: %1%", err.message());
+      this->finish(err);
+      return;
+    }
+
+    if (proxy_->upstream().protocol().family() != AF_UNIX &&
+        noDelay_.has_value()) {
+      setSocketOption(upstream_,
+                      IPPROTO_TCP,
+                      TCP_NODELAY,
+                      std::optional<int>{noDelay_.value()},
+                      "TCP_NODELAY");
+    }
+
+    this->startForwarding();
+  }
+
+  void startForwarding() {
+    // splice must not block, and for async operations it doesn't matter
+    error_code err;
+    socket_.non_blocking(true, err);
+    if (err.failed() == false) {
+      upstream_.non_blocking(true, err);
+    }
+    if (err.failed()) {
+      this->finish(err);
+      return;
+    }
+
+#ifdef SS_HAS_SPLICE
+    const ProxyOptions &options = proxy_->options();
+    if (options.splice) {
+      splice_ = openPipe(toUpstream_, options.pipeSize) &&
+                openPipe(toDownstream_, options.pipeSize);
+      if (splice_ == false) {
+        LOG_WARNING("can not create pipe, so bytes are copied: %1%",
+                    std::strerror(errno));
+      }
+    }
+#endif
+
+    this->forward(socket_, upstream_, toUpstream_);
+    this->forward(upstream_, socket_, toDownstream_);
+  }
+
+  template <typename Source, typename Destination>
+  void forward(Source &source, Destination &destination, Direction &direction) {
+#ifdef SS_HAS_SPLICE
+    if (splice_) {
+      this->pump(source, destination, direction);
+      return;
+    }
+#endif
+
+    this->copy(source, destination, direction);
+  }
+
+#ifdef SS_HAS_SPLICE
+  static bool openPipe(Direction &direction, size_t size) noexcept {
+    if (::pipe2(direction.pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+      return false;
+    }
+
+    // if the size can not be set, then the default is used
+    if (size != 0) {
+      ::fcntl(direction.pipe[1], F_SETPIPE_SZ, static_cast<int>(size));
+    }
+
+    int capacity       = ::fcntl(direction.pipe[1], F_GETPIPE_SZ);
+    direction.capacity = capacity > 0 ? capacity : 64 * 1024;
+    return true;
+  }
+
+  /**\brief move bytes from the source to the destination by splice, until
+   * one of them would block
+   */
+  template <typename Source, typename Destination>
+  void pump(Source &source, Destination &destination, Direction &direction) {
+    while (open_) {
+      // pipe is drained before next read, so it always has space for the
+      // read
+      while (direction.pending != 0) {
+        ssize_t moved = ::splice(direction.pipe[0],
+                                 nullptr,
+                                 destination.native_handle(),
+                                 nullptr,
+                                 direction.pending,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (moved > 0) {
+          direction.pending -= moved;
+          proxy_->countSpliced(moved);
+          continue;
+        }
+
+        if (moved < 0 && errno == EINTR) {
+          continue;
+        }
+        if (moved < 0 && errno == EAGAIN) {
+          this->wait(destination,
+                     asio::socket_base::wait_write,
+                     source,
+                     destination,
+                     direction);
+          return;
+        }
+
+        this->finish(error_code{errno, boost::system::system_category()});
+        return;
+      }
+
+      if (direction.eof) {
+        this->atEof(direction);
+        return;
+      }
+
+      ssize_t moved = ::splice(source.native_handle(),
+                               nullptr,
+                               direction.pipe[1],
+                               nullptr,
+                               direction.capacity,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (moved > 0) {
+        direction.pending = moved;
+        continue;
+      }
+      if (moved == 0) {
+        direction.eof = true;
+        continue;
+      }
+
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        this->wait(source,
+                   asio::socket_base::wait_read,
+                   source,
+                   destination,
+                   direction);
+        return;
+      }
+      if (errno == EINVAL) {
+        LOG_DEBUG("splice is not supported by the socket, so bytes are "
+                  "copied");
+        this->copy(source, destination, direction);
+        return;
+      }
+
+      this->finish(error_code{errno, boost::system::system_category()});
+      return;
+    }
+  }
+
+  template <typename Waited, typename Source, typename Destination>
+  void wait(Waited &                     waited,
+            asio::socket_base::wait_type type,
+            Source &                     source,
+            Destination &                destination,
+            Direction &                  direction) {
+    waited.async_wait(
+        type,
+        asio::bind_executor(strand_,
+                            [self = this->shared_from_this(),
+                             &source,
+                             &destination,
+                             &direction](error_code err) {
+                              if (err.failed()) {
+                                self->finish(err);
+                                return;
+                              }
+
+                              self->pump(source, destination, direction);
+                            }));
+  }
+#endif
+
+  /**\brief fallback: move bytes through the buffer of the direction
+   */
+  template <typename Source, typename Destination>
+  void copy(Source &source, Destination &destination, Direction &direction) {
+    if (open_ == false) {
+      return;
+    }
+
+    if (direction.buffer.empty()) {
+      direction.buffer.resize(
+          std::max<size_t>(proxy_->options().bufferSize, 1));
+    }
+
+    source.async_read_some(
+        asio::buffer(direction.buffer),
+        asio::bind_executor(
+            strand_,
+            [self = this->shared_from_this(),
+             &source,
+             &destination,
+             &direction](error_code readErr, size_t readed) {
+              if (readErr == asio::error::eof) {
+                direction.eof = true;
+                self->atEof(direction);
+                return;
+              }
+              if (readErr.failed()) {
+                self->finish(readErr);
+                return;
+              }
+
+              direction.pending = readed;
+              asio::async_write(
+                  destination,
+                  asio::buffer(direction.buffer.data(), readed),
+                  asio::bind_executor(
+                      self->strand_,
+                      [self, &source, &destination, &direction](
+                          error_code writeErr,
+                          size_t     writed) {
+                        if (writeErr.failed()) {
+                          self->finish(writeErr);
+                          return;
+                        }
+
+                        direction.pending = 0;
+                        self->proxy_->countCopied(writed);
+                        self->copy(source, destination, direction);
+                      }));
+            }));
+  }
+
+  /**\brief the source of the direction finished sending and all its bytes
+   * are forwarded
+   */
+  void atEof(Direction &direction) {
+    if (open_ == false) {
+      return;
+    }
+
+    direction.done = true;
+
+    error_code err;
+    if (&direction == &toUpstream_) {
+      upstream_.shutdown(asio::socket_base::shutdown_send, err);
+    } else {
+      socket_.shutdown(asio::socket_base::shutdown_send, err);
+    }
+
+    if (toUpstream_.done && toDownstream_.done) {
+      this->finish(error_code{});
+    }
+  }
+
+  void finish(error_code err) noexcept {
+    if (open_.exchange(false) == false) {
+      return;
+    }
+
+    if (err.failed() && err != asio::error::operation_aborted) {
+      LOG_DEBUG("proxy session error: %1%", err.message());
+    }
+
+    // all pending operations are canceled, and their handlers do nothing
+    error_code ignored;
+    upstream_.close(ignored);
+    socket_.close(ignored);
+
+    this->closePipes();
+
+    LOG_TRACE("end of proxy session");
+  }
+
+  void closePipes() noexcept {
+    for (Direction *direction : {&toUpstream_, &toDownstream_}) {
+      for (int &handle : direction->pipe) {
+        if (handle != -1) {
+          ::close(handle);
+          handle = -1;
+        }
+      }
+    }
+  }
+
+private:
+  Socket   socket_;
+  Strand   strand_;
+  Upstream upstream_;
+  ProxyPtr proxy_;
+
+  std::optional<bool> noDelay_;
+  std::atomic<bool>   open_{true};
+  bool                splice_ = false;
+
+  Direction toUpstream_;
+  Direction toDownstream_;
+};
+} // namespace ss
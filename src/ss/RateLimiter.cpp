@@ -0,0 +1,212 @@
+// RateLimiter.cpp
+
+#include "RateLimiter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+namespace {
+// count of slots, which are checked for the address before sharing of slot
+// with other address
+constexpr size_t MAX_PROBES = 8;
+
+constexpr double NANOSECONDS = 1e9;
+
+int64_t nowNanoseconds() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             RateClock::now().time_since_epoch())
+      .count();
+}
+
+void validate(const RateLimit &limit, std::string_view name) {
+  if (limit.requestsPerSecond < 0 || limit.requestsBurst < 0 ||
+      limit.bytesPerSecond < 0 || limit.bytesBurst < 0) {
+    LOG_THROW(std::invalid_argument, "negative %1% rate limit", name);
+  }
+}
+} // namespace
+
+BucketRate::BucketRate(double perSecond, double burst) noexcept {
+  if (perSecond == 0) {
+    return;
+  }
+
+  interval  = NANOSECONDS / perSecond;
+  tolerance = (burst == 0 ? perSecond : burst) * interval;
+}
+
+
+void TokenBucket::consume(const BucketRate &rate,
+                          double            tokens,
+                          int64_t           now) noexcept {
+  if (rate.enabled() == false) {
+    return;
+  }
+
+  int64_t cost = std::llround(tokens * rate.interval);
+  int64_t tat  = tat_.load(std::memory_order_relaxed);
+  while (tat_.compare_exchange_weak(tat,
+                                    std::max(tat, now) + cost,
+                                    std::memory_order_relaxed) == false) {
+  }
+}
+
+int64_t TokenBucket::delay(const BucketRate &rate,
+                           double            tokens,
+                           int64_t           now) const noexcept {
+  if (rate.enabled() == false) {
+    return 0;
+  }
+
+  // tokens are available, when tat - now <= tolerance - tokens * interval
+  int64_t tat = std::max(tat_.load(std::memory_order_relaxed), now);
+  double  at  = tat + tokens * rate.interval - rate.tolerance;
+  return at > now ? static_cast<int64_t>(std::ceil(at - now)) : 0;
+}
+
+
+RateLimiter::RateLimiter(const RateLimitOptions &options)
+    : sessionRequests_{options.session.requestsPerSecond,
+                       options.session.requestsBurst}
+    , sessionBytes_{options.session.bytesPerSecond, options.session.bytesBurst}
+    , addressRequests_{options.address.requestsPerSecond,
+                       options.address.requestsBurst}
+    , addressBytes_{options.address.bytesPerSecond,
+                    options.address.bytesBurst} {
+  validate(options.session, "session");
+  validate(options.address, "address");
+
+  if (this->hasAddressLimit()) {
+    if (options.addressTableSize == 0) {
+      LOG_THROW(std::invalid_argument, "address table can not be empty");
+    }
+
+    // power of 2, so index is computed by mask
+    size_t size = 1;
+    while (size < options.addressTableSize) {
+      size <<= 1;
+    }
+
+    slots_ = std::make_unique<Slot[]>(size);
+    mask_  = size - 1;
+  }
+}
+
+uint64_t RateLimiter::addressKey(std::string_view address) noexcept {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char c : address) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3;
+  }
+
+  // 0 is key of empty slot
+  return hash == 0 ? 1 : hash;
+}
+
+void RateLimiter::consumeAddress(uint64_t key,
+                                 double   requests,
+                                 double   bytes,
+                                 int64_t  now) noexcept {
+  if (key == 0 || slots_ == nullptr) {
+    return;
+  }
+
+  Slot &slot = this->find(key, now);
+  if (requests != 0) {
+    slot.requests.consume(addressRequests_, requests, now);
+  }
+  if (bytes != 0) {
+    slot.bytes.consume(addressBytes_, bytes, now);
+  }
+}
+
+int64_t RateLimiter::addressDelay(uint64_t key,
+                                  double   requests,
+                                  double   bytes,
+                                  int64_t  now) noexcept {
+  if (key == 0 || slots_ == nullptr) {
+    return 0;
+  }
+
+  Slot &  slot   = this->find(key, now);
+  int64_t retval = 0;
+  if (requests != 0) {
+    retval = slot.requests.delay(addressRequests_, requests, now);
+  }
+  if (bytes != 0) {
+    retval = std::max(retval, slot.bytes.delay(addressBytes_, bytes, now));
+  }
+  return retval;
+}
+
+RateLimiter::Slot &RateLimiter::find(uint64_t key, int64_t now) noexcept {
+  size_t index = key & mask_;
+  for (size_t i = 0; i < MAX_PROBES; ++i) {
+    Slot &   slot    = slots_[(index + i) & mask_];
+    uint64_t current = slot.key.load(std::memory_order_acquire);
+    if (current == key) {
+      return slot;
+    }
+
+    // full buckets are the same as new ones, so slot of idle address can be
+    // taken by other address
+    if (current == 0 || (slot.requests.idle(now) && slot.bytes.idle(now))) {
+      if (slot.key.compare_exchange_strong(current,
+                                           key,
+                                           std::memory_order_acq_rel) ||
+          current == key) {
+        return slot;
+      }
+    }
+  }
+
+  return slots_[index];
+}
+
+
+SessionRateLimit::SessionRateLimit(RateLimiterPtr   limiter,
+                                   std::string_view address) noexcept
+    : limiter_{std::move(limiter)} {
+  if (address.empty() == false && limiter_->hasAddressLimit()) {
+    addressKey_ = RateLimiter::addressKey(address);
+  }
+}
+
+bool SessionRateLimit::requestAllowed() noexcept {
+  int64_t now = nowNanoseconds();
+  return requests_.delay(limiter_->sessionRequests(), 1, now) == 0 &&
+         limiter_->addressDelay(addressKey_, 1, 0, now) == 0;
+}
+
+void SessionRateLimit::countRequest() noexcept {
+  int64_t now = nowNanoseconds();
+  requests_.consume(limiter_->sessionRequests(), 1, now);
+  limiter_->consumeAddress(addressKey_, 1, 0, now);
+}
+
+void SessionRateLimit::countBytes(size_t bytes) noexcept {
+  int64_t now = nowNanoseconds();
+  bytes_.consume(limiter_->sessionBytes(), bytes, now);
+  limiter_->consumeAddress(addressKey_, 0, bytes, now);
+}
+
+std::chrono::nanoseconds SessionRateLimit::delay(bool requestPending) noexcept {
+  int64_t now = nowNanoseconds();
+
+  // bytes are counted after read, so next read is allowed while there is no
+  // debt
+  int64_t retval =
+      std::max(bytes_.delay(limiter_->sessionBytes(), 1, now),
+               limiter_->addressDelay(addressKey_, 0, 1, now));
+
+  if (requestPending) {
+    retval = std::max(retval,
+                      requests_.delay(limiter_->sessionRequests(), 1, now));
+    retval = std::max(retval, limiter_->addressDelay(addressKey_, 1, 0, now));
+  }
+
+  return std::chrono::nanoseconds{retval};
+}
+} // namespace ss
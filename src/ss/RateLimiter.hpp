@@ -0,0 +1,151 @@
+// RateLimiter.hpp
+
+#pragma once
+
+#include "ss/RateLimitOptions.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace ss {
+using RateClock = std::chrono::steady_clock;
+
+/**\brief parameters of token bucket: interval between tokens and tolerance
+ * (burst), both in nanoseconds
+ */
+struct BucketRate {
+  /**\param burst 0 means one second of the rate
+   */
+  BucketRate(double perSecond, double burst) noexcept;
+
+  bool enabled() const noexcept {
+    return interval != 0;
+  }
+
+  double interval  = 0;
+  double tolerance = 0;
+};
+
+/**\brief token bucket, implemented as GCRA (generic cell rate algorithm):
+ * state of the bucket is single timestamp, when the bucket becomes full again
+ * (theoretical arrival time), so it is updated by single CAS without locks
+ */
+class TokenBucket final {
+public:
+  /**\brief spend tokens, even if there is not enough of them. Debt delays
+   * next tokens
+   */
+  void consume(const BucketRate &rate, double tokens, int64_t now) noexcept;
+
+  /**\return nanoseconds until the tokens are available, 0 if they are
+   * available now
+   */
+  int64_t delay(const BucketRate &rate, double tokens, int64_t now) const
+      noexcept;
+
+  /**\return true if the bucket is full, so its slot can be reused
+   */
+  bool idle(int64_t now) const noexcept {
+    return tat_.load(std::memory_order_relaxed) <= now;
+  }
+
+private:
+  std::atomic<int64_t> tat_{0};
+};
+
+/**\brief shared by all sessions of a server: options and buckets of
+ * addresses. Buckets are stored in open-addressing table with fixed count of
+ * slots, which are claimed by CAS of address key
+ * \note thread-safe and lock-free
+ */
+class RateLimiter final {
+public:
+  /**\throw std::invalid_argument if the options are invalid
+   */
+  explicit RateLimiter(const RateLimitOptions &options);
+
+  const BucketRate &sessionRequests() const noexcept {
+    return sessionRequests_;
+  }
+
+  const BucketRate &sessionBytes() const noexcept {
+    return sessionBytes_;
+  }
+
+  bool hasAddressLimit() const noexcept {
+    return addressRequests_.enabled() || addressBytes_.enabled();
+  }
+
+  /**\return not 0 key of the address
+   * \param address bytes of ip address
+   */
+  static uint64_t addressKey(std::string_view address) noexcept;
+
+  void consumeAddress(uint64_t key,
+                      double   requests,
+                      double   bytes,
+                      int64_t  now) noexcept;
+
+  /**\return nanoseconds until the address has the tokens
+   */
+  int64_t addressDelay(uint64_t key,
+                       double   requests,
+                       double   bytes,
+                       int64_t  now) noexcept;
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> key{0};
+    TokenBucket           requests;
+    TokenBucket           bytes;
+  };
+
+  /**\return slot of the address. If there is no free slot, then slot of
+   * other address is returned, so they share the buckets
+   */
+  Slot &find(uint64_t key, int64_t now) noexcept;
+
+private:
+  BucketRate sessionRequests_;
+  BucketRate sessionBytes_;
+  BucketRate addressRequests_;
+  BucketRate addressBytes_;
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t                  mask_ = 0;
+};
+
+using RateLimiterPtr = std::shared_ptr<RateLimiter>;
+
+/**\brief buckets of one session and key of its address
+ */
+class SessionRateLimit final {
+public:
+  /**\param address bytes of ip address, or empty for not ip sessions
+   */
+  SessionRateLimit(RateLimiterPtr limiter, std::string_view address) noexcept;
+
+  /**\return true if the session and its address have token for next request
+   */
+  bool requestAllowed() noexcept;
+
+  void countRequest() noexcept;
+
+  void countBytes(size_t bytes) noexcept;
+
+  /**\return time, which the session must wait before next read, or before
+   * handling of next request if requestPending is true
+   */
+  std::chrono::nanoseconds delay(bool requestPending) noexcept;
+
+private:
+  RateLimiterPtr limiter_;
+  uint64_t       addressKey_ = 0;
+  TokenBucket    requests_;
+  TokenBucket    bytes_;
+};
+
+using SessionRateLimitPtr = std::unique_ptr<SessionRateLimit>;
+} // namespace ss
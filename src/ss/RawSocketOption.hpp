@@ -0,0 +1,153 @@
+// RawSocketOption.hpp
+/**\file
+ */
+
+#pragma once
+
+#include "ss/SocketOptions.hpp"
+#include "ss/errors.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <simple_logs/logs.hpp>
+
+#if defined(__linux__)
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#endif
+
+namespace ss {
+namespace asio = boost::asio;
+
+using tcp = asio::ip::tcp;
+
+
+/**\brief integer socket option with level and name known only at runtime
+ */
+class RawSocketOption {
+public:
+  RawSocketOption(int level, int name, int value) noexcept
+      : level_{level}
+      , name_{name}
+      , value_{value} {
+  }
+
+  template <typename Protocol>
+  int level(const Protocol &) const noexcept {
+    return level_;
+  }
+
+  template <typename Protocol>
+  int name(const Protocol &) const noexcept {
+    return name_;
+  }
+
+  template <typename Protocol>
+  const int *data(const Protocol &) const noexcept {
+    return &value_;
+  }
+
+  template <typename Protocol>
+  size_t size(const Protocol &) const noexcept {
+    return sizeof(value_);
+  }
+
+private:
+  int level_;
+  int name_;
+  int value_;
+};
+
+template <typename Socket>
+void setSocketOption(Socket &                 socket,
+                     int                      level,
+                     int                      name,
+                     const std::optional<int> value,
+                     const char *             optionName) noexcept {
+  if (value.has_value() == false) {
+    return;
+  }
+
+  error_code err;
+  socket.set_option(RawSocketOption{level, name, value.value()}, err);
+  if (err.failed()) {
+    LOG_WARNING("can not set %1% to %2%: %3%",
+                optionName,
+                value.value(),
+                err.message());
+  }
+}
+
+/**\brief apply options, which have sense for both acceptor and session
+ * sockets
+ */
+template <typename Protocol, typename Socket>
+void applyCommonSocketOptions(Socket &socket, const SocketOptions &options) {
+  setSocketOption(socket,
+                  SOL_SOCKET,
+                  SO_RCVBUF,
+                  options.receiveBufferSize,
+                  "SO_RCVBUF");
+  setSocketOption(socket,
+                  SOL_SOCKET,
+                  SO_SNDBUF,
+                  options.sendBufferSize,
+                  "SO_SNDBUF");
+}
+
+template <typename Protocol, typename Socket>
+void applyAcceptorSocketOptions(Socket &socket, const SocketOptions &options) {
+  applyCommonSocketOptions<Protocol>(socket, options);
+
+  if constexpr (std::is_same_v<Protocol, tcp>) {
+#ifdef TCP_DEFER_ACCEPT
+    setSocketOption(socket,
+                    IPPROTO_TCP,
+                    TCP_DEFER_ACCEPT,
+                    options.deferAccept,
+                    "TCP_DEFER_ACCEPT");
+#endif
+#ifdef TCP_FASTOPEN
+    setSocketOption(socket,
+                    IPPROTO_TCP,
+                    TCP_FASTOPEN,
+                    options.fastOpen,
+                    "TCP_FASTOPEN");
+#endif
+  }
+}
+
+template <typename Protocol, typename Socket>
+void applySessionSocketOptions(Socket &socket, const SocketOptions &options) {
+  applyCommonSocketOptions<Protocol>(socket, options);
+
+#ifdef SO_BUSY_POLL
+  setSocketOption(socket,
+                  SOL_SOCKET,
+                  SO_BUSY_POLL,
+                  options.busyPoll,
+                  "SO_BUSY_POLL");
+#endif
+
+  if constexpr (std::is_same_v<Protocol, tcp>) {
+    setSocketOption(socket,
+                    IPPROTO_TCP,
+                    TCP_NODELAY,
+                    options.noDelay,
+                    "TCP_NODELAY");
+#ifdef TCP_QUICKACK
+    setSocketOption(socket,
+                    IPPROTO_TCP,
+                    TCP_QUICKACK,
+                    options.quickAck,
+                    "TCP_QUICKACK");
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+    setSocketOption(socket,
+                    IPPROTO_TCP,
+                    TCP_NOTSENT_LOWAT,
+                    options.notSentLowAt,
+                    "TCP_NOTSENT_LOWAT");
+#endif
+  }
+}
+} // namespace ss
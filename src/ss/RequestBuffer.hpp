@@ -0,0 +1,153 @@
+// RequestBuffer.hpp
+
+#pragma once
+
+#include <algorithm>
+#include <boost/asio/buffer.hpp>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#define MIN_READ_SIZE         1024 * 4
+#define MAX_READ_SIZE         1024 * 1000
+#define SHRINK_AFTER_READS    16
+#define SHRINK_CAPACITY_RATIO 4
+
+namespace ss {
+namespace asio = boost::asio;
+
+/**\brief linear buffer for requests. Consumed data at the begin is not
+ * erased immediately, so partial requests doesn't cause memmove after every
+ * read. Data is moved to the begin of the storage only if there is not enough
+ * space at the end for next read.
+ *
+ * Size of next read is adapted: it grows if previous read filled all
+ * prepared space, and shrinks after several small reads. Storage, which is
+ * much bigger then current read size, is released when the buffer becomes
+ * empty
+ */
+class RequestBuffer final {
+public:
+  /**\param maxSize max count of not consumed bytes. 0 means unlimited
+   */
+  explicit RequestBuffer(size_t maxSize = 0) noexcept
+      : maxSize_{maxSize} {
+  }
+
+  /**\return not consumed data
+   */
+  std::string_view data() const noexcept {
+    return std::string_view{storage_.get() + begin_, end_ - begin_};
+  }
+
+  size_t size() const noexcept {
+    return end_ - begin_;
+  }
+
+  bool empty() const noexcept {
+    return begin_ == end_;
+  }
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /**\return true if count of not consumed bytes reached max size, so nothing
+   * can be readed anymore
+   */
+  bool full() const noexcept {
+    return maxSize_ != 0 && this->size() >= maxSize_;
+  }
+
+  /**\return space for next read. Can be empty if the buffer is full
+   */
+  asio::mutable_buffer prepare() {
+    size_t readSize = readSize_;
+    if (maxSize_ != 0) {
+      size_t available = maxSize_ - std::min(maxSize_, this->size());
+      readSize         = std::min(readSize, available);
+    }
+
+    if (capacity_ - end_ < readSize) {
+      if (begin_ != 0 && capacity_ - this->size() >= readSize) {
+        this->compact();
+      } else {
+        // grow geometrically, so big partial requests doesn't cause copying
+        // after every read
+        this->reallocate(std::max(this->size() + readSize, capacity_ * 2));
+      }
+    }
+
+    prepared_ = readSize;
+    return asio::buffer(storage_.get() + end_, readSize);
+  }
+
+  /**\brief move readed bytes to data and adapt size of next read
+   */
+  void commit(size_t readed) noexcept {
+    end_ += readed;
+
+    if (readed == prepared_) {
+      readSize_   = std::min<size_t>(readSize_ * 2, MAX_READ_SIZE);
+      smallReads_ = 0;
+    } else if (readed < readSize_ / 4) {
+      if (++smallReads_ >= SHRINK_AFTER_READS) {
+        readSize_   = std::max<size_t>(readSize_ / 2, MIN_READ_SIZE);
+        smallReads_ = 0;
+      }
+    } else {
+      smallReads_ = 0;
+    }
+  }
+
+  void consume(size_t length) {
+    begin_ += std::min(length, this->size());
+
+    if (begin_ == end_) {
+      begin_ = 0;
+      end_   = 0;
+
+      if (capacity_ > readSize_ * SHRINK_CAPACITY_RATIO) {
+        this->reallocate(readSize_);
+      }
+    }
+  }
+
+  void clear() {
+    this->consume(this->size());
+  }
+
+private:
+  void compact() noexcept {
+    size_t size = this->size();
+    std::memmove(storage_.get(), storage_.get() + begin_, size);
+    begin_ = 0;
+    end_   = size;
+  }
+
+  void reallocate(size_t capacity) {
+    size_t size = this->size();
+
+    std::unique_ptr<char[]> storage{new char[capacity]};
+    if (size != 0) {
+      std::memcpy(storage.get(), storage_.get() + begin_, size);
+    }
+
+    storage_  = std::move(storage);
+    capacity_ = capacity;
+    begin_    = 0;
+    end_      = size;
+  }
+
+private:
+  std::unique_ptr<char[]> storage_;
+  size_t                  capacity_ = 0;
+  size_t                  begin_    = 0;
+  size_t                  end_      = 0;
+
+  size_t maxSize_;
+  size_t readSize_   = MIN_READ_SIZE;
+  size_t prepared_   = 0;
+  size_t smallReads_ = 0;
+};
+} // namespace ss
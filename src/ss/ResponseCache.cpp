@@ -0,0 +1,188 @@
+// ResponseCache.cpp
+
+#include "ResponseCache.hpp"
+#include <algorithm>
+#include <mutex>
+#include <simple_logs/logs.hpp>
+
+namespace ss {
+namespace {
+// approximate memory of entry and its node in the index, which is added to
+// size of request and response
+constexpr size_t ENTRY_OVERHEAD = 128;
+} // namespace
+
+struct ResponseCache::Entry {
+  size_t size() const noexcept {
+    return request.size() + response->size() + ENTRY_OVERHEAD;
+  }
+
+  bool expired(Clock::time_point now) const noexcept {
+    return expires <= now;
+  }
+
+  size_t            hash;
+  std::string       request;
+  SharedBuffer      response;
+  Clock::time_point expires;
+
+  // set by lookups under shared lock
+  std::atomic<bool> referenced{false};
+
+  // entry was replaced, so it stays in the queue only until compaction
+  bool removed = false;
+};
+
+// shards are aligned, so counters of different shards are not in the same
+// cache line
+struct alignas(64) ResponseCache::Shard {
+  mutable std::shared_mutex           mutex;
+  std::unordered_map<size_t, Entry *> index;
+  std::deque<EntryPtr>                queue;
+  size_t                              bytes   = 0;
+  size_t                              removed = 0;
+
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+  std::atomic<size_t> inserts{0};
+  std::atomic<size_t> evictions{0};
+};
+
+ResponseCache::ResponseCache(const ResponseCacheOptions &options)
+    : ttl_{options.ttl}
+    , shardsCount_{options.shards} {
+  if (options.shards == 0) {
+    LOG_THROW(std::invalid_argument, "response cache must have shards");
+  }
+  if (options.maxBytes / options.shards == 0) {
+    LOG_THROW(std::invalid_argument,
+              "too small memory budget of response cache: %1%",
+              options.maxBytes);
+  }
+
+  shardBytes_ = options.maxBytes / options.shards;
+  shards_     = std::make_unique<Shard[]>(shardsCount_);
+}
+
+ResponseCache::~ResponseCache() = default;
+
+SharedBuffer ResponseCache::find(std::string_view request) noexcept {
+  size_t hash  = std::hash<std::string_view>{}(request);
+  Shard &shard = this->shard(hash);
+
+  {
+    std::shared_lock<std::shared_mutex> lock{shard.mutex};
+
+    auto found = shard.index.find(hash);
+    if (found != shard.index.end()) {
+      Entry &entry = *found->second;
+      if (entry.request == request &&
+          (ttl_.count() == 0 || entry.expired(Clock::now()) == false)) {
+        entry.referenced.store(true, std::memory_order_relaxed);
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        return entry.response;
+      }
+    }
+  }
+
+  shard.misses.fetch_add(1, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void ResponseCache::insert(std::string_view request, SharedBuffer response) {
+  EntryPtr entry = std::make_unique<Entry>();
+  entry->hash     = std::hash<std::string_view>{}(request);
+  entry->request  = request;
+  entry->response = std::move(response);
+
+  size_t size = entry->size();
+  if (size > shardBytes_) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  if (ttl_.count() != 0) {
+    entry->expires = now + ttl_;
+  }
+
+  Shard &                            shard = this->shard(entry->hash);
+  std::lock_guard<std::shared_mutex> lock{shard.mutex};
+
+  auto found = shard.index.find(entry->hash);
+  if (found != shard.index.end()) {
+    // response is released now, and the entry is removed from the queue later
+    Entry *previous   = found->second;
+    shard.bytes      -= previous->size();
+    previous->removed = true;
+    previous->response.reset();
+    ++shard.removed;
+
+    shard.index.erase(found);
+  }
+
+  this->evict(shard, size, now);
+
+  shard.bytes += size;
+  shard.index.emplace(entry->hash, entry.get());
+  shard.queue.emplace_back(std::move(entry));
+  shard.inserts.fetch_add(1, std::memory_order_relaxed);
+
+  if (shard.removed * 2 > shard.queue.size()) {
+    this->compact(shard);
+  }
+}
+
+ResponseCacheStats ResponseCache::stats() const noexcept {
+  ResponseCacheStats retval;
+  for (size_t i = 0; i < shardsCount_; ++i) {
+    const Shard &shard = shards_[i];
+
+    retval.hits += shard.hits.load(std::memory_order_relaxed);
+    retval.misses += shard.misses.load(std::memory_order_relaxed);
+    retval.inserts += shard.inserts.load(std::memory_order_relaxed);
+    retval.evictions += shard.evictions.load(std::memory_order_relaxed);
+
+    std::shared_lock<std::shared_mutex> lock{shard.mutex};
+    retval.entries += shard.index.size();
+    retval.bytes += shard.bytes;
+  }
+  return retval;
+}
+
+ResponseCache::Shard &ResponseCache::shard(size_t hash) const noexcept {
+  return shards_[hash % shardsCount_];
+}
+
+void ResponseCache::evict(Shard &shard, size_t size, Clock::time_point now) {
+  while (shard.bytes + size > shardBytes_ && shard.queue.empty() == false) {
+    EntryPtr entry = std::move(shard.queue.front());
+    shard.queue.pop_front();
+
+    if (entry->removed) {
+      --shard.removed;
+      continue;
+    }
+
+    // second chance for entries, which were found since previous pass
+    if (entry->referenced.exchange(false, std::memory_order_relaxed) &&
+        (ttl_.count() == 0 || entry->expired(now) == false)) {
+      shard.queue.emplace_back(std::move(entry));
+      continue;
+    }
+
+    shard.bytes -= entry->size();
+    shard.index.erase(entry->hash);
+    shard.evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void ResponseCache::compact(Shard &shard) {
+  shard.queue.erase(std::remove_if(shard.queue.begin(),
+                                   shard.queue.end(),
+                                   [](const EntryPtr &entry) {
+                                     return entry->removed;
+                                   }),
+                    shard.queue.end());
+  shard.removed = 0;
+}
+} // namespace ss
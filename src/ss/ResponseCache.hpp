@@ -0,0 +1,71 @@
+// ResponseCache.hpp
+
+#pragma once
+
+#include "ss/ResponseCacheOptions.hpp"
+#include "ss/SessionHandle.hpp"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace ss {
+/**\brief cache of responses, keyed by bytes of requests. The cache is divided
+ * to shards by hash of the request, and every shard has own lock. Lookups
+ * take the lock in shared mode, so they doesn't block each other.
+ *
+ * Eviction policy is CLOCK (FIFO with second chance): lookup only sets
+ * reference bit of the entry, so it doesn't modify the queue. Evicted entry is
+ * taken from head of the queue: if it is referenced, then the bit is cleared
+ * and the entry is moved to the tail, otherwise it is removed. Expired entries
+ * are removed regardless of the bit
+ * \note thread-safe
+ */
+class ResponseCache final {
+public:
+  /**\throw std::invalid_argument if the options are invalid
+   */
+  explicit ResponseCache(const ResponseCacheOptions &options);
+
+  ~ResponseCache();
+
+  /**\return cached response for the request, or nullptr
+   */
+  SharedBuffer find(std::string_view request) noexcept;
+
+  /**\brief insert or replace response for the request
+   */
+  void insert(std::string_view request, SharedBuffer response);
+
+  ResponseCacheStats stats() const noexcept;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry;
+  using EntryPtr = std::unique_ptr<Entry>;
+
+  struct Shard;
+
+  Shard &shard(size_t hash) const noexcept;
+
+  /**\brief remove entries from head of the queue, until the shard has space
+   * for the size
+   */
+  void evict(Shard &shard, size_t size, Clock::time_point now);
+
+  /**\brief remove replaced entries from the queue
+   */
+  void compact(Shard &shard);
+
+private:
+  size_t                   shardBytes_;
+  std::chrono::nanoseconds ttl_;
+  std::unique_ptr<Shard[]> shards_;
+  size_t                   shardsCount_;
+};
+
+using ResponseCachePtr = std::shared_ptr<ResponseCache>;
+} // namespace ss
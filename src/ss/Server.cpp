@@ -1,22 +1,27 @@
 // Server.cpp
 
 #include "ss/Server.hpp"
-#include <boost/asio/bind_executor.hpp>
+#include "Probes.hpp"
+#include "ProtocolDetection.hpp"
+#include "Proxy.hpp"
+#include "ProxySession.hpp"
+#include "RateLimiter.hpp"
+#include "RawSocketOption.hpp"
+#include "ResponseCache.hpp"
+#include "Session.hpp"
+#include "StreamCodec.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
 #include <boost/asio/coroutine.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/local/stream_protocol.hpp>
-#include <boost/asio/read.hpp>
-#include <boost/asio/strand.hpp>
-#include <boost/asio/version.hpp>
-#include <boost/asio/write.hpp>
 #include <list>
+#include <mutex>
 #include <regex>
 #include <simple_logs/logs.hpp>
-#include <sstream>
 #include <thread>
-
-#define REQ_BUFFER_RESERVED 1024 * 1000
-#define RES_BUFFER_RESERVED 1024 * 1000
+#include <vector>
 
 // XXX must be after <thread>
 #include <boost/asio/yield.hpp>
@@ -27,197 +32,31 @@ namespace asio = boost::asio;
 using tcp             = asio::ip::tcp;
 using stream_protocol = asio::local::stream_protocol;
 
+namespace {
+/**\param endpoint must contains ip and port
+ * \throw std::invalid_argument if the endpoint is invalid
+ */
+tcp::endpoint makeTcpEndpoint(const std::string &endpoint) {
+  std::regex  hostAndPortReg{R"(([^:]+):(\d{1,5}))"};
+  std::smatch match;
 
-template <typename Protocol>
-class Session final
-    : public asio::coroutine
-    , public std::enable_shared_from_this<Session<Protocol>> {
-public:
-  using Self     = std::shared_ptr<Session>;
-  using Socket   = asio::basic_stream_socket<Protocol>;
-  using Endpoint = typename Protocol::endpoint;
-  using Strand   = asio::strand<typename Socket::executor_type>;
-
-  Session(Socket socket, RequestHandler handler) noexcept
-      : socket_ {
-    std::move(socket)
-  }
-#if BOOST_ASIO_VERSION > 101400
-  , strand_ {
-    asio::make_strand(socket_.get_executor())
-  }
-#else
-  , strand_ {
-    socket_.get_executor()
-  }
-#endif
-  , reqHandler_{handler} {
-    LOG_TRACE("construct session");
-
-    reqBuffer_.reserve(REQ_BUFFER_RESERVED);
-    resBuffer_.reserve(RES_BUFFER_RESERVED);
-  }
-
-  void start() {
-    LOG_TRACE("start new session");
-
-    Self self = this->shared_from_this();
-
-
-    std::stringstream remoteEndpoint;
-    remoteEndpoint << socket_.remote_endpoint();
-    error_code err = self->reqHandler_->atSessionStart(remoteEndpoint.str());
-    if (err.failed()) {
-      LOG_ERROR(err.message());
-      LOG_WARNING("session doesn't start, because get handler error");
-      return;
-    }
-
-    this->operator()(std::move(self), error_code{}, 0);
+  if (std::regex_match(endpoint, match, hostAndPortReg) == false) {
+    LOG_THROW(std::invalid_argument, "invalid host or port");
   }
 
-  void close() {
-    if (socket_.is_open() == false) {
-      LOG_WARNING("session already closed");
-      return;
-    }
-
-    LOG_TRACE("close session");
+  std::string host = match[1];
+  std::string port = match[2];
 
-    error_code err;
 
-    // cancel all async operation with this socket
-    socket_.cancel(err);
-    if (err.failed()) {
-      LOG_ERROR(err.message());
-    }
+  error_code err;
+  auto       addr = asio::ip::make_address(host, err);
+  if (err.failed()) {
+    LOG_THROW(std::invalid_argument, "invalid address: %1%", host);
   }
 
-  /**\note all async operations with socket must be already canceled
-   */
-  void atClose() {
-    LOG_TRACE("at session close");
-
-    reqHandler_->atSessionClose();
-
-    error_code err;
-    socket_.shutdown(Socket::shutdown_both, err);
-    if (err.failed()) {
-      LOG_ERROR(err.message());
-    }
-
-    socket_.close(err);
-    if (err.failed()) {
-      LOG_ERROR(err.message());
-    }
-  }
-
-  bool isOpen() const {
-    return socket_.is_open();
-  }
-
-
-private:
-  void operator()(Self self, error_code err, size_t transfered) {
-    if (err.failed()) {
-      if (err == asio::error::eof) {
-        LOG_DEBUG("client close connection");
-      } else if (err == asio::error::operation_aborted) {
-        LOG_DEBUG("session canceled");
-      } else {
-        LOG_ERROR(err.message());
-      }
-
-      this->atClose();
-
-      LOG_DEBUG("end of session coroutine");
-      return;
-    }
-
-    reenter(this) {
-      for (;;) {
-        yield asio::async_read(
-            socket_,
-            asio::dynamic_buffer(reqBuffer_),
-            asio::transfer_at_least(1),
-            asio::bind_executor(strand_,
-                                std::bind(&Session::operator(),
-                                          this,
-                                          std::move(self),
-                                          std::placeholders::_1,
-                                          std::placeholders::_2)));
-
-        LOG_DEBUG("readed: %1.3fKb", transfered / 1024.);
-
-
-        // request handling
-        {
-          std::string_view reqBufferView = reqBuffer_;
-          for (;;) {
-            size_t reqIgnoreLength = 0;
-            err                    = reqHandler_->handle(reqBufferView,
-                                      std::back_inserter(resBuffer_),
-                                      reqIgnoreLength);
-            if (err.failed() == false) {
-              if (reqIgnoreLength == 0 ||
-                  reqIgnoreLength >= reqBufferView.size()) {
-                reqBuffer_.clear();
-                break;
-              } else {
-                reqBufferView =
-                    std::string_view{reqBufferView.data() + reqIgnoreLength,
-                                     reqBufferView.size() - reqIgnoreLength};
-                continue;
-              }
-            } else { // if some error caused
-              if (err == error::SessionError::PartialData) {
-                reqBuffer_.erase(0,
-                                 reqBufferView.data() - reqBuffer_.data() +
-                                     reqIgnoreLength);
-
-                LOG_WARNING("partial data in request: %1.3fKb",
-                            reqBuffer_.size());
-
-                break;
-              }
-
-              // unexpected errors
-              this->operator()(std::move(self), err, 0);
-              return;
-            }
-          }
-        }
-
-        if (resBuffer_.empty()) {
-          continue;
-        }
-
-        yield asio::async_write(
-            socket_,
-            asio::dynamic_buffer(resBuffer_),
-            asio::transfer_all(),
-            asio::bind_executor(strand_,
-                                std::bind(&Session::operator(),
-                                          this,
-                                          std::move(self),
-                                          std::placeholders::_1,
-                                          std::placeholders::_2)));
-
-        LOG_DEBUG("writed: %1.3fKb", transfered / 1024.);
-
-        // clear after every write
-        resBuffer_.clear();
-      }
-    }
-  }
-
-private:
-  Socket         socket_;
-  Strand         strand_;
-  RequestHandler reqHandler_;
-  std::string    reqBuffer_;
-  std::string    resBuffer_;
-};
+  return tcp::endpoint{addr, static_cast<unsigned short>(std::stoi(port))};
+}
+} // namespace
 
 
 class ServerImpl {
@@ -230,34 +69,63 @@ public:
   virtual void stopAccepting() noexcept(false) = 0;
 
   virtual void closeAllSessions() = 0;
+
+  virtual ThreadPoolStats threadPoolStats() = 0;
 };
 
 
 template <typename Protocol>
 class ServerImplStream
     : public ServerImpl
+#ifndef SS_USE_COROUTINES
     , public asio::coroutine
+#endif
     , public std::enable_shared_from_this<ServerImplStream<Protocol>> {
 public:
-  using Self       = std::shared_ptr<ServerImpl>;
-  using Endpoint   = typename Protocol::endpoint;
-  using SessionPtr = std::shared_ptr<Session<Protocol>>;
-  using Socket     = asio::basic_stream_socket<Protocol>;
-  using Acceptor   = asio::basic_socket_acceptor<Protocol>;
-
-  ServerImplStream(asio::io_context &    ioContext,
-                   Endpoint              endpoint,
-                   RequestHandlerFactory reqHandlerFactory)
+  using Self            = std::shared_ptr<ServerImpl>;
+  using Endpoint        = typename Protocol::endpoint;
+  using SessionPtr      = std::shared_ptr<Session<Protocol>>;
+  using ProxySessionPtr = std::shared_ptr<ProxySession<Protocol>>;
+  using DetectionPtr    = std::shared_ptr<ProtocolDetection<Protocol>>;
+  using Socket          = asio::basic_stream_socket<Protocol>;
+  using Acceptor        = asio::basic_socket_acceptor<Protocol>;
+
+  ServerImplStream(asio::io_context &          ioContext,
+                   Endpoint                    endpoint,
+                   RequestHandlerFactory       reqHandlerFactory,
+                   SessionOptions              sessionOptions,
+                   SocketOptions               socketOptions,
+                   std::shared_ptr<ThreadPool> threadPool,
+                   CaptureWriterPtr            capture,
+                   CompressionContextPtr       compression,
+                   RateLimiterPtr              rateLimiter,
+                   ResponseCachePtr            responseCache,
+                   MiddlewareChainPtr          middleware,
+                   ProtocolDetectorPtr         protocolDetector,
+                   ProxyPtr                    proxy)
       : ioContext_{ioContext}
       , acceptor_{ioContext}
-      , reqHandlerFactory_{std::move(reqHandlerFactory)} {
+      , reqHandlerFactory_{std::move(reqHandlerFactory)}
+      , sessionOptions_{std::move(sessionOptions)}
+      , socketOptions_{std::move(socketOptions)}
+      , threadPool_{std::move(threadPool)}
+      , rebalanceTimer_{ioContext}
+      , capture_{std::move(capture)}
+      , compression_{std::move(compression)}
+      , rateLimiter_{std::move(rateLimiter)}
+      , responseCache_{std::move(responseCache)}
+      , middleware_{std::move(middleware)}
+      , protocolDetector_{std::move(protocolDetector)}
+      , proxy_{std::move(proxy)} {
     LOG_TRACE("construct sever");
 
     Protocol protocol = endpoint.protocol();
     acceptor_.open(protocol);
     acceptor_.set_option(typename Acceptor::reuse_address(true));
+    applyAcceptorSocketOptions<Protocol>(acceptor_, socketOptions_);
     acceptor_.bind(endpoint);
-    acceptor_.listen(Socket::max_listen_connections);
+    acceptor_.listen(socketOptions_.listenBacklog.value_or(
+        static_cast<int>(Socket::max_listen_connections)));
   }
 
   void startAccepting() noexcept override {
@@ -265,18 +133,30 @@ public:
 
     Self self = this->shared_from_this();
 
+    if (threadPool_ != nullptr &&
+        threadPool_->options().rebalanceInterval.count() != 0) {
+      this->scheduleRebalance();
+    }
+
+#ifdef SS_USE_COROUTINES
+    asio::co_spawn(ioContext_, this->run(std::move(self)), asio::detached);
+#else
     this->operator()(std::move(self), error_code{}, Socket{this->ioContext_});
+#endif
   }
 
   void stopAccepting() noexcept(false) override {
     LOG_TRACE("stop accepting");
 
     acceptor_.cancel();
+    rebalanceTimer_.cancel();
   }
 
   void closeAllSessions() override {
     LOG_TRACE("close all sessions");
 
+    std::lock_guard<std::mutex> lock{sessionsMutex_};
+    stopped_ = true;
     for (SessionPtr &session : sessions_) {
       if (session->isOpen()) {
         session->close();
@@ -284,58 +164,349 @@ public:
     }
 
     sessions_.clear();
+
+    for (ProxySessionPtr &session : proxySessions_) {
+      if (session->isOpen()) {
+        session->close();
+      }
+    }
+
+    proxySessions_.clear();
+
+    for (DetectionPtr &detection : detections_) {
+      detection->close();
+    }
+
+    detections_.clear();
+  }
+
+  ThreadPoolStats threadPoolStats() override {
+    ThreadPoolStats retval;
+    if (threadPool_ == nullptr) {
+      return retval;
+    }
+
+    retval.sessions.resize(threadPool_->size(), 0);
+    retval.migrations       = migrations_;
+    retval.failedMigrations = failedMigrations_;
+
+    std::lock_guard<std::mutex> lock{sessionsMutex_};
+    retval.load = lastLoad_;
+    for (const SessionPtr &session : sessions_) {
+      if (session->isOpen()) {
+        ++retval.sessions[session->threadIndex()];
+      }
+    }
+
+    return retval;
   }
 
 
 private:
-  void operator()(Self self, error_code err, Socket socket) noexcept {
-    if (err.failed()) {
-      if (err.value() == asio::error::operation_aborted) {
-        LOG_DEBUG("accepting canceled");
-      } else {
-        LOG_ERROR(err.message());
+#ifdef SS_USE_COROUTINES
+  /**\brief C++20 variant of the accepting loop
+   * \param self keeps the server alive while the loop is suspended
+   */
+  asio::awaitable<void> run([[maybe_unused]] Self self) {
+    for (;;) {
+      error_code err;
+      Socket     socket = co_await acceptor_.async_accept(
+          this->sessionExecutor(),
+          asio::redirect_error(asio::use_awaitable, err));
+      if (err.failed()) {
+        this->atEnd(err);
+        co_return;
       }
 
-      LOG_DEBUG("break the server coroutine");
+      this->acceptSession(std::move(socket));
+    }
+  }
+#else
+  void operator()(Self self, error_code err, Socket socket) noexcept {
+    if (err.failed()) {
+      this->atEnd(err);
       return;
     }
 
     reenter(this) {
       for (;;) {
-        yield acceptor_.async_accept(std::bind(&ServerImplStream::operator(),
-                                               this,
-                                               std::move(self),
-                                               std::placeholders::_1,
-                                               std::placeholders::_2));
+        yield acceptor_.async_accept(
+            this->sessionExecutor(),
+            std::bind(&ServerImplStream::operator(),
+                      this,
+                      std::move(self),
+                      std::placeholders::_1,
+                      std::placeholders::_2));
+
+        this->acceptSession(std::move(socket));
+      }
+    }
+  }
+#endif
 
-        LOG_DEBUG("accept new connection");
-        try {
-          LOG_DEBUG("accept connection from: %1%", socket.remote_endpoint());
+  /**\return executor for next accepted session: context of the builder, or
+   * context of next I/O thread
+   */
+  typename Socket::executor_type sessionExecutor() noexcept {
+    if (threadPool_ != nullptr) {
+      return threadPool_->nextContext().get_executor();
+    }
+    return ioContext_.get_executor();
+  }
 
-          // at first remove already closed sessions
-          sessions_.remove_if([](const SessionPtr &session) {
-            if (session->isOpen() == false) {
-              return true;
-            }
-            return false;
-          });
+  void acceptSession(Socket socket) noexcept {
+    LOG_DEBUG("accept new connection");
+    SS_PROBE(accept, socket.native_handle());
 
+    if (threadPool_ == nullptr) {
+      this->makeSession(std::move(socket), 0);
+      return;
+    }
 
-          RequestHandler reqHandler = reqHandlerFactory_->makeRequestHandler();
-          SessionPtr     session =
-              std::make_shared<Session<Protocol>>(std::move(socket),
-                                                  std::move(reqHandler));
+    // session must be constructed in its own thread, so all its buffers will
+    // be allocated there
+    typename Socket::executor_type executor = socket.get_executor();
+    size_t                         threadIndex =
+        threadPool_->indexOf(asio::query(executor, asio::execution::context));
+    asio::post(executor,
+               [self = this->shared_from_this(),
+                socket = std::make_shared<Socket>(std::move(socket)),
+                threadIndex]() {
+                 self->makeSession(std::move(*socket), threadIndex);
+               });
+  }
 
+  void makeSession(Socket socket, size_t threadIndex) noexcept {
+    try {
+      LOG_DEBUG("accept connection from: %1%", socket.remote_endpoint());
+
+      if (proxy_ != nullptr) {
+        this->makeProxySession(std::move(socket));
+        return;
+      }
+
+      if (protocolDetector_ != nullptr) {
+        this->detectProtocol(std::move(socket), threadIndex);
+        return;
+      }
+
+      this->startSession(std::move(socket), threadIndex, reqHandlerFactory_);
+    } catch (std::exception &e) {
+      LOG_ERROR(e.what());
+    }
+  }
+
+  /**\brief session is made, when its protocol is detected. Detections are
+   * kept until then, so they are closed by stop of the server
+   */
+  void detectProtocol(Socket socket, size_t threadIndex) {
+    DetectionPtr detection = std::make_shared<ProtocolDetection<Protocol>>(
+        std::move(socket),
+        protocolDetector_,
+        [self = this->shared_from_this(),
+         threadIndex](Socket detected, RequestHandlerFactory factory) {
+          try {
+            self->startSession(std::move(detected), threadIndex, factory);
+          } catch (std::exception &e) {
+            LOG_ERROR(e.what());
+          }
+        });
+
+    {
+      std::lock_guard<std::mutex> lock{sessionsMutex_};
+      if (stopped_) {
+        LOG_DEBUG("server is stopped, so session is not started");
+        return;
+      }
 
-          session->start();
-          sessions_.emplace_back(std::move(session));
+      detections_.remove_if([](const DetectionPtr &opened) {
+        return opened->isOpen() == false;
+      });
 
-          LOG_DEBUG("sessions opened: %1%", sessions_.size());
-        } catch (std::exception &e) {
-          LOG_ERROR(e.what());
+      detections_.emplace_back(detection);
+    }
+
+    // the detection can be finished right in the call, and then the callback
+    // starts the session, which locks sessionsMutex_, so it is called outside
+    // of the lock
+    detection->start();
+  }
+
+  void startSession(Socket                       socket,
+                    size_t                       threadIndex,
+                    const RequestHandlerFactory &reqHandlerFactory) {
+    RequestHandler reqHandler = reqHandlerFactory->makeRequestHandler();
+    reqHandler->factory_      = reqHandlerFactory;
+
+    SessionPtr session =
+        std::make_shared<Session<Protocol>>(std::move(socket),
+                                            std::move(reqHandler),
+                                            sessionOptions_,
+                                            socketOptions_);
+    session->setThreadIndex(threadIndex);
+    session->setCapture(capture_);
+    session->setCompression(compression_);
+    session->setRateLimit(rateLimiter_);
+    session->setResponseCache(responseCache_);
+    session->setMiddleware(middleware_);
+
+    {
+      std::lock_guard<std::mutex> lock{sessionsMutex_};
+      if (stopped_) {
+        LOG_DEBUG("server is stopped, so session is not started");
+        return;
+      }
+
+      // at first remove already closed sessions
+      sessions_.remove_if([](const SessionPtr &opened) {
+        if (opened->isOpen() == false) {
+          return true;
         }
+        return false;
+      });
+
+      sessions_.emplace_back(session);
+
+      LOG_DEBUG("sessions opened: %1%", sessions_.size());
+    }
+
+    // start calls atSessionStart of the handler, which can call methods of
+    // the server, so it is called outside of the lock
+    session->start();
+    this->closeIfStopped(session);
+  }
+
+  /**\brief the server can be stopped while the session was started, then
+   * the session could be missed by closeAllSessions
+   */
+  template <typename SessionPointer>
+  void closeIfStopped(const SessionPointer &session) {
+    std::lock_guard<std::mutex> lock{sessionsMutex_};
+    if (stopped_ && session->isOpen()) {
+      session->close();
+    }
+  }
+
+  /**\brief forwarded sessions are not balanced between I/O threads, so they
+   * are kept separately
+   */
+  void makeProxySession(Socket socket) {
+    ProxySessionPtr session =
+        std::make_shared<ProxySession<Protocol>>(std::move(socket),
+                                                 proxy_,
+                                                 socketOptions_);
+
+    {
+      std::lock_guard<std::mutex> lock{sessionsMutex_};
+      if (stopped_) {
+        LOG_DEBUG("server is stopped, so session is not started");
+        return;
+      }
+
+      proxySessions_.remove_if([](const ProxySessionPtr &opened) {
+        return opened->isOpen() == false;
+      });
+
+      proxySessions_.emplace_back(session);
+    }
+
+    session->start();
+    this->closeIfStopped(session);
+  }
+
+  void scheduleRebalance() {
+    rebalanceTimer_.expires_after(threadPool_->options().rebalanceInterval);
+    rebalanceTimer_.async_wait(
+        [self = this->shared_from_this()](error_code err) {
+          if (err.failed()) {
+            return;
+          }
+
+          self->rebalance();
+          self->scheduleRebalance();
+        });
+  }
+
+  /**\brief move one session from the busiest I/O thread to the least loaded
+   * one. The session is chosen so that its load is nearest to half of
+   * difference between the threads
+   */
+  void rebalance() {
+    size_t              threadsCount = threadPool_->size();
+    std::vector<size_t> load(threadsCount, 0);
+
+    std::lock_guard<std::mutex> lock{sessionsMutex_};
+
+    // load of sessions must be taken all at once, so keep it for choosing
+    std::vector<std::pair<SessionPtr, size_t>> sessionsLoad;
+    sessionsLoad.reserve(sessions_.size());
+    for (const SessionPtr &session : sessions_) {
+      if (session->isOpen() == false) {
+        continue;
+      }
+
+      size_t sessionLoad = session->takeReadsCount();
+      load[session->threadIndex()] += sessionLoad;
+      sessionsLoad.emplace_back(session, sessionLoad);
+    }
+    lastLoad_ = load;
+
+    size_t busiest = std::max_element(load.begin(), load.end()) - load.begin();
+    size_t idlest  = std::min_element(load.begin(), load.end()) - load.begin();
+    const ThreadPoolOptions &options = threadPool_->options();
+    if (load[busiest] < std::max<size_t>(options.rebalanceMinLoad, 1) ||
+        load[busiest] <= load[idlest] * options.rebalanceRatio) {
+      return;
+    }
+
+    size_t     diff   = load[busiest] - load[idlest];
+    SessionPtr chosen = nullptr;
+    size_t     chosenDistance = diff;
+    for (const auto &[session, sessionLoad] : sessionsLoad) {
+      // moving of the session must decrease difference
+      if (session->threadIndex() != busiest || sessionLoad == 0 ||
+          sessionLoad >= diff) {
+        continue;
+      }
+
+      size_t distance = sessionLoad > diff / 2 ? sessionLoad - diff / 2
+                                               : diff / 2 - sessionLoad;
+      if (distance < chosenDistance) {
+        chosen         = session;
+        chosenDistance = distance;
       }
     }
+
+    if (chosen == nullptr) {
+      return;
+    }
+
+    LOG_DEBUG("migrate session from thread %1% (load %2%) to thread %3% "
+              "(load %4%)",
+              busiest,
+              load[busiest],
+              idlest,
+              load[idlest]);
+
+    chosen->migrate(threadPool_->context(idlest),
+                    idlest,
+                    [self = this->shared_from_this()](bool migrated) {
+                      if (migrated) {
+                        ++self->migrations_;
+                      } else {
+                        ++self->failedMigrations_;
+                      }
+                    });
+  }
+
+  void atEnd(error_code err) noexcept {
+    if (err.value() == asio::error::operation_aborted) {
+      LOG_DEBUG("accepting canceled");
+    } else {
+      LOG_ERROR(err.message());
+    }
+
+    LOG_DEBUG("break the server coroutine");
   }
 
 
@@ -343,12 +514,36 @@ private:
   asio::io_context &    ioContext_;
   Acceptor              acceptor_;
   RequestHandlerFactory reqHandlerFactory_;
-
-  std::list<SessionPtr> sessions_;
+  SessionOptions        sessionOptions_;
+  SocketOptions         socketOptions_;
+
+  std::shared_ptr<ThreadPool> threadPool_;
+  asio::steady_timer          rebalanceTimer_;
+  std::vector<size_t>         lastLoad_;
+  std::atomic<size_t>         migrations_{0};
+  std::atomic<size_t>         failedMigrations_{0};
+
+  CaptureWriterPtr      capture_;
+  CompressionContextPtr compression_;
+  RateLimiterPtr        rateLimiter_;
+  ResponseCachePtr      responseCache_;
+  MiddlewareChainPtr    middleware_;
+  ProtocolDetectorPtr   protocolDetector_;
+  ProxyPtr              proxy_;
+
+  std::mutex                 sessionsMutex_;
+  std::list<SessionPtr>      sessions_;
+  std::list<ProxySessionPtr> proxySessions_;
+  std::list<DetectionPtr>    detections_;
+  bool                       stopped_ = false;
 };
 
 
 Server &Server::asyncRun() {
+  if (threadPool_ != nullptr) {
+    threadPool_->start();
+  }
+
   impl_->startAccepting();
   return *this;
 }
@@ -356,9 +551,51 @@ Server &Server::asyncRun() {
 Server &Server::stop() {
   impl_->stopAccepting();
   impl_->closeAllSessions();
+
+  if (threadPool_ != nullptr) {
+    threadPool_->stop();
+  }
   return *this;
 }
 
+BroadcasterPtr Server::broadcaster() const noexcept {
+  return broadcaster_;
+}
+
+ThreadPoolStats Server::threadPoolStats() const {
+  return impl_->threadPoolStats();
+}
+
+CompressionStats Server::compressionStats() const noexcept {
+#ifdef SS_HAS_ZLIB
+  if (compression_ != nullptr) {
+    return compression_->stats();
+  }
+#endif
+  return CompressionStats{};
+}
+
+ResponseCacheStats Server::responseCacheStats() const noexcept {
+  if (responseCache_ == nullptr) {
+    return ResponseCacheStats{};
+  }
+  return responseCache_->stats();
+}
+
+ProxyStats Server::proxyStats() const noexcept {
+  if (proxy_ == nullptr) {
+    return ProxyStats{};
+  }
+  return proxy_->stats();
+}
+
+ProtocolDetectionStats Server::protocolDetectionStats() const noexcept {
+  if (protocolDetector_ == nullptr) {
+    return ProtocolDetectionStats{};
+  }
+  return protocolDetector_->stats();
+}
+
 
 ServerBuilder::ServerBuilder(asio::io_context &ioContext)
     : ioContext_{ioContext} {
@@ -377,40 +614,200 @@ ServerBuilder &ServerBuilder::setEndpoint(Server::Protocol protocol,
   return *this;
 }
 
+ServerBuilder &ServerBuilder::setZeroCopyThreshold(size_t bytes,
+                                                   size_t maxPending) {
+  sessionOptions_.zeroCopyThreshold  = bytes;
+  sessionOptions_.zeroCopyMaxPending = maxPending;
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setSocketOptions(SocketOptions options) {
+  socketOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &
+ServerBuilder::setWriteCoalescing(size_t                    bytes,
+                                  std::chrono::microseconds delay) {
+  sessionOptions_.coalesceBytes = bytes;
+  sessionOptions_.coalesceDelay = delay;
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setPushQueueLimit(size_t bytes) {
+  sessionOptions_.pushQueueLimit = bytes;
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setOutputWatermarks(size_t low, size_t high) {
+  if (low > high) {
+    LOG_THROW(std::invalid_argument,
+              "low watermark %1% greater then high watermark %2%",
+              low,
+              high);
+  }
+
+  sessionOptions_.lowWatermark  = low;
+  sessionOptions_.highWatermark = high;
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setMaxRequestSize(size_t bytes) {
+  sessionOptions_.maxRequestSize = bytes;
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setBroadcaster(BroadcasterPtr broadcaster) {
+  broadcaster_ = std::move(broadcaster);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setThreadPool(ThreadPoolOptions options) {
+  threadPoolOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setCapture(std::string path) {
+  capturePath_ = std::move(path);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setCompression(CompressionOptions options) {
+  compressionOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setRateLimit(RateLimitOptions options) {
+  rateLimitOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setResponseCache(ResponseCacheOptions options) {
+  responseCacheOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setMiddleware(MiddlewareChainPtr middleware) {
+  middleware_ = std::move(middleware);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::addProtocol(std::string           signature,
+                                          RequestHandlerFactory factory) {
+  protocols_.emplace_back(std::move(signature), std::move(factory));
+  return *this;
+}
+
+ServerBuilder &
+ServerBuilder::setProtocolDetection(ProtocolDetectionOptions options) {
+  protocolDetectionOptions_ = std::move(options);
+  return *this;
+}
+
+ServerBuilder &ServerBuilder::setProxy(Server::Protocol protocol,
+                                       std::string_view upstream,
+                                       ProxyOptions     options) {
+  proxyProtocol_ = protocol;
+  proxyUpstream_ = upstream;
+  proxyOptions_  = std::move(options);
+  return *this;
+}
+
 ServerPtr ServerBuilder::build() const {
-  if (reqHandlerFactory_ == nullptr) {
+  if (reqHandlerFactory_ == nullptr && proxyOptions_.has_value() == false &&
+      protocols_.empty()) {
     LOG_THROW(std::invalid_argument, "invalid request handler factory");
   }
+  if (proxyOptions_.has_value() && protocols_.empty() == false) {
+    LOG_THROW(std::invalid_argument,
+              "protocols can not be added to the proxy endpoint");
+  }
 
 
-  std::shared_ptr<ServerImpl> impl;
-  switch (protocol_) {
-  case Server::Protocol::Tcp: {
-    std::regex  hostAndPortReg{R"(([^:]+):(\d{1,5}))"};
-    std::smatch match;
+  std::shared_ptr<ThreadPool> threadPool;
+  if (threadPoolOptions_.has_value()) {
+    threadPool = std::make_shared<ThreadPool>(ioContext_, *threadPoolOptions_);
+  }
 
-    if (std::regex_match(endpoint_, match, hostAndPortReg) == false) {
-      LOG_THROW(std::invalid_argument, "invalid host or port");
-    }
 
-    std::string host = match[1];
-    std::string port = match[2];
+  CaptureWriterPtr capture;
+  if (capturePath_.empty() == false) {
+    capture = std::make_shared<CaptureWriter>(capturePath_);
+  }
 
 
-    error_code err;
-    auto       addr = asio::ip::make_address(host, err);
-    if (err.failed()) {
-      LOG_THROW(std::invalid_argument, "invalid address: %1%", host);
+  CompressionContextPtr compression;
+  if (compressionOptions_.has_value()) {
+#ifdef SS_HAS_ZLIB
+    compression = std::make_shared<CompressionContext>(*compressionOptions_);
+#else
+    LOG_THROW(std::invalid_argument,
+              "compression is not supported, because ss is built without zlib");
+#endif
+  }
+
+  RateLimiterPtr rateLimiter;
+  if (rateLimitOptions_.has_value()) {
+    rateLimiter = std::make_shared<RateLimiter>(*rateLimitOptions_);
+  }
+
+  ResponseCachePtr responseCache;
+  if (responseCacheOptions_.has_value()) {
+    responseCache = std::make_shared<ResponseCache>(*responseCacheOptions_);
+  }
+
+  ProtocolDetectorPtr protocolDetector;
+  if (protocols_.empty() == false) {
+    std::vector<ProtocolDetector::Signature> signatures;
+    for (const auto &[signature, factory] : protocols_) {
+      signatures.emplace_back(ProtocolDetector::Signature{signature, factory});
+    }
+
+    protocolDetector =
+        std::make_shared<ProtocolDetector>(std::move(signatures),
+                                           reqHandlerFactory_,
+                                           protocolDetectionOptions_);
+  }
+
+  ProxyPtr proxy;
+  if (proxyOptions_.has_value()) {
+    Proxy::Endpoint upstream;
+    switch (proxyProtocol_) {
+    case Server::Protocol::Tcp:
+      upstream = makeTcpEndpoint(proxyUpstream_);
+      break;
+    case Server::Protocol::Unix:
+      upstream = stream_protocol::endpoint{proxyUpstream_};
+      break;
     }
 
-    tcp::endpoint endpoint(addr, std::stoi(port));
+    LOG_DEBUG("proxy upstream: %1%", proxyUpstream_);
+
+    proxy = std::make_shared<Proxy>(upstream, *proxyOptions_);
+  }
+
+
+  std::shared_ptr<ServerImpl> impl;
+  switch (protocol_) {
+  case Server::Protocol::Tcp: {
+    tcp::endpoint endpoint = makeTcpEndpoint(endpoint_);
 
     LOG_DEBUG("listen endpoint: %1%", endpoint);
 
 
     impl = std::make_shared<ServerImplStream<tcp>>(ioContext_,
                                                    endpoint,
-                                                   reqHandlerFactory_);
+                                                   reqHandlerFactory_,
+                                                   sessionOptions_,
+                                                   socketOptions_,
+                                                   threadPool,
+                                                   capture,
+                                                   compression,
+                                                   rateLimiter,
+                                                   responseCache,
+                                                   middleware_,
+                                                   protocolDetector,
+                                                   proxy);
   } break;
   case Server::Protocol::Unix: {
     stream_protocol::endpoint endpoint{endpoint_};
@@ -421,13 +818,34 @@ ServerPtr ServerBuilder::build() const {
     impl =
         std::make_shared<ServerImplStream<stream_protocol>>(ioContext_,
                                                             endpoint,
-                                                            reqHandlerFactory_);
+                                                            reqHandlerFactory_,
+                                                            sessionOptions_,
+                                                            socketOptions_,
+                                                            threadPool,
+                                                            capture,
+                                                            compression,
+                                                            rateLimiter,
+                                                            responseCache,
+                                                            middleware_,
+                                                            protocolDetector,
+                                                            proxy);
   } break;
   }
 
 
-  ServerPtr retval = std::make_shared<Server>(Server{});
-  retval->impl_    = impl;
+  BroadcasterPtr broadcaster = broadcaster_;
+  if (broadcaster == nullptr) {
+    broadcaster = std::make_shared<Broadcaster>();
+  }
+
+  ServerPtr retval          = std::make_shared<Server>(Server{});
+  retval->impl_             = impl;
+  retval->broadcaster_      = std::move(broadcaster);
+  retval->threadPool_       = std::move(threadPool);
+  retval->compression_      = std::move(compression);
+  retval->responseCache_    = std::move(responseCache);
+  retval->proxy_            = std::move(proxy);
+  retval->protocolDetector_ = std::move(protocolDetector);
 
   return retval;
 }
@@ -0,0 +1,1529 @@
+// Session.hpp
+
+#pragma once
+
+#include "AbstractSession.hpp"
+#include "CaptureWriter.hpp"
+#include "Probes.hpp"
+#include "RateLimiter.hpp"
+#include "RawSocketOption.hpp"
+#include "RequestBuffer.hpp"
+#include "ResponseCache.hpp"
+#include "StreamCodec.hpp"
+#include "ss/Server.hpp"
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/version.hpp>
+#include <boost/asio/write.hpp>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <simple_logs/logs.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#  include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#  include <linux/errqueue.h>
+#  if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#    define SS_HAS_ZEROCOPY 1
+#  endif
+#endif
+
+#ifdef SS_USE_COROUTINES
+#  include <boost/asio/awaitable.hpp>
+#  include <boost/asio/co_spawn.hpp>
+#  include <boost/asio/detached.hpp>
+#  include <boost/asio/redirect_error.hpp>
+#  include <boost/asio/use_awaitable.hpp>
+#  ifndef BOOST_ASIO_HAS_CO_AWAIT
+#    error "C++20 coroutines are not supported by the compiler or boost"
+#  endif
+#endif
+
+#define RES_BUFFER_RESERVED 1024 * 1000
+
+// XXX must be after <thread>
+#include <boost/asio/yield.hpp>
+
+namespace ss {
+namespace asio = boost::asio;
+
+
+/**\brief session reads requests and handles them in stackless coroutine
+ * (operator()), or in C++20 coroutine (run) if SS_USE_COROUTINES is defined.
+ * Responses are written by separate chain of handlers, so
+ * output can be flushed while coroutine waits for next request. Both chains
+ * are serialized by the strand. The coroutine doesn't read next request while
+ * some write is in progress, or, if watermarks are set, while count of not
+ * writed bytes is above the watermarks. With rate limit the coroutine also
+ * waits for tokens before next read or before handling of next request
+ *
+ * Idle session can be moved to other io_context (see migrate). Then socket
+ * is reassigned to the context, and all handlers, queued to previous strand,
+ * are reposted to new one
+ */
+template <typename Protocol>
+class Session final
+    : public AbstractSession
+#ifndef SS_USE_COROUTINES
+    , public asio::coroutine
+#endif
+    , public std::enable_shared_from_this<Session<Protocol>> {
+public:
+  using Self     = std::shared_ptr<Session>;
+  using Socket   = asio::basic_stream_socket<Protocol>;
+  using Endpoint = typename Protocol::endpoint;
+  using Strand   = asio::strand<typename Socket::executor_type>;
+
+  Session(Socket                socket,
+          RequestHandler        handler,
+          const SessionOptions &options,
+          const SocketOptions & socketOptions) noexcept
+      : socket_ {
+    std::move(socket)
+  }
+#if BOOST_ASIO_VERSION > 101400
+  , strand_ {
+    asio::make_strand(socket_.get_executor())
+  }
+#else
+  , strand_ {
+    socket_.get_executor()
+  }
+#endif
+  , coalesceTimer_{strand_}
+  , throttleTimer_{strand_}
+#ifdef SS_USE_COROUTINES
+  , parkTimer_{strand_, asio::steady_timer::time_point::max()}
+#endif
+  , reqHandler_{handler}
+  , reqBuffer_{options.maxRequestSize}
+  , coalesceBytes_{options.coalesceBytes}
+  , coalesceDelay_{options.coalesceDelay}
+  , pushQueueLimit_{options.pushQueueLimit}
+  , lowWatermark_{options.lowWatermark}
+  , highWatermark_{options.highWatermark}
+  , zeroCopyThreshold_{options.zeroCopyThreshold}
+  , zeroCopyMaxPending_{options.zeroCopyMaxPending} {
+    LOG_TRACE("construct session");
+
+    applySessionSocketOptions<Protocol>(socket_, socketOptions);
+#ifdef TCP_QUICKACK
+    quickAck_ = socketOptions.quickAck.value_or(false);
+#endif
+
+    resBuffer_.reserve(RES_BUFFER_RESERVED);
+  }
+
+  void start() {
+    LOG_TRACE("start new session");
+
+    Self self = this->shared_from_this();
+
+    reqHandler_->sessionHandle_ = SessionHandle{
+        std::static_pointer_cast<AbstractSession>(this->shared_from_this())};
+
+
+    std::stringstream remoteEndpoint;
+    remoteEndpoint << socket_.remote_endpoint();
+    error_code err = self->reqHandler_->atSessionStart(remoteEndpoint.str());
+    if (err.failed()) {
+      LOG_ERROR(err.message());
+      LOG_WARNING("session doesn't start, because get handler error");
+      closed_ = true;
+      return;
+    }
+
+    SS_PROBE(session_start, this, socket_.native_handle());
+
+    if (capture_ != nullptr) {
+      captureId_ = capture_->open();
+    }
+
+    // compressed output is produced for every write, so it can not be kept
+    // until kernel releases it
+    if (zeroCopyThreshold_ != 0 && this->compressed() == false) {
+      this->enableZeroCopy();
+    }
+
+#ifdef SS_USE_COROUTINES
+    asio::co_spawn(strand_, this->run(std::move(self)), asio::detached);
+#else
+    asio::dispatch(strand_,
+                   std::bind(&Session::operator(),
+                             this,
+                             std::move(self),
+                             error_code{},
+                             0));
+#endif
+  }
+
+  /**\note can be called from any thread
+   */
+  error_code push(std::string message) noexcept override {
+    // closed session can be alive until the server removes it
+    if (closed_) {
+      return error::make_error_code(error::SessionError::SessionClosed);
+    }
+
+    size_t size = message.size();
+    if (pushQueued_.fetch_add(size) + size > pushQueueLimit_) {
+      pushQueued_ -= size;
+      return error::make_error_code(error::SessionError::QueueOverflow);
+    }
+
+    try {
+      Self self = this->shared_from_this();
+      this->post([self, message = std::move(message)]() {
+        if (self->closed_) {
+          self->pushQueued_ -= message.size();
+          return;
+        }
+
+        self->resBuffer_.append(message);
+        self->pushedInResBuffer_ += message.size();
+
+        self->writeResponses(self);
+      });
+    } catch (std::exception &e) {
+      pushQueued_ -= size;
+      LOG_ERROR(e.what());
+      return error::make_error_code(error::SessionError::SessionClosed);
+    }
+
+    return error_code{};
+  }
+
+  /**\note can be called from any thread
+   */
+  error_code push(SharedBuffer       message,
+                  SlowConsumerPolicy policy,
+                  uint64_t           coalesceKey) noexcept override {
+    if (message == nullptr) {
+      return boost::system::errc::make_error_code(
+          boost::system::errc::invalid_argument);
+    }
+    if (closed_) {
+      return error::make_error_code(error::SessionError::SessionClosed);
+    }
+
+    size_t size = message->size();
+    if (pushQueued_.fetch_add(size) + size > pushQueueLimit_ &&
+        policy != SlowConsumerPolicy::CoalesceLatest) {
+      pushQueued_ -= size;
+
+      if (policy == SlowConsumerPolicy::Disconnect &&
+          disconnecting_.exchange(true) == false) {
+        LOG_WARNING("slow consumer, close session");
+        try {
+          this->close();
+        } catch (std::exception &e) {
+          LOG_ERROR(e.what());
+        }
+      }
+
+      return error::make_error_code(error::SessionError::QueueOverflow);
+    }
+
+    if (policy != SlowConsumerPolicy::CoalesceLatest) {
+      coalesceKey = 0;
+    }
+
+    try {
+      Self self = this->shared_from_this();
+      this->post([self, message = std::move(message), coalesceKey]() {
+        self->queueShared(self, std::move(message), coalesceKey);
+      });
+    } catch (std::exception &e) {
+      pushQueued_ -= size;
+      LOG_ERROR(e.what());
+      return error::make_error_code(error::SessionError::SessionClosed);
+    }
+
+    return error_code{};
+  }
+
+  /**\note can be called from any thread
+   */
+  void close() override {
+    Self self = this->shared_from_this();
+
+    this->dispatch([self]() {
+      if (self->socket_.is_open() == false) {
+        LOG_WARNING("session already closed");
+        return;
+      }
+
+      LOG_TRACE("close session");
+
+      if (self->migrating_) {
+        // pending read is already canceled, so the session will be closed at
+        // end of the migration
+        self->closeAfterMigration_ = true;
+        return;
+      }
+
+      error_code err;
+
+      // cancel all async operation with this socket
+      self->socket_.cancel(err);
+      if (err.failed()) {
+        LOG_ERROR(err.message());
+      }
+
+      self->coalesceTimer_.cancel();
+      self->throttleTimer_.cancel();
+
+      // coroutine doesn't wait for read while it is parked, so it must be
+      // resumed for closing
+      if (self->parkedSelf_ != nullptr) {
+        self->resume(asio::error::operation_aborted);
+      }
+    });
+  }
+
+  /**\note all async operations with socket must be already canceled
+   */
+  void atClose() {
+    LOG_TRACE("at session close");
+    SS_PROBE(close, this);
+
+    closed_ = true;
+
+    if (capture_ != nullptr) {
+      capture_->close(captureId_);
+    }
+
+    reqHandler_->atSessionClose();
+
+    coalesceTimer_.cancel();
+    throttleTimer_.cancel();
+
+    error_code err;
+    socket_.shutdown(Socket::shutdown_both, err);
+    if (err.failed()) {
+      LOG_ERROR(err.message());
+    }
+
+    socket_.close(err);
+    if (err.failed()) {
+      LOG_ERROR(err.message());
+    }
+  }
+
+  /**\note can be called from any thread
+   */
+  bool isOpen() const override {
+    return closed_ == false;
+  }
+
+  /**\brief move the session to other context. The session is moved only if
+   * it is idle at the moment: waits for next request and has nothing for
+   * write. Otherwise nothing is done
+   * \param callback called with result of the migration
+   * \note can be called from any thread
+   */
+  void migrate(asio::io_context &         context,
+               size_t                     threadIndex,
+               std::function<void(bool)> callback) {
+    Self self = this->shared_from_this();
+
+    this->post([self, &context, threadIndex, callback = std::move(callback)]() {
+      callback(self->moveTo(context, threadIndex));
+    });
+  }
+
+  /**\return index of I/O thread of the session
+   * \see ThreadPool
+   */
+  size_t threadIndex() const noexcept {
+    return threadIndex_;
+  }
+
+  void setThreadIndex(size_t threadIndex) noexcept {
+    threadIndex_ = threadIndex;
+  }
+
+  /**\brief record all readed requests of the session. Must be set before
+   * start
+   */
+  void setCapture(CaptureWriterPtr capture) noexcept {
+    capture_ = std::move(capture);
+  }
+
+  /**\brief compress whole stream of the session in both directions. Must
+   * be set before start
+   * \throw std::runtime_error if the codec can not be initialized
+   * \note without zlib the context is never made by the builder
+   */
+  void setCompression([[maybe_unused]] CompressionContextPtr compression) {
+#ifdef SS_HAS_ZLIB
+    if (compression != nullptr) {
+      codec_ = std::make_unique<StreamCodec>(std::move(compression));
+    }
+#endif
+  }
+
+  /**\brief limit rate of requests and readed bytes. Must be set before start
+   */
+  void setRateLimit(RateLimiterPtr limiter) {
+    if (limiter == nullptr) {
+      return;
+    }
+
+    // buckets of address are used only for ip sessions
+    std::string address;
+    if constexpr (std::is_same_v<Protocol, tcp>) {
+      error_code err;
+      Endpoint   endpoint = socket_.remote_endpoint(err);
+      if (err.failed() == false) {
+        asio::ip::address ip = endpoint.address();
+        if (ip.is_v4()) {
+          asio::ip::address_v4::bytes_type bytes = ip.to_v4().to_bytes();
+          address.assign(bytes.begin(), bytes.end());
+        } else {
+          asio::ip::address_v6::bytes_type bytes = ip.to_v6().to_bytes();
+          address.assign(bytes.begin(), bytes.end());
+        }
+      }
+    }
+
+    rateLimit_ =
+        std::make_unique<SessionRateLimit>(std::move(limiter), address);
+  }
+
+  /**\brief share responses of cacheable requests with other sessions. Must
+   * be set before start
+   * \see AbstractRequestHandler::cacheableRequestSize
+   */
+  void setResponseCache(ResponseCachePtr cache) noexcept {
+    cache_ = std::move(cache);
+  }
+
+  /**\brief pass every request through the chain. Must be set before start
+   */
+  void setMiddleware(MiddlewareChainPtr middleware) noexcept {
+    middleware_ = std::move(middleware);
+  }
+
+  /**\return count of reads since previous call. Used as load of the session
+   */
+  size_t takeReadsCount() noexcept {
+    return readsCount_.exchange(0, std::memory_order_relaxed);
+  }
+
+
+private:
+#ifdef SS_USE_COROUTINES
+  /**\brief C++20 variant of the session loop
+   * \param readed result of read, which was completed before migration of the
+   * session, but not handled yet
+   */
+  asio::awaitable<void> run(Self                  self,
+                            error_code            err    = error_code{},
+                            std::optional<size_t> readed = std::nullopt) {
+    for (;;) {
+      // requests, deferred by rate limit, are handled before next read
+      if (requestsDeferred_ == false) {
+        size_t transfered = 0;
+        if (readed.has_value()) {
+          transfered = *readed;
+          readed.reset();
+        } else {
+          reading_   = true;
+          transfered = co_await socket_.async_read_some(
+              this->readBuffer().prepare(),
+              asio::redirect_error(asio::use_awaitable, err));
+          reading_ = false;
+
+          if (migrating_) {
+            this->completeMigration(std::move(self), err, transfered);
+            co_return;
+          }
+        }
+
+        if (err.failed()) {
+          break;
+        }
+
+        this->atRead(transfered);
+      }
+
+      err = this->handleRequests();
+      if (err.failed()) {
+        break;
+      }
+
+      this->writeResponses(self);
+
+      // don't read next requests while previous responses are not writed
+      if (this->mustWaitOutput()) {
+        parkedSelf_ = self;
+
+        // timer never expires, so it is canceled by resume
+        co_await parkTimer_.async_wait(
+            asio::redirect_error(asio::use_awaitable, err));
+        err = parkError_;
+        if (err.failed()) {
+          break;
+        }
+      }
+
+      if (reqHandler_->closeRequested_) {
+        err = error::make_error_code(error::SessionError::SessionClosed);
+        break;
+      }
+
+      if (this->throttle(self)) {
+        parkedSelf_ = self;
+
+        co_await parkTimer_.async_wait(
+            asio::redirect_error(asio::use_awaitable, err));
+        err = parkError_;
+        if (err.failed()) {
+          break;
+        }
+      }
+    }
+
+    this->atEnd(err);
+  }
+#else
+  void operator()(Self self, error_code err, size_t transfered) {
+    reading_ = false;
+
+    if (migrating_) {
+      this->completeMigration(std::move(self), err, transfered);
+      return;
+    }
+
+    if (err.failed()) {
+      this->atEnd(err);
+      return;
+    }
+
+    reenter(this) {
+      for (;;) {
+        // requests, deferred by rate limit, are handled before next read
+        if (requestsDeferred_ == false) {
+          yield this->readSome(std::move(self));
+
+          this->atRead(transfered);
+        }
+
+        err = this->handleRequests();
+        if (err.failed()) {
+          this->atEnd(err);
+          return;
+        }
+
+        this->writeResponses(self);
+
+        // don't read next requests while previous responses are not writed
+        if (this->mustWaitOutput()) {
+          yield parkedSelf_ = std::move(self);
+        }
+
+        if (reqHandler_->closeRequested_) {
+          this->atEnd(
+              error::make_error_code(error::SessionError::SessionClosed));
+          return;
+        }
+
+        if (this->throttle(self)) {
+          yield parkedSelf_ = std::move(self);
+        }
+      }
+    }
+  }
+
+  void readSome(Self self) {
+    reading_ = true;
+    socket_.async_read_some(
+        this->readBuffer().prepare(),
+        asio::bind_executor(strand_,
+                            std::bind(&Session::operator(),
+                                      this,
+                                      std::move(self),
+                                      std::placeholders::_1,
+                                      std::placeholders::_2)));
+  }
+#endif
+
+  /**\return strand of current context of the session
+   */
+  Strand strand() const {
+    std::lock_guard<std::mutex> lock{strandMutex_};
+    return strand_;
+  }
+
+  /**\brief post the function to strand of the session. If the session was
+   * migrated while the function was queued, then the function is reposted to
+   * new strand
+   */
+  template <typename Function>
+  void post(Function function) {
+    asio::post(this->strand(),
+               [self = this->shared_from_this(),
+                function = std::move(function)]() mutable {
+                 if (self->strand().running_in_this_thread() == false) {
+                   self->post(std::move(function));
+                   return;
+                 }
+
+                 function();
+               });
+  }
+
+  /**\brief same as post, but the function is called immediately, if it is
+   * called from the strand
+   */
+  template <typename Function>
+  void dispatch(Function function) {
+    if (this->strand().running_in_this_thread()) {
+      function();
+      return;
+    }
+
+    this->post(std::move(function));
+  }
+
+  /**\brief release socket from current context and assign it to the new one.
+   * Pending read is canceled by this, so the migration is completed at
+   * completion of the read
+   * \return false if the session is not idle now
+   */
+  bool moveTo(asio::io_context &context, size_t threadIndex) {
+    if (closed_ || migrating_ || reading_ == false || writing_ ||
+        this->pendingOutput() != 0 || coalesceTimerArmed_ ||
+        parkedSelf_ != nullptr) {
+      return false;
+    }
+#ifdef SS_HAS_ZEROCOPY
+    if (zeroCopyWaiting_ || zeroCopyPending_.empty() == false) {
+      return false;
+    }
+#endif
+
+    error_code err;
+    Endpoint   local = socket_.local_endpoint(err);
+    if (err.failed()) {
+      return false;
+    }
+
+    typename Socket::native_handle_type handle = socket_.release(err);
+    if (err.failed()) {
+      LOG_ERROR(err.message());
+      return false;
+    }
+
+    Strand strand{typename Socket::executor_type{context.get_executor()}};
+
+    migrating_ = true;
+    socket_    = Socket{context};
+    socket_.assign(local.protocol(), handle, err);
+    if (err.failed()) {
+      // the session will be closed at completion of the read
+      LOG_ERROR(err.message());
+#if defined(__unix__)
+      ::close(handle);
+#endif
+      closeAfterMigration_ = true;
+    }
+
+    coalesceTimer_ = asio::steady_timer{strand};
+    throttleTimer_ = asio::steady_timer{strand};
+#ifdef SS_USE_COROUTINES
+    parkTimer_ = asio::steady_timer{strand, asio::steady_timer::time_point::max()};
+#endif
+    nextStrand_  = std::move(strand);
+    threadIndex_ = threadIndex;
+    return true;
+  }
+
+  /**\brief switch to new strand and continue on it. Called at completion of
+   * the read, which was pending at migration
+   */
+  void completeMigration(Self self, error_code err, size_t transfered) {
+    {
+      std::lock_guard<std::mutex> lock{strandMutex_};
+      strand_ = std::move(*nextStrand_);
+    }
+    nextStrand_.reset();
+    migrating_ = false;
+
+    LOG_DEBUG("session migrated to thread %1%", threadIndex_.load());
+
+    asio::post(strand_, [this, self, err, transfered]() {
+      if (closeAfterMigration_) {
+        this->atEnd(asio::error::operation_aborted);
+        return;
+      }
+
+      // output, queued while migration
+      this->writeResponses(self);
+
+      if (err == asio::error::operation_aborted) {
+#ifdef SS_USE_COROUTINES
+        asio::co_spawn(strand_, this->run(self), asio::detached);
+#else
+        this->readSome(self);
+#endif
+        return;
+      }
+
+      // read was completed before the migration, so handle its result
+#ifdef SS_USE_COROUTINES
+      asio::co_spawn(strand_,
+                     this->run(self, err, transfered),
+                     asio::detached);
+#else
+      this->operator()(self, err, transfered);
+#endif
+    });
+  }
+
+  /**\return buffer for reading from the socket. With compression the
+   * socket is readed to separate buffer, and requests are decompressed from it
+   */
+  RequestBuffer &readBuffer() noexcept {
+    return this->compressed() ? compressedBuffer_ : reqBuffer_;
+  }
+
+  bool compressed() const noexcept {
+#ifdef SS_HAS_ZLIB
+    return codec_ != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  void atRead(size_t transfered) {
+    RequestBuffer &buffer = this->readBuffer();
+    buffer.commit(transfered);
+    readsCount_.fetch_add(1, std::memory_order_relaxed);
+    SS_PROBE(read, this, transfered);
+
+    if (rateLimit_ != nullptr) {
+      rateLimit_->countBytes(transfered);
+    }
+
+    if (capture_ != nullptr) {
+      std::string_view data = buffer.data();
+      capture_->data(captureId_, data.substr(data.size() - transfered));
+    }
+
+    LOG_DEBUG("readed: %1.3fKb", transfered / 1024.);
+
+#ifdef TCP_QUICKACK
+    if constexpr (std::is_same_v<Protocol, tcp>) {
+      if (quickAck_) {
+        setSocketOption(socket_, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+      }
+    }
+#endif
+  }
+
+  /**\brief handle all readed requests. With compression requests are
+   * decompressed and handled by parts, so decompressed data never exceeds max
+   * size of the request buffer
+   * \return error, if session must be closed
+   */
+  error_code handleRequests() {
+    requestsDeferred_ = false;
+
+    if (this->compressed() == false) {
+      return this->handleBuffer();
+    }
+
+#ifdef SS_HAS_ZLIB
+    do {
+      error_code err = codec_->decompress(compressedBuffer_, reqBuffer_);
+      if (err.failed()) {
+        return err;
+      }
+
+      err = this->handleBuffer();
+      if (err.failed()) {
+        return err;
+      }
+    } while ((compressedBuffer_.empty() == false ||
+              codec_->hasPendingOutput()) &&
+             reqHandler_->closeRequested_ == false &&
+             requestsDeferred_ == false);
+#endif
+
+    return error_code{};
+  }
+
+  /**\brief handle all requests in request buffer
+   * \return error, if session must be closed
+   */
+  error_code handleBuffer() {
+    for (;;) {
+      // rest of the buffer is handled, when rate limit allows next request
+      if (rateLimit_ != nullptr && reqBuffer_.empty() == false &&
+          rateLimit_->requestAllowed() == false) {
+        requestsDeferred_ = true;
+        return error_code{};
+      }
+
+      RequestContext context{reqBuffer_.data(),
+                             reqHandler_->sessionHandle_,
+                             resBuffer_,
+                             std::string_view{},
+                             error_code{},
+                             0};
+
+      error_code err;
+      if (middleware_ != nullptr) {
+        err = middleware_->handle(context,
+                                  AbstractMiddlewareChain::Next{
+                                      &Session::nextHandler, this});
+      } else {
+        err = this->handleRequest(context);
+      }
+
+      size_t reqIgnoreLength = context.reqIgnoreLength;
+      if (rateLimit_ != nullptr &&
+          (err.failed() == false || reqIgnoreLength != 0)) {
+        rateLimit_->countRequest();
+      }
+
+      if (err.failed() == false) {
+        if (reqIgnoreLength == 0 || reqIgnoreLength >= reqBuffer_.size() ||
+            reqHandler_->closeRequested_) {
+          reqBuffer_.clear();
+          return error_code{};
+        }
+
+        reqBuffer_.consume(reqIgnoreLength);
+        continue;
+      }
+
+      // if some error caused
+      if (err == error::SessionError::PartialData) {
+        reqBuffer_.consume(reqIgnoreLength);
+
+        LOG_WARNING("partial data in request: %1.3fKb",
+                    reqBuffer_.size() / 1024.);
+
+        if (reqBuffer_.full()) {
+          LOG_WARNING("request buffer overflow, close session");
+          return error::make_error_code(error::SessionError::RequestTooBig);
+        }
+
+        return error_code{};
+      }
+
+      // unexpected errors
+      return err;
+    }
+  }
+
+  /**\brief handle first request of the context by the cache or by the
+   * handler. It is the end of middleware chain
+   */
+  static error_code nextHandler(void *target, RequestContext &context) {
+    return static_cast<Session *>(target)->handleRequest(context);
+  }
+
+  error_code handleRequest(RequestContext &context) {
+    // response for cacheable request is taken from the cache, if it is
+    // there
+    std::string_view cacheable;
+    if (cache_ != nullptr && context.request.empty() == false) {
+      size_t size = reqHandler_->cacheableRequestSize(context.request);
+      if (size != 0 && size <= context.request.size()) {
+        cacheable = context.request.substr(0, size);
+
+        SharedBuffer response = cache_->find(cacheable);
+        if (response != nullptr) {
+          context.response        = *response;
+          context.reqIgnoreLength = size;
+          this->appendShared(std::move(response));
+          return error_code{};
+        }
+      }
+    }
+
+    SS_PROBE(handler_enter, this, context.request.size());
+    size_t resBefore = resBuffer_.size();
+
+    error_code err = reqHandler_->handle(context.request,
+                                         std::back_inserter(resBuffer_),
+                                         context.reqIgnoreLength);
+
+    SS_PROBE(handler_exit, this, resBuffer_.size() - resBefore, err.value());
+    context.response = std::string_view{resBuffer_}.substr(resBefore);
+
+    // response is cached only if the handler consumed exactly the cacheable
+    // request
+    size_t reqIgnoreLength = context.reqIgnoreLength;
+    if (cacheable.empty() == false && err.failed() == false &&
+        reqHandler_->closeRequested_ == false &&
+        resBuffer_.size() > resBefore &&
+        (reqIgnoreLength == cacheable.size() ||
+         (reqIgnoreLength == 0 &&
+         cacheable.size() == context.request.size()))) {
+      cache_->insert(cacheable,
+                     std::make_shared<const std::string>(resBuffer_,
+                                                         resBefore));
+    }
+
+    return err;
+  }
+
+  void atEnd(error_code err) {
+    if (err == asio::error::eof) {
+      LOG_DEBUG("client close connection");
+    } else if (err == asio::error::operation_aborted) {
+      LOG_DEBUG("session canceled");
+    } else if (err == error::SessionError::SessionClosed) {
+      LOG_DEBUG("session closed by handler");
+    } else {
+      LOG_ERROR(err.message());
+    }
+
+    this->atClose();
+
+    LOG_DEBUG("end of session coroutine");
+  }
+
+  /**\param message not nullptr, it is checked by `push`
+   */
+  void queueShared(Self self, SharedBuffer message, uint64_t coalesceKey) {
+    size_t size = message->size();
+    if (closed_) {
+      pushQueued_ -= size;
+      return;
+    }
+
+    if (coalesceKey != 0) {
+      // replace previous not writed message
+      for (SharedChunk &chunk : sharedInRes_) {
+        if (chunk.coalesceKey == coalesceKey) {
+          size_t prevSize = chunk.buffer->size();
+          pushQueued_ -= prevSize;
+          sharedBytesInRes_  = sharedBytesInRes_ - prevSize + size;
+          pushedInResBuffer_ = pushedInResBuffer_ - prevSize + size;
+
+          chunk.buffer = std::move(message);
+          return;
+        }
+      }
+    }
+
+    sharedInRes_.emplace_back(
+        SharedChunk{resBuffer_.size(), std::move(message), coalesceKey});
+    sharedBytesInRes_ += size;
+    pushedInResBuffer_ += size;
+
+    this->writeResponses(std::move(self));
+  }
+
+  /**\brief insert the buffer to output after already produced responses
+   * without copying
+   */
+  void appendShared(SharedBuffer buffer) {
+    sharedBytesInRes_ += buffer->size();
+    sharedInRes_.emplace_back(
+        SharedChunk{resBuffer_.size(), std::move(buffer), 0});
+  }
+
+  /**\return count of bytes, which are waiting for write
+   */
+  size_t pendingOutput() const noexcept {
+    return resBuffer_.size() + sharedBytesInRes_;
+  }
+
+  /**\return count of bytes, which are waiting for write, writing now, or
+   * are sent with zerocopy, but not released by kernel yet
+   */
+  size_t notWritedBytes() const noexcept {
+    size_t retval = this->pendingOutput();
+    if (writing_) {
+      retval += writeSize_ - resWritten_;
+    }
+#ifdef SS_HAS_ZEROCOPY
+    retval += zeroCopyPendingBytes_;
+#endif
+    return retval;
+  }
+
+  bool isOutputFull() const noexcept {
+    if (highWatermark_ == 0) {
+      return writing_;
+    }
+    return outputPaused_;
+  }
+
+  /**\return true if reading must wait until output is written: the output
+   * is full, or the handler requested close after write of its responses
+   */
+  bool mustWaitOutput() const noexcept {
+    return this->isOutputFull() ||
+           (reqHandler_->closeRequested_ && this->notWritedBytes() != 0);
+  }
+
+  /**\brief notify handler about crossing of watermarks
+   */
+  void checkWatermarks() {
+    if (highWatermark_ == 0) {
+      return;
+    }
+
+    size_t notWrited = this->notWritedBytes();
+    if (outputPaused_ == false && notWrited >= highWatermark_) {
+      LOG_DEBUG("high watermark reached: %1.3fKb", notWrited / 1024.);
+
+      outputPaused_ = true;
+      reqHandler_->atHighWatermark();
+    } else if (outputPaused_ == true && notWrited <= lowWatermark_) {
+      LOG_DEBUG("low watermark reached: %1.3fKb", notWrited / 1024.);
+
+      outputPaused_ = false;
+      reqHandler_->atLowWatermark();
+    }
+  }
+
+  /**\brief start write of accumulated responses or postpone it, if write
+   * coalescing is enabled
+   */
+  void writeResponses(Self self) {
+    bool flushRequested =
+        reqHandler_->flushRequested_ || reqHandler_->closeRequested_;
+    reqHandler_->flushRequested_ = false;
+
+    // socket already belongs to other context, so output will be written at
+    // end of the migration
+    if (this->pendingOutput() == 0 || migrating_) {
+      return;
+    }
+
+    // coalesceBytes 0 means, that output is flushed only by the delay
+    if (flushRequested || coalesceDelay_.count() == 0 ||
+        (coalesceBytes_ != 0 && this->pendingOutput() >= coalesceBytes_)) {
+      this->flush(std::move(self));
+      this->checkWatermarks();
+      return;
+    }
+
+    this->checkWatermarks();
+
+    if (coalesceTimerArmed_ == false) {
+      coalesceTimerArmed_ = true;
+      coalesceTimer_.expires_after(coalesceDelay_);
+      coalesceTimer_.async_wait(
+          asio::bind_executor(strand_, [this, self](error_code err) {
+            coalesceTimerArmed_ = false;
+            if (err.failed() || socket_.is_open() == false) {
+              return;
+            }
+
+            this->flush(self);
+          }));
+    }
+  }
+
+  void flush(Self self) {
+    if (writing_ || this->pendingOutput() == 0) {
+      return;
+    }
+
+    if (coalesceTimerArmed_) {
+      coalesceTimer_.cancel();
+    }
+
+    // responses, produced while write is in progress, will be accumulated in
+    // resBuffer_
+    std::swap(resBuffer_, writeBuffer_);
+    std::swap(sharedInRes_, sharedInWrite_);
+    writing_             = true;
+    resWritten_          = 0;
+    sharedBytesInRes_    = 0;
+    pushedInWriteBuffer_ = pushedInResBuffer_;
+    pushedInResBuffer_   = 0;
+
+    this->prepareWriteBuffers();
+    SS_PROBE(write_start, this, writeSize_);
+
+#ifdef SS_HAS_ZEROCOPY
+    // above the limit the buffer is not pinned, but copied by kernel
+    zeroCopySending_ =
+        zeroCopyEnabled_ && writeSize_ >= zeroCopyThreshold_ &&
+        zeroCopyPendingBytes_ + writeSize_ <= zeroCopyMaxPending_;
+#endif
+
+    this->writeSome(std::move(self));
+  }
+
+  /**\brief make gather list from the output buffer and shared buffers,
+   * inserted between responses. With compression all of them are compressed
+   * to single buffer
+   */
+  void prepareWriteBuffers() {
+    writeBuffers_.clear();
+
+    size_t offset = 0;
+    for (const SharedChunk &chunk : sharedInWrite_) {
+      if (chunk.offset > offset) {
+        writeBuffers_.emplace_back(writeBuffer_.data() + offset,
+                                   chunk.offset - offset);
+        offset = chunk.offset;
+      }
+      writeBuffers_.emplace_back(chunk.buffer->data(), chunk.buffer->size());
+    }
+    if (offset < writeBuffer_.size()) {
+      writeBuffers_.emplace_back(writeBuffer_.data() + offset,
+                                 writeBuffer_.size() - offset);
+    }
+
+#ifdef SS_HAS_ZLIB
+    if (codec_ != nullptr) {
+      compressedOutput_.clear();
+      for (size_t i = 0; i < writeBuffers_.size(); ++i) {
+        std::string_view data{
+            static_cast<const char *>(writeBuffers_[i].data()),
+            writeBuffers_[i].size()};
+        bool last = i + 1 == writeBuffers_.size();
+        codec_->compress(data, compressedOutput_, last);
+      }
+
+      writeBuffers_.assign(1, asio::buffer(compressedOutput_));
+    }
+#endif
+
+    writeSize_ = asio::buffer_size(writeBuffers_);
+  }
+
+  void writeSome(Self self) {
+#ifdef SS_HAS_ZEROCOPY
+    if (zeroCopySending_) {
+      // skip already sent bytes
+      sendBuffers_.clear();
+      size_t skip = resWritten_;
+      for (const asio::const_buffer &buffer : writeBuffers_) {
+        if (skip >= buffer.size()) {
+          skip -= buffer.size();
+          continue;
+        }
+
+        sendBuffers_.emplace_back(buffer + skip);
+        skip = 0;
+      }
+
+      // we can not use async_write here, because every sendmsg call must be
+      // counted for matching with kernel notifications
+      socket_.async_send(
+          sendBuffers_,
+          zeroCopyEnabled_ ? MSG_ZEROCOPY : 0,
+          asio::bind_executor(strand_,
+                              std::bind(&Session::onWrite,
+                                        this,
+                                        std::move(self),
+                                        std::placeholders::_1,
+                                        std::placeholders::_2)));
+      return;
+    }
+#endif
+
+    auto handler = asio::bind_executor(strand_,
+                                       std::bind(&Session::onWrite,
+                                                 this,
+                                                 std::move(self),
+                                                 std::placeholders::_1,
+                                                 std::placeholders::_2));
+
+    // single buffer is most common case, and it doesn't require copy of the
+    // gather list
+    if (writeBuffers_.size() == 1) {
+      asio::async_write(socket_,
+                        writeBuffers_.front(),
+                        asio::transfer_all(),
+                        std::move(handler));
+    } else {
+      asio::async_write(socket_,
+                        writeBuffers_,
+                        asio::transfer_all(),
+                        std::move(handler));
+    }
+  }
+
+  void onWrite(Self self, error_code err, size_t transfered) {
+#ifdef SS_HAS_ZEROCOPY
+    if (err == asio::error::no_buffer_space && zeroCopySending_) {
+      // kernel can not pin more pages (optmem limit), so send rest of the
+      // buffer in usual way
+      LOG_WARNING("zerocopy send failed, fallback to copy");
+      zeroCopyEnabled_ = false;
+      err              = error_code{};
+    }
+
+    if (zeroCopySending_ && zeroCopyEnabled_ && transfered != 0) {
+      ++zeroCopySeq_;
+      zeroCopyUsed_ = true;
+    }
+#endif
+
+    if (err.failed()) {
+      writing_ = false;
+      SS_PROBE(write_done, this, resWritten_ + transfered, err.value());
+
+      if (err != asio::error::operation_aborted) {
+        LOG_ERROR(err.message());
+      }
+
+      if (parkedSelf_ != nullptr) {
+        this->resume(err);
+      } else if (socket_.is_open()) {
+        // coroutine waits for next request, so cancel reading
+        error_code cancelErr;
+        socket_.cancel(cancelErr);
+      }
+      return;
+    }
+
+    resWritten_ += transfered;
+    if (resWritten_ < writeSize_) {
+      this->writeSome(std::move(self));
+      return;
+    }
+
+    LOG_DEBUG("writed: %1.3fKb", resWritten_ / 1024.);
+    SS_PROBE(write_done, this, resWritten_, 0);
+
+#ifdef SS_HAS_ZEROCOPY
+    if (zeroCopyUsed_) {
+      this->retireZeroCopyBuffer(self);
+    }
+#endif
+
+    // clear after every write
+    writeBuffer_.clear();
+    sharedInWrite_.clear();
+    writing_ = false;
+
+    pushQueued_ -= pushedInWriteBuffer_;
+    pushedInWriteBuffer_ = 0;
+
+    if (this->pendingOutput() != 0) {
+      this->writeResponses(self);
+    }
+
+    this->checkWatermarks();
+
+    if (parkedSelf_ != nullptr && this->mustWaitOutput() == false &&
+        throttled_ == false) {
+      this->resume(error_code{});
+    }
+  }
+
+  /**\brief wait until rate limit allows next read, or handling of deferred
+   * requests
+   * \return true if the coroutine must be parked until end of the wait
+   */
+  bool throttle(Self self) {
+    if (rateLimit_ == nullptr) {
+      return false;
+    }
+
+    std::chrono::nanoseconds delay = rateLimit_->delay(requestsDeferred_);
+    if (delay.count() == 0) {
+      return false;
+    }
+
+    LOG_DEBUG("rate limit reached, pause session for %1%us",
+              std::chrono::duration_cast<std::chrono::microseconds>(delay)
+                  .count());
+
+    throttled_ = true;
+    throttleTimer_.expires_after(delay);
+    throttleTimer_.async_wait(
+        asio::bind_executor(strand_, [this, self](error_code err) {
+          throttled_ = false;
+
+          // if the timer is canceled, then the session is closed, and the
+          // coroutine is resumed by close
+          if (err.failed() == false && parkedSelf_ != nullptr &&
+              this->mustWaitOutput() == false) {
+            this->resume(error_code{});
+          }
+        }));
+    return true;
+  }
+
+  /**\brief continue parked coroutine
+   */
+  void resume(error_code err) {
+#ifdef SS_USE_COROUTINES
+    parkedSelf_ = nullptr;
+    parkError_  = err;
+    parkTimer_.cancel();
+#else
+    asio::post(strand_,
+               std::bind(&Session::operator(),
+                         this,
+                         std::move(parkedSelf_),
+                         err,
+                         0));
+    parkedSelf_ = nullptr;
+#endif
+  }
+
+  void enableZeroCopy() {
+#ifdef SS_HAS_ZEROCOPY
+    int enable = 1;
+    if (::setsockopt(socket_.native_handle(),
+                     SOL_SOCKET,
+                     SO_ZEROCOPY,
+                     &enable,
+                     sizeof(enable)) != 0) {
+      // for example unix sockets doesn't support zerocopy
+      LOG_DEBUG("zerocopy is not supported by the socket: %1%",
+                std::strerror(errno));
+      return;
+    }
+
+    zeroCopyEnabled_ = true;
+#else
+    LOG_WARNING("zerocopy is not supported on the platform");
+#endif
+  }
+
+#ifdef SS_HAS_ZEROCOPY
+  /**\brief keep sent response buffer until kernel releases it, and provide
+   * new buffer for next response
+   */
+  void retireZeroCopyBuffer(Self self) {
+    zeroCopyUsed_ = false;
+
+    zeroCopyPendingBytes_ += writeSize_;
+    zeroCopyPending_.emplace_back(ZeroCopyBuffers{zeroCopySeq_ - 1,
+                                                  writeSize_,
+                                                  std::move(writeBuffer_),
+                                                  std::move(sharedInWrite_)});
+    sharedInWrite_.clear();
+
+    if (zeroCopySpare_.empty() == false) {
+      writeBuffer_ = std::move(zeroCopySpare_.back());
+      zeroCopySpare_.pop_back();
+    } else {
+      writeBuffer_ = std::string{};
+    }
+
+    this->reapZeroCopyCompletions();
+    this->waitZeroCopyCompletions(std::move(self));
+  }
+
+  /**\brief completions comes to socket error queue, so wait for error
+   * condition on the socket
+   */
+  void waitZeroCopyCompletions(Self self) {
+    if (zeroCopyWaiting_ || zeroCopyPending_.empty()) {
+      return;
+    }
+
+    zeroCopyWaiting_ = true;
+    socket_.async_wait(
+        Socket::wait_error,
+        asio::bind_executor(strand_, [this, self](error_code err) mutable {
+          zeroCopyWaiting_ = false;
+          if (err.failed()) {
+            // session closed, so buffers will be released with the session
+            return;
+          }
+
+          this->reapZeroCopyCompletions();
+
+          // released buffers can allow reading of next requests
+          this->checkWatermarks();
+          if (parkedSelf_ != nullptr && this->mustWaitOutput() == false &&
+              throttled_ == false) {
+            this->resume(error_code{});
+          }
+
+          this->waitZeroCopyCompletions(std::move(self));
+        }));
+  }
+
+  void reapZeroCopyCompletions() {
+    for (;;) {
+      char   control[128];
+      msghdr msg{};
+      msg.msg_control    = control;
+      msg.msg_controllen = sizeof(control);
+
+      if (::recvmsg(socket_.native_handle(),
+                    &msg,
+                    MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          LOG_ERROR("can not read socket error queue: %1%",
+                    std::strerror(errno));
+        }
+        return;
+      }
+
+      for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+           cm          = CMSG_NXTHDR(&msg, cm)) {
+        if ((cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR) &&
+            (cm->cmsg_level != SOL_IPV6 || cm->cmsg_type != IPV6_RECVERR)) {
+          continue;
+        }
+
+        const sock_extended_err *serr =
+            reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+        if (serr->ee_errno != 0 ||
+            serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+          continue;
+        }
+
+        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+          // kernel did copy anyway (loopback for example), so we only spend
+          // time for notifications
+          LOG_DEBUG("zerocopy fallback to copy by kernel, disable zerocopy");
+          zeroCopyEnabled_ = false;
+        }
+
+        // notifications for tcp come in order, so ee_data is last released
+        // sequence number
+        uint32_t released = serr->ee_data;
+        while (zeroCopyPending_.empty() == false &&
+               static_cast<int32_t>(zeroCopyPending_.front().seq -
+                                    released) <= 0) {
+          zeroCopyPendingBytes_ -= zeroCopyPending_.front().size;
+
+          std::string &buffer = zeroCopyPending_.front().buffer;
+          if (zeroCopySpare_.empty()) {
+            buffer.clear();
+            zeroCopySpare_.emplace_back(std::move(buffer));
+          }
+          zeroCopyPending_.pop_front();
+        }
+      }
+    }
+  }
+#endif
+
+private:
+  Socket             socket_;
+  Strand             strand_;
+  mutable std::mutex strandMutex_;
+  asio::steady_timer coalesceTimer_;
+  asio::steady_timer throttleTimer_;
+#ifdef SS_USE_COROUTINES
+  asio::steady_timer parkTimer_;
+#endif
+  RequestHandler     reqHandler_;
+  RequestBuffer      reqBuffer_;
+  std::string        resBuffer_;
+  std::string        writeBuffer_;
+
+  // shared buffers, which must be inserted in output at the offset
+  struct SharedChunk {
+    size_t       offset;
+    SharedBuffer buffer;
+    uint64_t     coalesceKey;
+  };
+
+  std::vector<SharedChunk> sharedInRes_;
+  std::vector<SharedChunk> sharedInWrite_;
+  size_t                   sharedBytesInRes_ = 0;
+
+  std::vector<asio::const_buffer> writeBuffers_;
+  size_t                          writeSize_ = 0;
+
+  // coroutine waits end of write
+  Self parkedSelf_;
+#ifdef SS_USE_COROUTINES
+  error_code parkError_;
+#endif
+
+  bool   writing_    = false;
+  size_t resWritten_ = 0;
+
+  size_t                    coalesceBytes_;
+  std::chrono::microseconds coalesceDelay_;
+  bool                      coalesceTimerArmed_ = false;
+
+  // count of bytes, queued by push, but not writed yet
+  std::atomic<size_t> pushQueued_{0};
+  size_t              pushQueueLimit_;
+  size_t              pushedInResBuffer_   = 0;
+  size_t              pushedInWriteBuffer_ = 0;
+
+  size_t lowWatermark_;
+  size_t highWatermark_;
+  bool   outputPaused_ = false;
+
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> disconnecting_{false};
+
+  // migration between contexts
+  bool                  reading_             = false;
+  bool                  migrating_           = false;
+  bool                  closeAfterMigration_ = false;
+  std::optional<Strand> nextStrand_;
+  std::atomic<size_t>   threadIndex_{0};
+  std::atomic<size_t>   readsCount_{0};
+
+  CaptureWriterPtr capture_;
+  uint32_t         captureId_ = 0;
+
+  // compressed input is readed to separate buffer, and output is compressed
+  // to separate buffer at start of every write
+#ifdef SS_HAS_ZLIB
+  StreamCodecPtr codec_;
+#endif
+  RequestBuffer compressedBuffer_;
+  std::string   compressedOutput_;
+
+  ResponseCachePtr   cache_;
+  MiddlewareChainPtr middleware_;
+
+  // rate limit
+  SessionRateLimitPtr rateLimit_;
+  bool                requestsDeferred_ = false;
+  bool                throttled_        = false;
+
+  size_t zeroCopyThreshold_;
+  size_t zeroCopyMaxPending_;
+  bool   zeroCopyEnabled_ = false;
+  bool   quickAck_        = false;
+#ifdef SS_HAS_ZEROCOPY
+  bool     zeroCopySending_ = false;
+  bool     zeroCopyUsed_    = false;
+  bool     zeroCopyWaiting_ = false;
+  uint32_t zeroCopySeq_     = 0;
+
+  // bytes of buffers, which are not released by kernel yet
+  size_t zeroCopyPendingBytes_ = 0;
+
+  // sent buffers with last sequence number of sendmsg call
+  struct ZeroCopyBuffers {
+    uint32_t                 seq;
+    size_t                   size;
+    std::string              buffer;
+    std::vector<SharedChunk> shared;
+  };
+
+  std::vector<asio::const_buffer> sendBuffers_;
+  std::deque<ZeroCopyBuffers>     zeroCopyPending_;
+  std::vector<std::string>        zeroCopySpare_;
+#endif
+};
+} // namespace ss
+
+#include <boost/asio/unyield.hpp>
@@ -0,0 +1,53 @@
+// SessionHandle.cpp
+
+#include "ss/SessionHandle.hpp"
+#include "AbstractSession.hpp"
+
+namespace ss {
+SessionHandle::SessionHandle(std::weak_ptr<AbstractSession> session) noexcept
+    : session_{std::move(session)} {
+}
+
+error_code SessionHandle::send(std::string message) const noexcept {
+  std::shared_ptr<AbstractSession> session = session_.lock();
+  if (session == nullptr) {
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+
+  return session->push(std::move(message));
+}
+
+error_code SessionHandle::send(SharedBuffer message) const noexcept {
+  if (message == nullptr) {
+    return boost::system::errc::make_error_code(
+        boost::system::errc::invalid_argument);
+  }
+
+  std::shared_ptr<AbstractSession> session = session_.lock();
+  if (session == nullptr) {
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+
+  return session->push(std::move(message), SlowConsumerPolicy::Drop, 0);
+}
+
+void SessionHandle::close() const {
+  if (std::shared_ptr<AbstractSession> session = session_.lock()) {
+    session->close();
+  }
+}
+
+bool SessionHandle::isOpen() const noexcept {
+  std::shared_ptr<AbstractSession> session = session_.lock();
+  return session != nullptr && session->isOpen();
+}
+
+bool SessionHandle::operator==(const SessionHandle &rhs) const noexcept {
+  return session_.owner_before(rhs.session_) == false &&
+         rhs.session_.owner_before(session_) == false;
+}
+
+bool SessionHandle::operator!=(const SessionHandle &rhs) const noexcept {
+  return !(*this == rhs);
+}
+} // namespace ss
@@ -0,0 +1,194 @@
+// StreamCodec.cpp
+
+#include "StreamCodec.hpp"
+#include <algorithm>
+#include <simple_logs/logs.hpp>
+#include <zlib.h>
+
+namespace ss {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// memLevel of deflate, default for zlib
+constexpr int MEMORY_LEVEL = 8;
+
+// minimal space, which is reserved in output for every deflate call
+constexpr size_t MIN_DEFLATE_SPACE = 1024;
+
+Bytef *toBytes(const char *data) noexcept {
+  return reinterpret_cast<Bytef *>(const_cast<char *>(data));
+}
+} // namespace
+
+CompressionContext::CompressionContext(CompressionOptions options)
+    : options_{std::move(options)} {
+  if (options_.level < 1 || options_.level > 9) {
+    LOG_THROW(std::invalid_argument,
+              "invalid compression level: %1%",
+              options_.level);
+  }
+  if (options_.windowBits < 9 || options_.windowBits > 15) {
+    LOG_THROW(std::invalid_argument,
+              "invalid compression window bits: %1%",
+              options_.windowBits);
+  }
+}
+
+void CompressionContext::countDecompression(
+    size_t                   input,
+    size_t                   output,
+    std::chrono::nanoseconds time) noexcept {
+  readBytes_.fetch_add(input, std::memory_order_relaxed);
+  decompressedBytes_.fetch_add(output, std::memory_order_relaxed);
+  decompressTime_.fetch_add(time.count(), std::memory_order_relaxed);
+}
+
+void CompressionContext::countCompression(
+    size_t                   input,
+    size_t                   output,
+    std::chrono::nanoseconds time) noexcept {
+  responseBytes_.fetch_add(input, std::memory_order_relaxed);
+  writtenBytes_.fetch_add(output, std::memory_order_relaxed);
+  compressTime_.fetch_add(time.count(), std::memory_order_relaxed);
+}
+
+CompressionStats CompressionContext::stats() const noexcept {
+  constexpr std::memory_order order = std::memory_order_relaxed;
+
+  CompressionStats retval;
+  retval.readBytes         = readBytes_.load(order);
+  retval.decompressedBytes = decompressedBytes_.load(order);
+  retval.responseBytes     = responseBytes_.load(order);
+  retval.writtenBytes      = writtenBytes_.load(order);
+  retval.decompressTime = std::chrono::nanoseconds{decompressTime_.load(order)};
+  retval.compressTime   = std::chrono::nanoseconds{compressTime_.load(order)};
+  return retval;
+}
+
+
+StreamCodec::StreamCodec(CompressionContextPtr context)
+    : context_{std::move(context)}
+    , deflate_{std::make_unique<z_stream>()}
+    , inflate_{std::make_unique<z_stream>()} {
+  const CompressionOptions &options = context_->options();
+
+  if (deflateInit2(deflate_.get(),
+                   options.level,
+                   Z_DEFLATED,
+                   options.windowBits,
+                   MEMORY_LEVEL,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    LOG_THROW(std::runtime_error, "can not initialize deflate");
+  }
+
+  if (inflateInit2(inflate_.get(), options.windowBits) != Z_OK) {
+    deflateEnd(deflate_.get());
+    LOG_THROW(std::runtime_error, "can not initialize inflate");
+  }
+
+  if (options.dictionary.empty() == false) {
+    deflateSetDictionary(deflate_.get(),
+                         toBytes(options.dictionary.data()),
+                         options.dictionary.size());
+  }
+}
+
+StreamCodec::~StreamCodec() {
+  deflateEnd(deflate_.get());
+  inflateEnd(inflate_.get());
+}
+
+error_code StreamCodec::decompress(RequestBuffer &input,
+                                   RequestBuffer &output) {
+  Clock::time_point start    = Clock::now();
+  size_t            produced = 0;
+
+  std::string_view data = input.data();
+  inflate_->next_in     = toBytes(data.data());
+  inflate_->avail_in    = data.size();
+
+  error_code err;
+  while (output.full() == false) {
+    asio::mutable_buffer space = output.prepare();
+    inflate_->next_out         = static_cast<Bytef *>(space.data());
+    inflate_->avail_out        = space.size();
+
+    int ret = inflate(inflate_.get(), Z_SYNC_FLUSH);
+
+    size_t readed = space.size() - inflate_->avail_out;
+    output.commit(readed);
+    produced += readed;
+
+    // if the space is filled, then inflate can have more output
+    inflatePending_ = inflate_->avail_out == 0;
+
+    if (ret == Z_NEED_DICT) {
+      const std::string &dictionary = context_->options().dictionary;
+      if (dictionary.empty() ||
+          inflateSetDictionary(inflate_.get(),
+                               toBytes(dictionary.data()),
+                               dictionary.size()) != Z_OK) {
+        LOG_WARNING("client uses unknown compression dictionary");
+        err = error::make_error_code(error::SessionError::CorruptedData);
+        break;
+      }
+      continue;
+    }
+
+    if (ret == Z_STREAM_END) {
+      // client finished the stream, so next data begins new one
+      inflateReset(inflate_.get());
+    } else if (ret == Z_BUF_ERROR) {
+      // no progress is possible: all input is already consumed
+      break;
+    } else if (ret != Z_OK) {
+      LOG_WARNING("invalid compressed data: %1%",
+                  inflate_->msg != nullptr ? inflate_->msg : "unknown");
+      err = error::make_error_code(error::SessionError::CorruptedData);
+      break;
+    }
+
+    if (inflate_->avail_in == 0 && inflatePending_ == false) {
+      break;
+    }
+  }
+
+  size_t consumed = data.size() - inflate_->avail_in;
+  input.consume(consumed);
+
+  context_->countDecompression(consumed, produced, Clock::now() - start);
+  return err;
+}
+
+void StreamCodec::compress(std::string_view input,
+                           std::string &    output,
+                           bool             flush) {
+  Clock::time_point start  = Clock::now();
+  size_t            before = output.size();
+
+  deflate_->next_in  = toBytes(input.data());
+  deflate_->avail_in = input.size();
+
+  int mode = flush ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+  do {
+    size_t offset = output.size();
+    size_t space  = std::max<size_t>(
+        deflateBound(deflate_.get(), deflate_->avail_in), MIN_DEFLATE_SPACE);
+    output.resize(offset + space);
+
+    deflate_->next_out  = toBytes(output.data() + offset);
+    deflate_->avail_out = space;
+
+    // Z_BUF_ERROR only means that there is nothing to do
+    int ret = deflate(deflate_.get(), mode);
+    output.resize(output.size() - deflate_->avail_out);
+    if (ret == Z_STREAM_ERROR) {
+      LOG_THROW(std::runtime_error, "deflate failed");
+    }
+  } while (deflate_->avail_out == 0);
+
+  context_->countCompression(input.size(),
+                             output.size() - before,
+                             Clock::now() - start);
+}
+} // namespace ss
@@ -0,0 +1,96 @@
+// StreamCodec.hpp
+
+#pragma once
+
+#include "RequestBuffer.hpp"
+#include "ss/CompressionOptions.hpp"
+#include "ss/errors.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// zlib.h is not included in the header, because the header is used by
+// Session.hpp
+struct z_stream_s;
+
+namespace ss {
+/**\brief options and counters of compression, shared by all sessions of a
+ * server
+ * \note thread-safe
+ */
+class CompressionContext final {
+public:
+  /**\throw std::invalid_argument if the options are invalid
+   */
+  explicit CompressionContext(CompressionOptions options);
+
+  const CompressionOptions &options() const noexcept {
+    return options_;
+  }
+
+  void countDecompression(size_t                   input,
+                          size_t                   output,
+                          std::chrono::nanoseconds time) noexcept;
+
+  void countCompression(size_t                   input,
+                        size_t                   output,
+                        std::chrono::nanoseconds time) noexcept;
+
+  CompressionStats stats() const noexcept;
+
+private:
+  CompressionOptions options_;
+
+  std::atomic<uint64_t> readBytes_{0};
+  std::atomic<uint64_t> decompressedBytes_{0};
+  std::atomic<uint64_t> responseBytes_{0};
+  std::atomic<uint64_t> writtenBytes_{0};
+  std::atomic<int64_t>  decompressTime_{0};
+  std::atomic<int64_t>  compressTime_{0};
+};
+
+using CompressionContextPtr = std::shared_ptr<CompressionContext>;
+
+/**\brief persistent compression and decompression contexts of one session
+ * \see CompressionOptions
+ */
+class StreamCodec final {
+public:
+  /**\throw std::runtime_error if zlib can not be initialized
+   */
+  explicit StreamCodec(CompressionContextPtr context);
+
+  ~StreamCodec();
+
+  StreamCodec(const StreamCodec &) = delete;
+  StreamCodec &operator=(const StreamCodec &) = delete;
+
+  /**\brief decompress the input to the output. Decompression stops, if the
+   * output is full, so rest of the input stays in the buffer
+   * \return SessionError::CorruptedData if the input is not valid stream
+   */
+  error_code decompress(RequestBuffer &input, RequestBuffer &output);
+
+  /**\return true if decompression was stopped by full output, so some
+   * decompressed data can be pending, even if there is no more input
+   */
+  bool hasPendingOutput() const noexcept {
+    return inflatePending_;
+  }
+
+  /**\brief compress the input and append it to the output
+   * \param flush if true, then all compressed data is flushed to the output,
+   * so the peer can decompress it
+   */
+  void compress(std::string_view input, std::string &output, bool flush);
+
+private:
+  CompressionContextPtr       context_;
+  std::unique_ptr<z_stream_s> deflate_;
+  std::unique_ptr<z_stream_s> inflate_;
+  bool                        inflatePending_ = false;
+};
+
+using StreamCodecPtr = std::unique_ptr<StreamCodec>;
+} // namespace ss
@@ -0,0 +1,138 @@
+// ThreadPool.cpp
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <simple_logs/logs.hpp>
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+namespace ss {
+namespace {
+void runContext(asio::io_context &context) noexcept {
+  for (;;) {
+    try {
+      context.run();
+      break;
+    } catch (std::exception &e) {
+      LOG_ERROR(e.what());
+    }
+  }
+}
+} // namespace
+
+ThreadPool::ThreadPool(asio::io_context &acceptContext,
+                       ThreadPoolOptions options)
+    : acceptContext_{acceptContext}
+    , options_{std::move(options)} {
+  size_t ioThreads = options_.ioThreads;
+  if (ioThreads == 0) {
+    ioThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  ioThreads_.reserve(ioThreads);
+  for (size_t i = 0; i < ioThreads; ++i) {
+    ioThreads_.emplace_back(std::make_shared<IoThread>());
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  this->stop();
+
+  auto join = [](std::thread &th) {
+    if (th.joinable() == false) {
+      return;
+    }
+
+    // pool can be destroyed from own thread, for example by last handler.
+    // Then the thread keeps its context until the end of run
+    if (th.get_id() == std::this_thread::get_id()) {
+      th.detach();
+    } else {
+      th.join();
+    }
+  };
+
+  for (std::shared_ptr<IoThread> &ioThread : ioThreads_) {
+    join(ioThread->thread);
+  }
+  for (std::thread &th : acceptThreads_) {
+    join(th);
+  }
+}
+
+void ThreadPool::start() {
+  LOG_DEBUG("start %1% io threads and %2% accept threads",
+            ioThreads_.size(),
+            options_.acceptThreads);
+
+  for (size_t i = 0; i < ioThreads_.size(); ++i) {
+    std::shared_ptr<IoThread> ioThread = ioThreads_[i];
+    if (ioThread->thread.joinable()) {
+      continue;
+    }
+
+    ioThread->context.restart();
+    ioThread->workGuard.emplace(ioThread->context.get_executor());
+    ioThread->thread = std::thread{[ioThread, cpus = options_.ioCpus, i]() {
+      pinCurrentThread(cpus, i);
+      runContext(ioThread->context);
+    }};
+  }
+
+  if (acceptThreads_.empty() == false) {
+    return;
+  }
+  for (size_t i = 0; i < options_.acceptThreads; ++i) {
+    acceptThreads_.emplace_back(
+        [&context = acceptContext_, cpus = options_.acceptCpus, i]() {
+          pinCurrentThread(cpus, i);
+          runContext(context);
+        });
+  }
+}
+
+void ThreadPool::stop() noexcept {
+  for (std::shared_ptr<IoThread> &ioThread : ioThreads_) {
+    ioThread->workGuard.reset();
+  }
+}
+
+asio::io_context &ThreadPool::nextContext() noexcept {
+  size_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  return ioThreads_[index % ioThreads_.size()]->context;
+}
+
+size_t ThreadPool::indexOf(const asio::execution_context &context) const
+    noexcept {
+  for (size_t i = 0; i < ioThreads_.size(); ++i) {
+    if (&ioThreads_[i]->context == &context) {
+      return i;
+    }
+  }
+  return ioThreads_.size();
+}
+
+void ThreadPool::pinCurrentThread(const std::vector<int> &cpus,
+                                  size_t                  index) {
+  if (cpus.empty()) {
+    return;
+  }
+
+  int cpu = cpus[index % cpus.size()];
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+  if (err != 0) {
+    LOG_WARNING("can not pin thread to cpu %1%: %2%", cpu, std::strerror(err));
+  }
+#else
+  LOG_WARNING("pinning to cpu %1% is not supported on the platform", cpu);
+#endif
+}
+} // namespace ss
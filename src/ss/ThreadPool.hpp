@@ -0,0 +1,83 @@
+// ThreadPool.hpp
+
+#pragma once
+
+#include "ss/ThreadPoolOptions.hpp"
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <list>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ss {
+namespace asio = boost::asio;
+
+/**\brief runs I/O threads, every of them with own io_context, and accept
+ * threads for external context
+ * \see ThreadPoolOptions
+ */
+class ThreadPool final {
+public:
+  ThreadPool(asio::io_context &acceptContext, ThreadPoolOptions options);
+
+  /**\brief stops and joins all threads
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void start();
+
+  /**\brief allows I/O threads to finish, when their contexts have no more
+   * work. Doesn't wait for the threads
+   */
+  void stop() noexcept;
+
+  /**\return context for next session
+   * \note thread-safe
+   */
+  asio::io_context &nextContext() noexcept;
+
+  size_t size() const noexcept {
+    return ioThreads_.size();
+  }
+
+  asio::io_context &context(size_t index) noexcept {
+    return ioThreads_[index]->context;
+  }
+
+  /**\return index of I/O thread, which runs the context, or size() if the
+   * context doesn't belong to the pool
+   */
+  size_t indexOf(const asio::execution_context &context) const noexcept;
+
+  const ThreadPoolOptions &options() const noexcept {
+    return options_;
+  }
+
+private:
+  using WorkGuard = asio::executor_work_guard<asio::io_context::executor_type>;
+
+  struct IoThread {
+    asio::io_context         context{1};
+    std::optional<WorkGuard> workGuard;
+    std::thread              thread;
+  };
+
+  static void pinCurrentThread(const std::vector<int> &cpus, size_t index);
+
+private:
+  asio::io_context &acceptContext_;
+  ThreadPoolOptions options_;
+
+  // thread body owns its IoThread too, so the context outlives the pool, if
+  // the pool is destroyed from the thread
+  std::vector<std::shared_ptr<IoThread>> ioThreads_;
+  std::list<std::thread>                 acceptThreads_;
+  std::atomic<size_t>                    next_ = 0;
+};
+} // namespace ss
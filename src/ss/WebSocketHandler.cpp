@@ -0,0 +1,491 @@
+// WebSocketHandler.cpp
+
+#include "ss/WebSocketHandler.hpp"
+#include "ss/HttpRequestHandler.hpp"
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+#include <cstring>
+#include <simple_logs/logs.hpp>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#  include <immintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+namespace ss {
+namespace ws {
+namespace {
+constexpr std::string_view HANDSHAKE_GUID =
+    "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+constexpr size_t MAX_CONTROL_PAYLOAD   = 125;
+constexpr size_t MAX_FRAME_HEADER_SIZE = 10;
+
+std::string base64(const unsigned char *data, size_t size) {
+  constexpr std::string_view alphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string retval;
+  retval.reserve((size + 2) / 3 * 4);
+  for (size_t i = 0; i < size; i += 3) {
+    uint32_t group = data[i] << 16;
+    if (i + 1 < size) {
+      group |= data[i + 1] << 8;
+    }
+    if (i + 2 < size) {
+      group |= data[i + 2];
+    }
+
+    retval.push_back(alphabet[(group >> 18) & 0x3f]);
+    retval.push_back(alphabet[(group >> 12) & 0x3f]);
+    retval.push_back(i + 1 < size ? alphabet[(group >> 6) & 0x3f] : '=');
+    retval.push_back(i + 2 < size ? alphabet[group & 0x3f] : '=');
+  }
+  return retval;
+}
+
+/**\brief write header of single not masked frame
+ * \return size of the header
+ */
+size_t writeFrameHeader(char *header, Opcode opcode, size_t payloadSize) {
+  header[0] = static_cast<char>(0x80 | static_cast<uint8_t>(opcode));
+  if (payloadSize < 126) {
+    header[1] = static_cast<char>(payloadSize);
+    return 2;
+  }
+
+  if (payloadSize <= UINT16_MAX) {
+    header[1]     = 126;
+    uint16_t size = boost::endian::native_to_big(
+        static_cast<uint16_t>(payloadSize));
+    std::memcpy(header + 2, &size, sizeof(size));
+    return 2 + sizeof(size);
+  }
+
+  header[1]     = 127;
+  uint64_t size = boost::endian::native_to_big(
+      static_cast<uint64_t>(payloadSize));
+  std::memcpy(header + 2, &size, sizeof(size));
+  return 2 + sizeof(size);
+}
+
+/**\brief check that comma separated list of the header contains the token
+ */
+bool hasToken(std::string_view list, std::string_view token) noexcept {
+  while (list.empty() == false) {
+    size_t           comma = list.find(',');
+    std::string_view item  = list.substr(0, comma);
+    while (item.empty() == false && item.front() == ' ') {
+      item.remove_prefix(1);
+    }
+    while (item.empty() == false && item.back() == ' ') {
+      item.remove_suffix(1);
+    }
+
+    if (http::iequals(item, token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
+} // namespace
+
+void appendFrame(std::string &output, Opcode opcode, std::string_view payload) {
+  char   header[MAX_FRAME_HEADER_SIZE];
+  size_t headerSize = writeFrameHeader(header, opcode, payload.size());
+
+  output.reserve(output.size() + headerSize + payload.size());
+  output.append(header, headerSize);
+  output.append(payload);
+}
+
+std::string makeFrame(Opcode opcode, std::string_view payload) {
+  std::string retval;
+  appendFrame(retval, opcode, payload);
+  return retval;
+}
+
+void unmask(char *      dst,
+            const char *src,
+            size_t      size,
+            const char *mask) noexcept {
+  uint32_t mask32;
+  std::memcpy(&mask32, mask, sizeof(mask32));
+
+  // every step processes multiple of 4 bytes, so mask is not shifted
+  size_t i = 0;
+#if defined(__AVX2__)
+  __m256i mask256 = _mm256_set1_epi32(static_cast<int>(mask32));
+  for (; i + 32 <= size; i += 32) {
+    __m256i data =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_xor_si256(data, mask256));
+  }
+#endif
+#if defined(__SSE2__)
+  __m128i mask128 = _mm_set1_epi32(static_cast<int>(mask32));
+  for (; i + 16 <= size; i += 16) {
+    __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_xor_si128(data, mask128));
+  }
+#elif defined(__ARM_NEON)
+  uint8x16_t mask128 = vreinterpretq_u8_u32(vdupq_n_u32(mask32));
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t data = vld1q_u8(reinterpret_cast<const uint8_t *>(src + i));
+    vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), veorq_u8(data, mask128));
+  }
+#endif
+
+  uint64_t mask64 = (static_cast<uint64_t>(mask32) << 32) | mask32;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t data;
+    std::memcpy(&data, src + i, sizeof(data));
+    data ^= mask64;
+    std::memcpy(dst + i, &data, sizeof(data));
+  }
+
+  for (; i < size; ++i) {
+    dst[i] = src[i] ^ mask[i % 4];
+  }
+}
+
+std::string acceptKey(std::string_view key) {
+  boost::uuids::detail::sha1 sha1;
+  sha1.process_bytes(key.data(), key.size());
+  sha1.process_bytes(HANDSHAKE_GUID.data(), HANDSHAKE_GUID.size());
+
+  boost::uuids::detail::sha1::digest_type digest;
+  sha1.get_digest(digest);
+
+  unsigned char bytes[20];
+  for (size_t i = 0; i < 5; ++i) {
+    uint32_t word =
+        boost::endian::native_to_big(static_cast<uint32_t>(digest[i]));
+    std::memcpy(bytes + i * 4, &word, sizeof(word));
+  }
+
+  return base64(bytes, sizeof(bytes));
+}
+
+bool isValidCloseCode(uint16_t code) noexcept {
+  if (code >= 3000 && code <= 4999) {
+    // registered by IANA and private codes
+    return true;
+  }
+
+  return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014);
+}
+} // namespace ws
+
+error_code
+AbstractWebSocketHandler::handle(std::string_view requestBuffer,
+                                 ResponseInserter respIter,
+                                 size_t &         reqIgnoreLength) noexcept {
+  try {
+    output_ = respIter;
+
+    size_t offset = 0;
+    if (state_ == State::Handshake) {
+      offset = this->handshake(requestBuffer);
+      if (offset == 0) {
+        output_.reset();
+        return state_ == State::Handshake
+                   ? error::make_error_code(error::SessionError::PartialData)
+                   : error_code{};
+      }
+    }
+
+    error_code err;
+    while (state_ == State::Open) {
+      if (inFrame_ == false) {
+        size_t headerSize =
+            this->parseFrameHeader(requestBuffer.substr(offset));
+        if (headerSize == 0) {
+          break;
+        }
+        offset += headerSize;
+      }
+
+      // unmask available part of payload, so request buffer doesn't hold
+      // partial frames
+      size_t available =
+          std::min(requestBuffer.size() - offset, frameRemaining_);
+      bool         isControl = static_cast<uint8_t>(frameOpcode_) & 0x8;
+      std::string &payload   = isControl ? control_ : message_;
+
+      size_t payloadSize = payload.size();
+      payload.resize(payloadSize + available);
+
+      char mask[4];
+      for (size_t i = 0; i < 4; ++i) {
+        mask[i] = mask_[(maskOffset_ + i) % 4];
+      }
+      ws::unmask(payload.data() + payloadSize,
+                 requestBuffer.data() + offset,
+                 available,
+                 mask);
+
+      maskOffset_ = (maskOffset_ + available) % 4;
+      frameRemaining_ -= available;
+      offset += available;
+      if (frameRemaining_ != 0) {
+        break;
+      }
+
+      inFrame_ = false;
+      err      = this->completeFrame();
+      if (err.failed()) {
+        break;
+      }
+    }
+
+    output_.reset();
+    if (err.failed()) {
+      return err;
+    }
+
+    if (offset >= requestBuffer.size() || state_ == State::Closed) {
+      // 0 means that whole buffer is handled
+      reqIgnoreLength = 0;
+      return error_code{};
+    }
+
+    // tail of the buffer is a part of next frame header
+    reqIgnoreLength = offset;
+    return error::make_error_code(error::SessionError::PartialData);
+  } catch (std::exception &e) {
+    LOG_ERROR(e.what());
+    output_.reset();
+    return error::make_error_code(error::SessionError::SessionClosed);
+  }
+}
+
+size_t AbstractWebSocketHandler::handshake(std::string_view requestBuffer) {
+  http::ParseStatus status = parser_.parse(requestBuffer, request_);
+  if (status == http::ParseStatus::Partial) {
+    return 0;
+  }
+
+  http::Request rejected;
+  rejected.keepAlive = false;
+  http::ResponseWriter response{*output_, rejected};
+
+  if (status != http::ParseStatus::Complete) {
+    LOG_WARNING("invalid websocket handshake request");
+    unsigned code = 400;
+    if (status == http::ParseStatus::TooLarge) {
+      code = parser_.headParsed() ? 413 : 431;
+    }
+    response.status(code).body();
+
+    state_ = State::Closed;
+    this->closeAfterWrite();
+    return 0;
+  }
+
+  std::string_view key = request_.header("Sec-WebSocket-Key");
+  if (request_.method != "GET" ||
+      ws::hasToken(request_.header("Upgrade"), "websocket") == false ||
+      ws::hasToken(request_.header("Connection"), "upgrade") == false ||
+      request_.header("Sec-WebSocket-Version") != "13" || key.empty()) {
+    LOG_WARNING("not websocket upgrade request: %1% %2%",
+                request_.method,
+                request_.target);
+    response.status(426).header("Sec-WebSocket-Version", "13").body();
+
+    state_ = State::Closed;
+    this->closeAfterWrite();
+    return 0;
+  }
+
+  if (this->atUpgrade(request_) == false) {
+    response.status(403).body();
+
+    state_ = State::Closed;
+    this->closeAfterWrite();
+    return 0;
+  }
+
+  // the response has no body, so it is written without response writer
+  std::string accept = ws::acceptKey(key);
+  this->write("HTTP/1.1 101 Switching Protocols\r\n"
+              "Upgrade: websocket\r\n"
+              "Connection: Upgrade\r\n"
+              "Sec-WebSocket-Accept: ");
+  this->write(accept);
+  this->write("\r\n\r\n");
+
+  size_t size = parser_.size();
+  parser_.reset();
+  state_ = State::Open;
+  return size;
+}
+
+size_t AbstractWebSocketHandler::parseFrameHeader(std::string_view data) {
+  if (data.size() < 2) {
+    return 0;
+  }
+
+  uint8_t first  = static_cast<uint8_t>(data[0]);
+  uint8_t second = static_cast<uint8_t>(data[1]);
+
+  size_t lengthSize = 0;
+  if ((second & 0x7f) == 126) {
+    lengthSize = 2;
+  } else if ((second & 0x7f) == 127) {
+    lengthSize = 8;
+  }
+
+  // client frames are always masked
+  size_t headerSize = 2 + lengthSize + 4;
+  if ((second & 0x80) == 0) {
+    LOG_WARNING("not masked websocket frame");
+    this->close(ws::CloseCode::ProtocolError);
+    return 0;
+  }
+
+  if (data.size() < headerSize) {
+    return 0;
+  }
+
+  bool       fin    = first & 0x80;
+  ws::Opcode opcode = static_cast<ws::Opcode>(first & 0x0f);
+
+  uint64_t length = second & 0x7f;
+  if (lengthSize == 2) {
+    uint16_t size;
+    std::memcpy(&size, data.data() + 2, sizeof(size));
+    length = boost::endian::big_to_native(size);
+  } else if (lengthSize == 8) {
+    std::memcpy(&length, data.data() + 2, sizeof(length));
+    length = boost::endian::big_to_native(length);
+  }
+
+  // extensions are not negotiated, so rsv bits must be 0
+  bool valid = (first & 0x70) == 0 && (length >> 63) == 0;
+  switch (opcode) {
+  case ws::Opcode::Close:
+  case ws::Opcode::Ping:
+  case ws::Opcode::Pong:
+    valid = valid && fin && length <= ws::MAX_CONTROL_PAYLOAD;
+    break;
+  case ws::Opcode::Continuation:
+    valid = valid && fragmented_;
+    break;
+  case ws::Opcode::Text:
+  case ws::Opcode::Binary:
+    valid        = valid && fragmented_ == false;
+    messageType_ = opcode;
+    break;
+  default:
+    valid = false;
+    break;
+  }
+
+  if (valid == false) {
+    LOG_WARNING("invalid websocket frame");
+    this->close(ws::CloseCode::ProtocolError);
+    return 0;
+  }
+
+  if ((static_cast<uint8_t>(opcode) & 0x8) == 0 &&
+      length > maxMessageSize_ - message_.size()) {
+    LOG_WARNING("websocket message is too big");
+    this->close(ws::CloseCode::MessageTooBig);
+    return 0;
+  }
+
+  std::memcpy(mask_, data.data() + 2 + lengthSize, sizeof(mask_));
+  maskOffset_     = 0;
+  frameOpcode_    = opcode;
+  frameFin_       = fin;
+  frameRemaining_ = length;
+  inFrame_        = true;
+
+  return headerSize;
+}
+
+error_code AbstractWebSocketHandler::completeFrame() {
+  error_code err;
+  switch (frameOpcode_) {
+  case ws::Opcode::Continuation:
+  case ws::Opcode::Text:
+  case ws::Opcode::Binary:
+    fragmented_ = frameFin_ == false;
+    if (frameFin_) {
+      err = this->handleMessage(messageType_, message_);
+
+      // capacity is saved for next messages
+      message_.clear();
+    }
+    break;
+  case ws::Opcode::Ping:
+    this->send(ws::Opcode::Pong, control_);
+    break;
+  case ws::Opcode::Pong:
+    break;
+  case ws::Opcode::Close: {
+    uint16_t code = ws::CloseCode::Normal;
+    if (control_.size() >= sizeof(code)) {
+      std::memcpy(&code, control_.data(), sizeof(code));
+      code = boost::endian::big_to_native(code);
+    } else if (control_.size() == 1) {
+      code = ws::CloseCode::ProtocolError;
+    }
+
+    LOG_DEBUG("websocket closed by client: %1%", code);
+    if (ws::isValidCloseCode(code) == false) {
+      code = ws::CloseCode::ProtocolError;
+    }
+    this->close(code);
+    break;
+  }
+  }
+
+  control_.clear();
+  return err;
+}
+
+void AbstractWebSocketHandler::send(ws::Opcode       opcode,
+                                    std::string_view payload) {
+  if (output_.has_value() == false) {
+    LOG_THROW(std::logic_error, "send can be called only inside of handler");
+  }
+
+  char   header[ws::MAX_FRAME_HEADER_SIZE];
+  size_t headerSize = ws::writeFrameHeader(header, opcode, payload.size());
+
+  this->write(std::string_view{header, headerSize});
+  this->write(payload);
+}
+
+void AbstractWebSocketHandler::close(uint16_t code) {
+  if (state_ != State::Open) {
+    return;
+  }
+
+  if (code == ws::CloseCode::NoStatusPresent) {
+    this->send(ws::Opcode::Close, std::string_view{});
+  } else {
+    uint16_t payload = boost::endian::native_to_big(code);
+    this->send(ws::Opcode::Close,
+               std::string_view{reinterpret_cast<const char *>(&payload),
+                                sizeof(payload)});
+  }
+
+  state_ = State::Closed;
+  this->closeAfterWrite();
+}
+
+void AbstractWebSocketHandler::write(std::string_view data) {
+  *output_ = std::copy(data.begin(), data.end(), *output_);
+}
+} // namespace ss
@@ -0,0 +1,49 @@
+// CaptureFormatTest.cpp
+
+#include "CaptureFormat.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+namespace capture = ss::capture;
+
+TEST(CaptureFormat, records) {
+  std::string out;
+  capture::writeRecord(out, capture::RecordType::Open, 1, 10);
+  capture::writeRecord(out, capture::RecordType::Data, 1, 300, "request");
+  capture::writeRecord(out, capture::RecordType::Close, 1, 100000);
+
+  std::istringstream in{out};
+  capture::Record    record;
+  ASSERT_TRUE(capture::readRecord(in, record));
+  EXPECT_EQ(record.type, capture::RecordType::Open);
+  EXPECT_EQ(record.connection, 1);
+  EXPECT_EQ(record.time, 10);
+
+  ASSERT_TRUE(capture::readRecord(in, record));
+  EXPECT_EQ(record.type, capture::RecordType::Data);
+  EXPECT_EQ(record.time, 300);
+  EXPECT_EQ(record.data, "request");
+
+  ASSERT_TRUE(capture::readRecord(in, record));
+  EXPECT_EQ(record.type, capture::RecordType::Close);
+  EXPECT_TRUE(record.data.empty());
+
+  EXPECT_FALSE(capture::readRecord(in, record));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST(CaptureFormat, tooBigData) {
+  // size of data is corrupted, so it is much bigger than the stream
+  std::string out;
+  out.push_back(static_cast<char>(capture::RecordType::Data));
+  capture::writeVarint(out, 1);
+  capture::writeVarint(out, 1);
+  capture::writeVarint(out, UINT64_MAX);
+  out += "request";
+
+  std::istringstream in{out};
+  capture::Record    record;
+  EXPECT_FALSE(capture::readRecord(in, record));
+  // so it is reported as broken file, not as end of the stream
+  EXPECT_FALSE(in.eof());
+}
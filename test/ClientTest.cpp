@@ -0,0 +1,108 @@
+// ClientTest.cpp
+
+#include "EchoHandler.hpp"
+#include "ss/Client.hpp"
+#include "ss/Server.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+namespace asio = boost::asio;
+
+using ss::test::EchoFactory;
+
+/**\brief echo server and client in the same context
+ */
+class ClientTest : public ::testing::Test {
+protected:
+  ClientTest()
+      : path_{"/tmp/ss_client_test_" + std::to_string(::getpid()) +
+              ".sock"} {
+    ::unlink(path_.c_str());
+
+    server_ = ss::ServerBuilder{ioContext_}
+                  .setEndpoint(ss::Server::Protocol::Unix, path_)
+                  .setRequestHandlerFactory(factory_)
+                  .build();
+    server_->asyncRun();
+
+    client_ = ss::ClientBuilder{ioContext_}
+                  .setEndpoint(ss::Server::Protocol::Unix, path_)
+                  .setResponseHandlerFactory(factory_)
+                  .setConnections(2)
+                  .build();
+  }
+
+  ~ClientTest() override {
+    client_->close();
+    server_->stop();
+    ioContext_.run();
+    ::unlink(path_.c_str());
+  }
+
+protected:
+  asio::io_context          ioContext_{1};
+  std::string               path_;
+  ss::RequestHandlerFactory factory_ = std::make_shared<EchoFactory>();
+  ss::ServerPtr             server_;
+  ss::ClientPtr             client_;
+};
+} // namespace
+
+TEST_F(ClientTest, requestBeforeConnect) {
+  EXPECT_EQ(client_->asyncRequest("first\n", [](ss::error_code, auto) {
+    FAIL() << "request is accepted by not connected client";
+  }),
+            ss::error::make_error_code(ss::error::SessionError::SessionClosed));
+
+  client_->asyncConnect();
+
+  // requests are accepted before the context runs, so before connection
+  std::vector<std::string> responses;
+  for (int i = 0; i < 8; ++i) {
+    ss::error_code err = client_->asyncRequest(
+        "request " + std::to_string(i) + "\n",
+        [&responses](ss::error_code responseErr, std::string_view response) {
+          EXPECT_FALSE(responseErr.failed()) << responseErr.message();
+          responses.emplace_back(response);
+        });
+    ASSERT_FALSE(err.failed()) << err.message();
+  }
+  EXPECT_EQ(client_->stats().connected, 0);
+
+  while (responses.size() < 8) {
+    ioContext_.run_one();
+  }
+
+  std::sort(responses.begin(), responses.end());
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(responses[i], "request " + std::to_string(i) + "\n");
+  }
+}
+
+TEST_F(ClientTest, closeCompletesRequests) {
+  client_->asyncConnect();
+
+  ss::error_code result;
+  bool           called = false;
+  ASSERT_FALSE(client_
+                   ->asyncRequest("not completed",
+                                  [&](ss::error_code err, std::string_view) {
+                                    result = err;
+                                    called = true;
+                                  })
+                   .failed());
+
+  client_->close();
+  ioContext_.poll();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(result,
+            ss::error::make_error_code(ss::error::SessionError::SessionClosed));
+
+  // closed client doesn't accept requests
+  EXPECT_TRUE(client_->asyncRequest("next\n", [](ss::error_code, auto) {
+                       }).failed());
+}
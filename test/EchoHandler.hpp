@@ -0,0 +1,39 @@
+// EchoHandler.hpp
+/**\file
+ * Line echo handler, shared by tests and benchmarks
+ */
+
+#pragma once
+
+#include "ss/AbstractRequestHandler.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace ss {
+namespace test {
+/**\brief returns every line of request back
+ */
+class LineEchoHandler final : public AbstractRequestHandler {
+public:
+  error_code handle(std::string_view request,
+                    ResponseInserter respInserter,
+                    size_t &         reqIgnoreLength) noexcept override {
+    size_t end = request.find('\n');
+    if (end == std::string_view::npos) {
+      return error::make_error_code(error::SessionError::PartialData);
+    }
+
+    std::copy(request.begin(), request.begin() + end + 1, respInserter);
+    reqIgnoreLength = end + 1;
+    return error_code{};
+  }
+};
+
+class EchoFactory final : public AbstractRequestHandlerFactory {
+public:
+  RequestHandler makeRequestHandler() noexcept override {
+    return std::make_shared<LineEchoHandler>();
+  }
+};
+} // namespace test
+} // namespace ss
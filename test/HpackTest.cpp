@@ -0,0 +1,335 @@
+// HpackTest.cpp
+
+#include "ss/Hpack.hpp"
+#include "ss/Http2RequestHandler.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+std::string fromHex(std::string_view hex) {
+  std::string retval;
+  int         high = -1;
+  for (char c : hex) {
+    if (c == ' ') {
+      continue;
+    }
+
+    int digit = c <= '9' ? c - '0' : c - 'a' + 10;
+    if (high < 0) {
+      high = digit;
+    } else {
+      retval.push_back(static_cast<char>(high << 4 | digit));
+      high = -1;
+    }
+  }
+  return retval;
+}
+
+Headers toVector(const ss::hpack::HeaderList &list) {
+  Headers retval;
+  for (size_t i = 0; i < list.size(); ++i) {
+    retval.emplace_back(list.name(i), list.value(i));
+  }
+  return retval;
+}
+
+/**\brief decode blocks in order by one decoder and compare every result
+ */
+void checkSequence(
+    ss::hpack::Decoder &                                  decoder,
+    const std::vector<std::pair<std::string_view, Headers>> &blocks) {
+  for (const auto &[hex, expected] : blocks) {
+    ss::hpack::HeaderList list;
+    ASSERT_TRUE(decoder.decode(fromHex(hex), list)) << hex;
+    EXPECT_EQ(toVector(list), expected) << hex;
+  }
+}
+
+/**\return header block with one big literal (added to the dynamic table) and
+ * many 1-byte references to it
+ */
+std::string makeBomb(size_t valueSize, size_t references) {
+  std::string block;
+  ss::hpack::encodeInteger(block, 0x40, 6, 0);
+  ss::hpack::encodeInteger(block, 0x00, 7, 1);
+  block.push_back('x');
+  ss::hpack::encodeInteger(block, 0x00, 7, valueSize);
+  block.append(valueSize, 'v');
+
+  // index of first entry in dynamic table
+  block.append(references, '\xbe');
+  return block;
+}
+
+const Headers REQUEST_1 = {
+    {":method", "GET"},
+    {":scheme", "http"},
+    {":path", "/"},
+    {":authority", "www.example.com"},
+};
+
+const Headers REQUEST_2 = {
+    {":method", "GET"},
+    {":scheme", "http"},
+    {":path", "/"},
+    {":authority", "www.example.com"},
+    {"cache-control", "no-cache"},
+};
+
+const Headers REQUEST_3 = {
+    {":method", "GET"},
+    {":scheme", "https"},
+    {":path", "/index.html"},
+    {":authority", "www.example.com"},
+    {"custom-key", "custom-value"},
+};
+
+const Headers RESPONSE_1 = {
+    {":status", "302"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"},
+};
+
+const Headers RESPONSE_2 = {
+    {":status", "307"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"},
+};
+
+const Headers RESPONSE_3 = {
+    {":status", "200"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+    {"location", "https://www.example.com"},
+    {"content-encoding", "gzip"},
+    {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"},
+};
+} // namespace
+
+// examples of RFC 7541, appendix C
+
+TEST(Hpack, integers) {
+  std::string output;
+  ss::hpack::encodeInteger(output, 0x00, 5, 10);
+  EXPECT_EQ(output, fromHex("0a"));
+
+  output.clear();
+  ss::hpack::encodeInteger(output, 0x00, 5, 1337);
+  EXPECT_EQ(output, fromHex("1f9a0a"));
+
+  output.clear();
+  ss::hpack::encodeInteger(output, 0x00, 8, 42);
+  EXPECT_EQ(output, fromHex("2a"));
+}
+
+TEST(Hpack, literals) {
+  ss::hpack::Decoder decoder;
+  checkSequence(
+      decoder,
+      {
+          {"400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572",
+           {{"custom-key", "custom-header"}}},
+          {"040c 2f73 616d 706c 652f 7061 7468", {{":path", "/sample/path"}}},
+          {"1008 7061 7373 776f 7264 0673 6563 7265 74",
+           {{"password", "secret"}}},
+          {"82", {{":method", "GET"}}},
+          // entry from the first block
+          {"be", {{"custom-key", "custom-header"}}},
+      });
+}
+
+TEST(Hpack, requestsWithoutHuffman) {
+  ss::hpack::Decoder decoder;
+  checkSequence(decoder,
+                {
+                    {"8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+                     REQUEST_1},
+                    {"8286 84be 5808 6e6f 2d63 6163 6865", REQUEST_2},
+                    {"8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f "
+                     "6d2d 7661 6c75 65",
+                     REQUEST_3},
+                });
+}
+
+TEST(Hpack, requestsWithHuffman) {
+  ss::hpack::Decoder decoder;
+  checkSequence(decoder,
+                {
+                    {"8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff", REQUEST_1},
+                    {"8286 84be 5886 a8eb 1064 9cbf", REQUEST_2},
+                    {"8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 "
+                     "b4bf",
+                     REQUEST_3},
+                });
+}
+
+TEST(Hpack, responsesWithoutHuffman) {
+  // small table, so entries are evicted
+  ss::hpack::Decoder decoder{256};
+  checkSequence(
+      decoder,
+      {
+          {"4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 "
+           "7420 3230 3133 2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 "
+           "3a2f 2f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+           RESPONSE_1},
+          {"4803 3330 37c1 c0bf", RESPONSE_2},
+          {"88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 "
+           "3a32 3220 474d 54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 "
+           "514b 425a 584f 5157 454f 5049 5541 5851 5745 4f49 553b 206d 6178 "
+           "2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e 3d31",
+           RESPONSE_3},
+      });
+}
+
+TEST(Hpack, responsesWithHuffman) {
+  ss::hpack::Decoder decoder{256};
+  checkSequence(
+      decoder,
+      {
+          {"4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 "
+           "0b81 66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae "
+           "43d3",
+           RESPONSE_1},
+          {"4883 640e ffc1 c0bf", RESPONSE_2},
+          {"88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff "
+           "c05a 839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af "
+           "2708 7f36 72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 "
+           "07",
+           RESPONSE_3},
+      });
+}
+
+TEST(Hpack, invalidHuffman) {
+  std::string output;
+  // padding longer than 7 bits
+  EXPECT_FALSE(ss::hpack::huffmanDecode(fromHex("ffff"), output));
+  // padding is not most significant bits of EOS
+  output.clear();
+  EXPECT_FALSE(ss::hpack::huffmanDecode(fromHex("00"), output));
+
+  output.clear();
+  EXPECT_TRUE(ss::hpack::huffmanDecode(fromHex("07"), output));
+  EXPECT_EQ(output, "0");
+}
+
+TEST(Hpack, invalidBlocks) {
+  const char *blocks[] = {
+      // index 0
+      "80",
+      // not existing entry of dynamic table
+      "be",
+      // truncated integer
+      "1f",
+      // truncated string
+      "4003 6162",
+      // table size update after header
+      "82 3f e1 1f",
+      // table size update bigger than the limit
+      "3f e2 1f",
+  };
+
+  for (std::string_view hex : blocks) {
+    ss::hpack::Decoder    decoder;
+    ss::hpack::HeaderList list;
+    EXPECT_FALSE(decoder.decode(fromHex(hex), list)) << hex;
+  }
+}
+
+TEST(Hpack, encodeHeader) {
+  std::string block;
+  ss::hpack::encodeStatus(block, 200);
+  ss::hpack::encodeStatus(block, 431);
+  ss::hpack::encodeHeader(block, "content-type", "text/plain");
+  ss::hpack::encodeHeader(block, "x-custom", std::string(200, 'a'));
+
+  ss::hpack::Decoder    decoder;
+  ss::hpack::HeaderList list;
+  ASSERT_TRUE(decoder.decode(block, list));
+  EXPECT_EQ(toVector(list),
+            (Headers{
+                {":status", "200"},
+                {":status", "431"},
+                {"content-type", "text/plain"},
+                {"x-custom", std::string(200, 'a')},
+            }));
+}
+
+TEST(Hpack, maxListSize) {
+  // 16 KB block is decoded to about 48 MB without the limit
+  std::string block = makeBomb(4000, 12000);
+
+  ss::hpack::Decoder    decoder;
+  ss::hpack::HeaderList list;
+  EXPECT_FALSE(decoder.decode(block, list, 64 * 1024));
+  EXPECT_LE(list.listSize(), 64 * 1024 + 4000 + 33);
+
+  // the limit is inclusive
+  block = makeBomb(100, 1);
+
+  ss::hpack::Decoder decoder2;
+  list.clear();
+  ASSERT_TRUE(decoder2.decode(block, list, 2 * (1 + 100 + 32)));
+  EXPECT_EQ(list.size(), 2);
+  EXPECT_EQ(list.listSize(), 2 * (1 + 100 + 32));
+}
+
+namespace {
+class NullHandler final : public ss::AbstractHttp2RequestHandler {
+public:
+  ss::error_code handleRequest(const ss::http::Request &,
+                               ss::http2::ResponseWriter &response) noexcept
+      override {
+    response.status(200).body();
+    return ss::error_code{};
+  }
+};
+
+std::string frameHeader(size_t length, uint8_t type, uint8_t flags) {
+  std::string header;
+  header.push_back(static_cast<char>(length >> 16));
+  header.push_back(static_cast<char>(length >> 8));
+  header.push_back(static_cast<char>(length));
+  header.push_back(static_cast<char>(type));
+  header.push_back(static_cast<char>(flags));
+  header.append(fromHex("00000001"));
+  return header;
+}
+} // namespace
+
+TEST(Http2, tooBigHeaderList) {
+  NullHandler handler;
+  std::string output;
+  size_t      reqIgnoreLength = 0;
+
+  std::string request = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+  ASSERT_FALSE(handler
+                   .handle(request, std::back_inserter(output), reqIgnoreLength)
+                   .failed());
+
+  // settings of the server announce the limit
+  std::string settings = frameHeader(12, 0x4, 0x0);
+  settings.replace(5, 4, 4, '\0');
+  settings += fromHex("0003 0000 0100 0006 0001 0000");
+  EXPECT_EQ(output, settings);
+
+  // HEADERS with END_STREAM and END_HEADERS
+  std::string block = makeBomb(4000, 12000);
+  request           = frameHeader(block.size(), 0x1, 0x5) + block;
+
+  output.clear();
+  ASSERT_FALSE(handler
+                   .handle(request, std::back_inserter(output), reqIgnoreLength)
+                   .failed());
+
+  // GOAWAY with COMPRESSION_ERROR
+  ASSERT_GE(output.size(), 9 + 8);
+  EXPECT_EQ(output[3], 0x7);
+  EXPECT_EQ(output.substr(output.size() - 4), fromHex("00000009"));
+}
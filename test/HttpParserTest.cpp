@@ -0,0 +1,329 @@
+// HttpParserTest.cpp
+
+#include "ss/HttpParser.hpp"
+#include "ss/HttpRequestHandler.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using ss::http::ParseStatus;
+using ss::http::Request;
+using ss::http::RequestParser;
+
+TEST(HttpParser, simpleRequest) {
+  std::string_view buffer = "GET /index.html HTTP/1.1\r\n"
+                            "Host: example.com\r\n"
+                            "Accept:  */* \r\n"
+                            "\r\n";
+
+  RequestParser parser;
+  Request       request;
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(parser.size(), buffer.size());
+  EXPECT_EQ(request.method, "GET");
+  EXPECT_EQ(request.target, "/index.html");
+  EXPECT_EQ(request.versionMinor, 1);
+  EXPECT_TRUE(request.keepAlive);
+  EXPECT_EQ(request.headersCount, 2);
+  EXPECT_EQ(request.header("host"), "example.com");
+  EXPECT_EQ(request.header("ACCEPT"), "*/*");
+  EXPECT_TRUE(request.header("Content-Length").empty());
+  EXPECT_TRUE(request.body.empty());
+}
+
+TEST(HttpParser, http10IsNotKeepAlive) {
+  RequestParser parser;
+  Request       request;
+  ASSERT_EQ(parser.parse("GET / HTTP/1.0\r\n\r\n", request),
+            ParseStatus::Complete);
+  EXPECT_EQ(request.versionMinor, 0);
+  EXPECT_FALSE(request.keepAlive);
+
+  parser.reset();
+  ASSERT_EQ(parser.parse("GET / HTTP/1.1\r\nConnection: close\r\n\r\n",
+                         request),
+            ParseStatus::Complete);
+  EXPECT_FALSE(request.keepAlive);
+}
+
+TEST(HttpParser, partialInputByBytes) {
+  std::string buffer = "POST /data HTTP/1.1\r\n"
+                       "Content-Length: 5\r\n"
+                       "\r\n"
+                       "hello";
+
+  RequestParser parser;
+  Request       request;
+  for (size_t i = 1; i < buffer.size(); ++i) {
+    ASSERT_EQ(parser.parse(std::string_view{buffer}.substr(0, i), request),
+              ParseStatus::Partial)
+        << i;
+  }
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(request.method, "POST");
+  EXPECT_EQ(request.body, "hello");
+  EXPECT_EQ(parser.size(), buffer.size());
+}
+
+TEST(HttpParser, pipelinedRequests) {
+  std::string_view buffer = "GET /a HTTP/1.1\r\n\r\n"
+                            "POST /b HTTP/1.1\r\nContent-Length: 2\r\n\r\nok"
+                            "GET /c HTTP/1.1\r\n";
+
+  RequestParser parser;
+  Request       request;
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(request.target, "/a");
+
+  buffer.remove_prefix(parser.size());
+  parser.reset();
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(request.target, "/b");
+  EXPECT_EQ(request.body, "ok");
+
+  buffer.remove_prefix(parser.size());
+  parser.reset();
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Partial);
+}
+
+TEST(HttpParser, chunkedBody) {
+  std::string buffer = "POST / HTTP/1.1\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "5;name=value\r\nhello\r\n"
+                       "7\r\n, world\r\n"
+                       "0\r\n"
+                       "Trailer: value\r\n"
+                       "\r\n"
+                       "GET";
+
+  RequestParser parser;
+  Request       request;
+  for (size_t i = 1; i < buffer.size() - 3; ++i) {
+    ASSERT_EQ(parser.parse(std::string_view{buffer}.substr(0, i), request),
+              ParseStatus::Partial)
+        << i;
+  }
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(request.body, "hello, world");
+  EXPECT_EQ(parser.size(), buffer.size() - 3);
+}
+
+TEST(HttpParser, invalidChunks) {
+  const char *requests[] = {
+      // not hex size
+      "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nx\r\n",
+      // chunk is not terminated by CRLF
+      "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n",
+      // overflow of size
+      "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "1ffffffffffffffffffff\r\n",
+  };
+
+  for (std::string_view buffer : requests) {
+    RequestParser parser;
+    Request       request;
+    EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Invalid) << buffer;
+  }
+}
+
+TEST(HttpParser, tooLongChunkLine) {
+  std::string buffer = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                       "1;";
+  buffer.append(ss::http::MAX_CHUNK_LINE_SIZE, 'a');
+
+  RequestParser parser;
+  Request       request;
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Invalid);
+}
+
+TEST(HttpParser, smuggling) {
+  const char *requests[] = {
+      // both Content-Length and Transfer-Encoding
+      "POST / HTTP/1.1\r\n"
+      "Content-Length: 4\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n",
+      "POST / HTTP/1.1\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Content-Length: 4\r\n"
+      "\r\n",
+      // different values of Content-Length
+      "POST / HTTP/1.1\r\n"
+      "Content-Length: 4\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n",
+      // not a number
+      "POST / HTTP/1.1\r\nContent-Length: 4a\r\n\r\n",
+      "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n",
+      "POST / HTTP/1.1\r\nContent-Length: 1, 2\r\n\r\n",
+      // space before colon
+      "POST / HTTP/1.1\r\nContent-Length : 4\r\n\r\n",
+      // obsolete line folding
+      "GET / HTTP/1.1\r\nHost: a\r\n b\r\n\r\n",
+  };
+
+  for (std::string_view buffer : requests) {
+    RequestParser parser;
+    Request       request;
+    EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Invalid) << buffer;
+  }
+}
+
+TEST(HttpParser, sameContentLengthTwice) {
+  RequestParser parser;
+  Request       request;
+  ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\n"
+                         "Content-Length: 2\r\n"
+                         "Content-Length: 2\r\n"
+                         "\r\n"
+                         "ok",
+                         request),
+            ParseStatus::Complete);
+  EXPECT_EQ(request.body, "ok");
+}
+
+TEST(HttpParser, unsupported) {
+  const char *requests[] = {
+      "GET / HTTP/2.0\r\n\r\n",
+      "GET / HTTP/1.2\r\n\r\n",
+      "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+      // chunked must be the last coding
+      "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+  };
+
+  for (std::string_view buffer : requests) {
+    RequestParser parser;
+    Request       request;
+    EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Unsupported)
+        << buffer;
+  }
+}
+
+TEST(HttpParser, invalidRequestLine) {
+  const char *requests[] = {
+      "GET\r\n\r\n",
+      "GET /\r\n\r\n",
+      "GET  HTTP/1.1\r\n\r\n",
+      "G(T / HTTP/1.1\r\n\r\n",
+      "GET / FTP/1.1\r\n\r\n",
+  };
+
+  for (std::string_view buffer : requests) {
+    RequestParser parser;
+    Request       request;
+    EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Invalid) << buffer;
+  }
+}
+
+TEST(HttpParser, tooManyHeaders) {
+  std::string buffer = "GET / HTTP/1.1\r\n";
+  for (size_t i = 0; i <= ss::http::MAX_HEADERS; ++i) {
+    buffer += "X-Header: value\r\n";
+  }
+  buffer += "\r\n";
+
+  RequestParser parser;
+  Request       request;
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Invalid);
+}
+
+TEST(HttpParser, tooLargeHead) {
+  std::string buffer = "GET / HTTP/1.1\r\nX-Header: ";
+  buffer.append(1024, 'a');
+
+  // the head is not completed, but it is already bigger than the limit
+  RequestParser parser{512};
+  Request       request;
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::TooLarge);
+
+  // completed head, which is bigger than the limit
+  buffer += "\r\n\r\n";
+  parser.reset();
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::TooLarge);
+
+  // only the head is limited, not the body
+  std::string body(1024, 'b');
+  buffer = "POST / HTTP/1.1\r\nContent-Length: 1024\r\n\r\n" + body;
+  parser.reset();
+  ASSERT_EQ(parser.parse(buffer, request), ParseStatus::Complete);
+  EXPECT_EQ(request.body, body);
+}
+
+TEST(HttpParser, tooLargeBody) {
+  // declared size is checked before the body is received
+  RequestParser parser{ss::http::MAX_HEAD_SIZE, 1024};
+  Request       request;
+  EXPECT_EQ(parser.parse("POST / HTTP/1.1\r\n"
+                         "Content-Length: 99999999999\r\n"
+                         "\r\n",
+                         request),
+            ParseStatus::TooLarge);
+  EXPECT_TRUE(parser.headParsed());
+
+  // the limit is inclusive
+  std::string body(1024, 'b');
+  parser.reset();
+  ASSERT_EQ(parser.parse("POST / HTTP/1.1\r\nContent-Length: 1024\r\n\r\n" +
+                             body,
+                         request),
+            ParseStatus::Complete);
+  EXPECT_EQ(request.body, body);
+
+  // size of chunk is checked before the chunk is received
+  parser.reset();
+  EXPECT_EQ(parser.parse("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                         "FFFFFFFFFFFFFFFF\r\n",
+                         request),
+            ParseStatus::TooLarge);
+
+  // total size of chunks
+  std::string buffer = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+  buffer += "200\r\n" + std::string(512, 'a') + "\r\n";
+  buffer += "200\r\n" + std::string(512, 'a') + "\r\n";
+  parser.reset();
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::Partial);
+  buffer += "1\r\n";
+  EXPECT_EQ(parser.parse(buffer, request), ParseStatus::TooLarge);
+}
+
+namespace {
+class NullHandler final : public ss::AbstractHttpRequestHandler {
+public:
+  NullHandler() noexcept
+      : AbstractHttpRequestHandler{ss::http::MAX_HEAD_SIZE, 1024} {
+  }
+
+  ss::error_code handleRequest(const Request &,
+                               ss::http::ResponseWriter &response) noexcept
+      override {
+    response.status(200).body();
+    return ss::error_code{};
+  }
+};
+} // namespace
+
+TEST(HttpRequestHandler, tooLargeRequest) {
+  struct Case {
+    std::string      request;
+    std::string_view statusLine;
+  };
+
+  Case cases[] = {
+      {"POST / HTTP/1.1\r\nContent-Length: 1025\r\n\r\n",
+       "HTTP/1.1 413 Payload Too Large\r\n"},
+      {"GET / HTTP/1.1\r\nX-Header: " +
+           std::string(ss::http::MAX_HEAD_SIZE, 'a'),
+       "HTTP/1.1 431 Request Header Fields Too Large\r\n"},
+  };
+
+  for (const Case &test : cases) {
+    NullHandler handler;
+    std::string output;
+    size_t      reqIgnoreLength = 0;
+    ASSERT_FALSE(
+        handler
+            .handle(test.request, std::back_inserter(output), reqIgnoreLength)
+            .failed());
+    EXPECT_EQ(output.find(test.statusLine), 0) << output;
+  }
+}
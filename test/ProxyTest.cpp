@@ -0,0 +1,127 @@
+// ProxyTest.cpp
+
+#include "EchoHandler.hpp"
+#include "ss/Server.hpp"
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+namespace asio = boost::asio;
+
+using Socket = asio::local::stream_protocol::socket;
+
+using ss::test::EchoFactory;
+
+/**\brief write the request and read response of the same size. The client
+ * is blocking, so servers must be run by other thread
+ */
+std::string roundTrip(Socket &client, std::string_view request) {
+  std::thread writer{[&client, request]() {
+    asio::write(client, asio::buffer(request));
+  }};
+
+  std::string response(request.size(), '\0');
+  asio::read(client, asio::buffer(response));
+
+  writer.join();
+  return response;
+}
+
+/**\param copy if true, then bytes are copied instead of splice
+ */
+void checkForwarding(bool copy) {
+  std::string prefix = "/tmp/ss_proxy_test_" + std::to_string(::getpid());
+  std::string upstreamPath = prefix + "_upstream.sock";
+  std::string proxyPath    = prefix + "_proxy.sock";
+  ::unlink(upstreamPath.c_str());
+  ::unlink(proxyPath.c_str());
+
+  asio::io_context ioContext{1};
+
+  ss::ServerPtr upstream =
+      ss::ServerBuilder{ioContext}
+          .setEndpoint(ss::Server::Protocol::Unix, upstreamPath)
+          .setRequestHandlerFactory(std::make_shared<EchoFactory>())
+          .build();
+  upstream->asyncRun();
+
+  ss::ProxyOptions options;
+  options.splice = copy == false;
+
+  ss::ServerPtr proxy =
+      ss::ServerBuilder{ioContext}
+          .setEndpoint(ss::Server::Protocol::Unix, proxyPath)
+          .setProxy(ss::Server::Protocol::Unix, upstreamPath, options)
+          .build();
+  proxy->asyncRun();
+
+  auto        work = asio::make_work_guard(ioContext);
+  std::thread thread{[&ioContext]() {
+    ioContext.run();
+  }};
+
+  asio::io_context clientContext;
+  for (int i = 0; i < 3; ++i) {
+    Socket client{clientContext};
+    client.connect(Socket::endpoint_type{proxyPath});
+
+    std::string request = "request " + std::to_string(i) + "\n";
+    EXPECT_EQ(roundTrip(client, request), request);
+
+    std::string big(256 * 1024, 'b');
+    big.back() = '\n';
+    EXPECT_EQ(roundTrip(client, big), big);
+  }
+
+  // bytes are counted by the server thread after forwarding, so the client
+  // can get them before
+  size_t         forwarded = 3 * 2 * (10 + 256 * 1024);
+  ss::ProxyStats stats     = proxy->proxyStats();
+  for (int i = 0;
+       i < 1000 && stats.splicedBytes + stats.copiedBytes < forwarded;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    stats = proxy->proxyStats();
+  }
+
+  // every session has its own upstream connection
+  EXPECT_EQ(stats.sessions, 3);
+  EXPECT_EQ(stats.upstreamConnects, 3);
+  EXPECT_EQ(stats.upstreamFailures, 0);
+  EXPECT_EQ(stats.splicedBytes + stats.copiedBytes, forwarded);
+  if (copy) {
+    EXPECT_EQ(stats.splicedBytes, 0);
+  }
+
+  proxy->stop();
+  upstream->stop();
+  work.reset();
+  thread.join();
+  ::unlink(upstreamPath.c_str());
+  ::unlink(proxyPath.c_str());
+}
+} // namespace
+
+TEST(Proxy, splice) {
+  checkForwarding(false);
+}
+
+TEST(Proxy, copy) {
+  checkForwarding(true);
+}
+
+TEST(Proxy, protocolsAreRejected) {
+  asio::io_context  ioContext;
+  ss::ServerBuilder builder{ioContext};
+  builder.setEndpoint(ss::Server::Protocol::Unix, "/tmp/ss_proxy_test.sock")
+      .setProxy(ss::Server::Protocol::Unix, "/tmp/ss_proxy_upstream.sock")
+      .addProtocol("GET ", std::make_shared<EchoFactory>());
+
+  EXPECT_THROW(builder.build(), std::invalid_argument);
+}
@@ -0,0 +1,119 @@
+// RateLimiterTest.cpp
+
+#include "RateLimiter.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+constexpr int64_t SECOND = 1000 * 1000 * 1000;
+
+// buckets are compared with steady clock, so synthetic time is far from 0
+constexpr int64_t START = 1000 * SECOND;
+
+ss::RateLimitOptions addressOptions(size_t tableSize) {
+  ss::RateLimitOptions options;
+  options.address.requestsPerSecond = 10;
+  options.address.requestsBurst     = 5;
+  options.addressTableSize          = tableSize;
+  return options;
+}
+} // namespace
+
+TEST(RateLimiter, bucketRate) {
+  ss::BucketRate rate{10, 5};
+  EXPECT_TRUE(rate.enabled());
+  EXPECT_DOUBLE_EQ(rate.interval, SECOND / 10);
+  EXPECT_DOUBLE_EQ(rate.tolerance, 5 * SECOND / 10);
+
+  // default burst is one second of the rate
+  EXPECT_DOUBLE_EQ(ss::BucketRate(10, 0).tolerance, SECOND);
+
+  EXPECT_FALSE(ss::BucketRate(0, 5).enabled());
+}
+
+TEST(RateLimiter, disabledRate) {
+  ss::BucketRate  rate{0, 0};
+  ss::TokenBucket bucket;
+  bucket.consume(rate, 1000, START);
+  EXPECT_EQ(bucket.delay(rate, 1000, START), 0);
+  EXPECT_TRUE(bucket.idle(START));
+}
+
+TEST(RateLimiter, burst) {
+  ss::BucketRate  rate{10, 5};
+  ss::TokenBucket bucket;
+
+  // full bucket allows the burst at once
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(bucket.delay(rate, 1, START), 0) << i;
+    bucket.consume(rate, 1, START);
+  }
+  EXPECT_EQ(bucket.delay(rate, 1, START), SECOND / 10);
+  EXPECT_FALSE(bucket.idle(START));
+
+  // next token after the interval
+  EXPECT_EQ(bucket.delay(rate, 1, START + SECOND / 10), 0);
+  EXPECT_EQ(bucket.delay(rate, 2, START + SECOND / 10), SECOND / 10);
+
+  // after idle period the bucket is full again, but not more
+  int64_t later = START + 10 * SECOND;
+  EXPECT_TRUE(bucket.idle(later));
+  EXPECT_EQ(bucket.delay(rate, 5, later), 0);
+  EXPECT_EQ(bucket.delay(rate, 6, later), SECOND / 10);
+}
+
+TEST(RateLimiter, debt) {
+  ss::BucketRate  rate{10, 5};
+  ss::TokenBucket bucket;
+
+  // one read overdraws the bucket, so the debt delays next tokens
+  bucket.consume(rate, 30, START);
+  EXPECT_EQ(bucket.delay(rate, 1, START), 26 * SECOND / 10);
+
+  int64_t paid = START + 26 * SECOND / 10;
+  EXPECT_EQ(bucket.delay(rate, 1, paid - 1), 1);
+  EXPECT_EQ(bucket.delay(rate, 1, paid), 0);
+  EXPECT_FALSE(bucket.idle(paid));
+  EXPECT_TRUE(bucket.idle(START + 3 * SECOND));
+}
+
+TEST(RateLimiter, addressesOfDifferentSlots) {
+  ss::RateLimiter limiter{addressOptions(4)};
+
+  // both keys begin from the same slot, so second one takes next slot
+  limiter.consumeAddress(1, 10, 0, START);
+  EXPECT_GT(limiter.addressDelay(1, 1, 0, START), 0);
+  EXPECT_EQ(limiter.addressDelay(5, 1, 0, START), 0);
+
+  limiter.consumeAddress(5, 10, 0, START);
+  EXPECT_GT(limiter.addressDelay(5, 1, 0, START), 0);
+
+  // slot of the key is taken by other address, so next slot is used
+  EXPECT_EQ(limiter.addressDelay(2, 1, 0, START), 0);
+}
+
+TEST(RateLimiter, reuseOfIdleSlot) {
+  // single slot
+  ss::RateLimiter limiter{addressOptions(1)};
+
+  limiter.consumeAddress(1, 10, 0, START);
+  int64_t delay = limiter.addressDelay(1, 1, 0, START);
+  EXPECT_GT(delay, 0);
+
+  // the slot is busy, so other address shares it
+  EXPECT_EQ(limiter.addressDelay(2, 1, 0, START), delay);
+
+  // the slot is idle, so it is taken by other address
+  int64_t later = START + 10 * SECOND;
+  EXPECT_EQ(limiter.addressDelay(2, 1, 0, later), 0);
+  limiter.consumeAddress(2, 10, 0, later);
+  EXPECT_EQ(limiter.addressDelay(2, 1, 0, later), delay);
+  EXPECT_EQ(limiter.addressDelay(1, 1, 0, later), delay);
+}
+
+TEST(RateLimiter, invalidOptions) {
+  ss::RateLimitOptions options;
+  options.session.bytesPerSecond = -1;
+  EXPECT_THROW(ss::RateLimiter{options}, std::invalid_argument);
+
+  EXPECT_THROW(ss::RateLimiter{addressOptions(0)}, std::invalid_argument);
+}
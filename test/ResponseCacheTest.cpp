@@ -0,0 +1,161 @@
+// ResponseCacheTest.cpp
+
+#include "ResponseCache.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+namespace {
+// size of request and response, so every entry takes 256 bytes with the
+// overhead
+constexpr size_t REQUEST_SIZE  = 2;
+constexpr size_t RESPONSE_SIZE = 126;
+constexpr size_t ENTRY_SIZE    = 256;
+
+ss::SharedBuffer makeResponse(char c, size_t size = RESPONSE_SIZE) {
+  return std::make_shared<const std::string>(size, c);
+}
+
+/**\return cache with single shard for the count of entries
+ */
+ss::ResponseCache makeCache(size_t                    entries,
+                            std::chrono::milliseconds ttl = {}) {
+  ss::ResponseCacheOptions options;
+  options.maxBytes = entries * ENTRY_SIZE;
+  options.shards   = 1;
+  options.ttl      = ttl;
+  return ss::ResponseCache{options};
+}
+
+std::string request(char c) {
+  return std::string(REQUEST_SIZE, c);
+}
+} // namespace
+
+TEST(ResponseCache, findInserted) {
+  ss::ResponseCache cache = makeCache(4);
+  EXPECT_EQ(cache.find(request('a')), nullptr);
+
+  ss::SharedBuffer response = makeResponse('a');
+  cache.insert(request('a'), response);
+  EXPECT_EQ(cache.find(request('a')), response);
+
+  ss::ResponseCacheStats stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.inserts, 1);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.bytes, ENTRY_SIZE);
+}
+
+TEST(ResponseCache, secondChance) {
+  ss::ResponseCache cache = makeCache(3);
+  for (char c : {'a', 'b', 'c'}) {
+    cache.insert(request(c), makeResponse(c));
+  }
+
+  // referenced entry is moved to the tail, so next one is evicted
+  ASSERT_NE(cache.find(request('a')), nullptr);
+  cache.insert(request('d'), makeResponse('d'));
+  EXPECT_EQ(cache.find(request('b')), nullptr);
+  EXPECT_EQ(cache.stats().evictions, 1);
+  EXPECT_EQ(cache.stats().entries, 3);
+
+  cache.insert(request('e'), makeResponse('e'));
+  EXPECT_EQ(cache.find(request('c')), nullptr);
+
+  // the bit is cleared by previous pass, so the entry is evicted now
+  cache.insert(request('f'), makeResponse('f'));
+  EXPECT_EQ(cache.find(request('a')), nullptr);
+
+  for (char c : {'d', 'e', 'f'}) {
+    EXPECT_NE(cache.find(request(c)), nullptr) << c;
+  }
+  EXPECT_EQ(cache.stats().evictions, 3);
+  EXPECT_EQ(cache.stats().bytes, 3 * ENTRY_SIZE);
+}
+
+TEST(ResponseCache, ttl) {
+  ss::ResponseCache cache = makeCache(3, std::chrono::milliseconds{20});
+  cache.insert(request('a'), makeResponse('a'));
+  ASSERT_NE(cache.find(request('a')), nullptr);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{40});
+  EXPECT_EQ(cache.find(request('a')), nullptr);
+
+  // expired entry is evicted, though it is referenced
+  cache.insert(request('b'), makeResponse('b'));
+  cache.insert(request('c'), makeResponse('c'));
+  cache.insert(request('d'), makeResponse('d'));
+  EXPECT_EQ(cache.stats().evictions, 1);
+  EXPECT_NE(cache.find(request('b')), nullptr);
+}
+
+TEST(ResponseCache, replace) {
+  ss::ResponseCache cache = makeCache(3);
+
+  ss::SharedBuffer                 first    = makeResponse('1');
+  std::weak_ptr<const std::string> released = first;
+  cache.insert(request('a'), std::move(first));
+  cache.insert(request('b'), makeResponse('b'));
+
+  // replaced response is released at once, but the entry stays in the queue
+  // until compaction
+  ss::SharedBuffer last;
+  for (char c = '2'; c <= '9'; ++c) {
+    last = makeResponse(c);
+    cache.insert(request('a'), last);
+  }
+  EXPECT_TRUE(released.expired());
+  EXPECT_EQ(cache.find(request('a')), last);
+
+  ss::ResponseCacheStats stats = cache.stats();
+  EXPECT_EQ(stats.entries, 2);
+  EXPECT_EQ(stats.bytes, 2 * ENTRY_SIZE);
+  EXPECT_EQ(stats.evictions, 0);
+
+  // replaced entries doesn't take the budget
+  cache.insert(request('c'), makeResponse('c'));
+  EXPECT_EQ(cache.stats().evictions, 0);
+  EXPECT_EQ(cache.stats().entries, 3);
+
+  cache.insert(request('d'), makeResponse('d'));
+  stats = cache.stats();
+  EXPECT_EQ(stats.evictions, 1);
+  EXPECT_EQ(stats.entries, 3);
+  EXPECT_EQ(stats.bytes, 3 * ENTRY_SIZE);
+}
+
+TEST(ResponseCache, shardBudget) {
+  ss::ResponseCacheOptions options;
+  options.maxBytes = 4 * ENTRY_SIZE;
+  options.shards   = 4;
+  ss::ResponseCache cache{options};
+
+  // bigger than budget of one shard
+  cache.insert(request('a'), makeResponse('a', RESPONSE_SIZE + 1));
+  EXPECT_EQ(cache.find(request('a')), nullptr);
+  EXPECT_EQ(cache.stats().inserts, 0);
+
+  // every shard keeps only one entry
+  for (char c = 'a'; c <= 'z'; ++c) {
+    cache.insert(request(c), makeResponse(c));
+  }
+
+  ss::ResponseCacheStats stats = cache.stats();
+  EXPECT_EQ(stats.inserts, 26);
+  EXPECT_LE(stats.entries, 4);
+  EXPECT_GE(stats.entries, 1);
+  EXPECT_EQ(stats.bytes, stats.entries * ENTRY_SIZE);
+  EXPECT_EQ(stats.evictions, stats.inserts - stats.entries);
+}
+
+TEST(ResponseCache, invalidOptions) {
+  ss::ResponseCacheOptions options;
+  options.shards = 0;
+  EXPECT_THROW(ss::ResponseCache{options}, std::invalid_argument);
+
+  options.shards   = 16;
+  options.maxBytes = 8;
+  EXPECT_THROW(ss::ResponseCache{options}, std::invalid_argument);
+}
@@ -0,0 +1,100 @@
+// ServerTest.cpp
+
+#include "ss/Server.hpp"
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+namespace asio = boost::asio;
+
+using Socket = asio::local::stream_protocol::socket;
+
+/**\brief calls the server from atSessionStart and echoes lines
+ */
+class StatsHandler final : public ss::AbstractRequestHandler {
+public:
+  explicit StatsHandler(std::atomic<ss::Server *> &server) noexcept
+      : server_{server} {
+  }
+
+  ss::error_code atSessionStart(std::string_view) noexcept override {
+    sessions_ = server_.load()->threadPoolStats().sessions.size();
+    return ss::error_code{};
+  }
+
+  ss::error_code handle(std::string_view request,
+                        ResponseInserter respInserter,
+                        size_t &         reqIgnoreLength) noexcept override {
+    size_t end = request.find('\n');
+    if (end == std::string_view::npos) {
+      return ss::error::make_error_code(ss::error::SessionError::PartialData);
+    }
+
+    std::string response = std::to_string(sessions_) + "\n";
+    std::copy(response.begin(), response.end(), respInserter);
+    reqIgnoreLength = end + 1;
+    return ss::error_code{};
+  }
+
+private:
+  std::atomic<ss::Server *> &server_;
+  size_t                     sessions_ = 0;
+};
+
+class StatsFactory final : public ss::AbstractRequestHandlerFactory {
+public:
+  ss::RequestHandler makeRequestHandler() noexcept override {
+    return std::make_shared<StatsHandler>(server);
+  }
+
+  std::atomic<ss::Server *> server{nullptr};
+};
+} // namespace
+
+TEST(Server, callFromAtSessionStart) {
+  std::string path =
+      "/tmp/ss_server_test_" + std::to_string(::getpid()) + ".sock";
+  ::unlink(path.c_str());
+
+  ss::ThreadPoolOptions options;
+  options.ioThreads = 2;
+
+  asio::io_context ioContext{1};
+  auto             factory = std::make_shared<StatsFactory>();
+
+  ss::ServerPtr server = ss::ServerBuilder{ioContext}
+                             .setEndpoint(ss::Server::Protocol::Unix, path)
+                             .setRequestHandlerFactory(factory)
+                             .setThreadPool(options)
+                             .build();
+  factory->server = server.get();
+  server->asyncRun();
+
+  auto        work = asio::make_work_guard(ioContext);
+  std::thread thread{[&ioContext]() {
+    ioContext.run();
+  }};
+
+  // the session is started by the acceptor thread, which must not hold the
+  // lock of sessions at the moment
+  asio::io_context clientContext;
+  Socket           client{clientContext};
+  client.connect(Socket::endpoint_type{path});
+  asio::write(client, asio::buffer(std::string_view{"stats\n"}));
+
+  std::string response(2, '\0');
+  asio::read(client, asio::buffer(response));
+  EXPECT_EQ(response, "2\n");
+
+  server->stop();
+  work.reset();
+  thread.join();
+  ::unlink(path.c_str());
+}
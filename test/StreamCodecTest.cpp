@@ -0,0 +1,178 @@
+// StreamCodecTest.cpp
+
+#include "StreamCodec.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <zlib.h>
+
+namespace {
+void append(ss::RequestBuffer &buffer, std::string_view data) {
+  while (data.empty() == false) {
+    boost::asio::mutable_buffer space = buffer.prepare();
+    size_t                      size  = std::min(space.size(), data.size());
+    std::memcpy(space.data(), data.data(), size);
+    buffer.commit(size);
+    data.remove_prefix(size);
+  }
+}
+
+/**\return finished zlib stream, as produced by a client, which closes it
+ */
+std::string compressFinished(std::string_view data) {
+  std::string output(compressBound(data.size()), '\0');
+  uLongf      size = output.size();
+  compress2(reinterpret_cast<Bytef *>(output.data()),
+            &size,
+            reinterpret_cast<const Bytef *>(data.data()),
+            data.size(),
+            Z_DEFAULT_COMPRESSION);
+  output.resize(size);
+  return output;
+}
+
+std::string makeText(size_t size) {
+  std::string text;
+  for (size_t i = 0; text.size() < size; ++i) {
+    text += R"({"id":)" + std::to_string(i) + R"(,"name":"item"})";
+  }
+  return text;
+}
+
+ss::StreamCodec makeCodec(std::string dictionary = std::string{}) {
+  ss::CompressionOptions options;
+  options.dictionary = std::move(dictionary);
+  return ss::StreamCodec{std::make_shared<ss::CompressionContext>(options)};
+}
+
+/**\brief decompress whole input by small output buffer, as the session does
+ * \return decompressed data
+ */
+std::string decompressAll(ss::StreamCodec &  codec,
+                          ss::RequestBuffer &input,
+                          ss::error_code &   err) {
+  ss::RequestBuffer output{1024};
+  std::string       retval;
+  do {
+    err = codec.decompress(input, output);
+    if (err.failed()) {
+      break;
+    }
+
+    retval += output.data();
+    output.clear();
+  } while (input.empty() == false || codec.hasPendingOutput());
+  return retval;
+}
+} // namespace
+
+TEST(StreamCodec, roundTripByFullOutput) {
+  std::string text = makeText(64 * 1024);
+
+  ss::StreamCodec client = makeCodec();
+  std::string     compressed;
+  client.compress(text.substr(0, 1000), compressed, false);
+  client.compress(text.substr(1000), compressed, true);
+
+  ss::StreamCodec   server = makeCodec();
+  ss::RequestBuffer input;
+  append(input, compressed);
+
+  // output is much smaller than decompressed data, so decompression stops
+  // with pending output, which is returned without new input
+  ss::RequestBuffer output{1024};
+  ASSERT_FALSE(server.decompress(input, output).failed());
+  EXPECT_TRUE(output.full());
+  EXPECT_TRUE(server.hasPendingOutput());
+
+  std::string decompressed{output.data()};
+  output.clear();
+
+  ss::error_code err;
+  decompressed += decompressAll(server, input, err);
+  ASSERT_FALSE(err.failed()) << err.message();
+  EXPECT_EQ(decompressed, text);
+  EXPECT_FALSE(server.hasPendingOutput());
+}
+
+TEST(StreamCodec, byteByByte) {
+  std::string text = makeText(4 * 1024);
+
+  ss::StreamCodec client = makeCodec();
+  std::string     compressed;
+  client.compress(text, compressed, true);
+
+  ss::StreamCodec   server = makeCodec();
+  ss::RequestBuffer input;
+  std::string       decompressed;
+  for (char c : compressed) {
+    append(input, std::string_view{&c, 1});
+
+    ss::error_code err;
+    decompressed += decompressAll(server, input, err);
+    ASSERT_FALSE(err.failed()) << err.message();
+  }
+  EXPECT_EQ(decompressed, text);
+}
+
+TEST(StreamCodec, dictionary) {
+  std::string dictionary = R"({"id":,"name":"item"})";
+  std::string text       = makeText(1024);
+
+  ss::StreamCodec client = makeCodec(dictionary);
+  std::string     compressed;
+  client.compress(text, compressed, true);
+
+  // Z_NEED_DICT is handled by the dictionary of options
+  ss::StreamCodec   server = makeCodec(dictionary);
+  ss::RequestBuffer input;
+  append(input, compressed);
+
+  ss::error_code err;
+  EXPECT_EQ(decompressAll(server, input, err), text);
+  EXPECT_FALSE(err.failed()) << err.message();
+
+  // server without the dictionary
+  ss::StreamCodec withoutDictionary = makeCodec();
+  input.clear();
+  append(input, compressed);
+  decompressAll(withoutDictionary, input, err);
+  EXPECT_EQ(err,
+            ss::error::make_error_code(ss::error::SessionError::CorruptedData));
+}
+
+TEST(StreamCodec, nextStreamAfterEnd) {
+  ss::StreamCodec   server = makeCodec();
+  ss::RequestBuffer input;
+  append(input, compressFinished("first stream\n"));
+  append(input, compressFinished("second stream\n"));
+
+  ss::error_code err;
+  EXPECT_EQ(decompressAll(server, input, err), "first stream\nsecond stream\n");
+  EXPECT_FALSE(err.failed()) << err.message();
+}
+
+TEST(StreamCodec, corruptedData) {
+  ss::StreamCodec   server = makeCodec();
+  ss::RequestBuffer input;
+  // invalid header of zlib stream
+  append(input, std::string(16, '\0'));
+
+  ss::error_code err;
+  decompressAll(server, input, err);
+  EXPECT_EQ(err,
+            ss::error::make_error_code(ss::error::SessionError::CorruptedData));
+
+  // valid header, but invalid type of deflate block
+  ss::StreamCodec client = makeCodec();
+  std::string     compressed;
+  client.compress("text", compressed, true);
+  compressed[2] = '\xff';
+
+  ss::StreamCodec next = makeCodec();
+  input.clear();
+  append(input, compressed);
+  decompressAll(next, input, err);
+  EXPECT_EQ(err,
+            ss::error::make_error_code(ss::error::SessionError::CorruptedData));
+}
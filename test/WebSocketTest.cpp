@@ -0,0 +1,277 @@
+// WebSocketTest.cpp
+
+#include "ss/WebSocketHandler.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::string_view HANDSHAKE = "GET /chat HTTP/1.1\r\n"
+                                       "Host: server.example.com\r\n"
+                                       "Upgrade: websocket\r\n"
+                                       "Connection: Upgrade\r\n"
+                                       "Sec-WebSocket-Key: "
+                                       "dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                                       "Sec-WebSocket-Version: 13\r\n"
+                                       "\r\n";
+
+constexpr char MASK[4] = {0x37, char(0xfa), 0x21, 0x3d};
+
+/**\return masked client frame
+ */
+std::string maskedFrame(uint8_t first, std::string_view payload) {
+  std::string frame;
+  frame.push_back(static_cast<char>(first));
+  if (payload.size() < 126) {
+    frame.push_back(static_cast<char>(0x80 | payload.size()));
+  } else if (payload.size() <= UINT16_MAX) {
+    frame.push_back(static_cast<char>(0x80 | 126));
+    frame.push_back(static_cast<char>(payload.size() >> 8));
+    frame.push_back(static_cast<char>(payload.size()));
+  } else {
+    frame.push_back(static_cast<char>(0x80 | 127));
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      frame.push_back(static_cast<char>(uint64_t{payload.size()} >> shift));
+    }
+  }
+
+  frame.append(MASK, sizeof(MASK));
+  for (size_t i = 0; i < payload.size(); ++i) {
+    frame.push_back(payload[i] ^ MASK[i % 4]);
+  }
+  return frame;
+}
+
+std::string closePayload(uint16_t code) {
+  return std::string{static_cast<char>(code >> 8), static_cast<char>(code)};
+}
+
+class EchoHandler final : public ss::AbstractWebSocketHandler {
+public:
+  EchoHandler() noexcept {
+    this->setMaxMessageSize(1024 * 1024);
+  }
+
+  ss::error_code handleMessage(ss::ws::Opcode   opcode,
+                               std::string_view message) noexcept override {
+    messages.emplace_back(message);
+    this->send(opcode, message);
+    return ss::error_code{};
+  }
+
+  std::vector<std::string> messages;
+};
+
+/**\brief passes data to the handler as the session does
+ */
+class WebSocketTest : public ::testing::Test {
+protected:
+  /**\brief start new session
+   */
+  void reset() {
+    handler_ = std::make_unique<EchoHandler>();
+    buffer_.clear();
+    output_.clear();
+  }
+
+  /**\return error of the handler
+   */
+  ss::error_code feed(std::string_view data) {
+    buffer_.append(data);
+
+    size_t         reqIgnoreLength = 0;
+    ss::error_code err             = handler_->handle(buffer_,
+                                          std::back_inserter(output_),
+                                          reqIgnoreLength);
+    if (err.failed() &&
+        err != ss::error::make_error_code(
+                   ss::error::SessionError::PartialData)) {
+      return err;
+    }
+
+    if (err.failed() == false && reqIgnoreLength == 0) {
+      buffer_.clear();
+    } else {
+      buffer_.erase(0, reqIgnoreLength);
+    }
+    return ss::error_code{};
+  }
+
+  void handshake() {
+    ASSERT_FALSE(this->feed(HANDSHAKE).failed());
+    ASSERT_EQ(output_.find("HTTP/1.1 101 Switching Protocols\r\n"), 0);
+    output_.clear();
+  }
+
+  /**\return close frame, which the server must send for the code
+   */
+  static std::string serverClose(uint16_t code) {
+    return ss::ws::makeFrame(ss::ws::Opcode::Close, closePayload(code));
+  }
+
+protected:
+  std::unique_ptr<EchoHandler> handler_ = std::make_unique<EchoHandler>();
+  std::string                  buffer_;
+  std::string                  output_;
+};
+} // namespace
+
+TEST(WebSocket, acceptKey) {
+  // example from RFC 6455 1.3
+  EXPECT_EQ(ss::ws::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="),
+            "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocket, unmask) {
+  std::string src;
+  for (size_t i = 0; i < 300; ++i) {
+    src.push_back(static_cast<char>(i * 7));
+  }
+
+  // sizes and offsets around widths of simd registers
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t size = 0; size + offset <= src.size(); ++size) {
+      std::string dst(size, '\0');
+      ss::ws::unmask(dst.data(), src.data() + offset, size, MASK);
+      for (size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(dst[i], static_cast<char>(src[offset + i] ^ MASK[i % 4]))
+            << "offset " << offset << ", size " << size << ", index " << i;
+      }
+    }
+  }
+}
+
+TEST(WebSocket, isValidCloseCode) {
+  for (uint16_t code : {1000, 1001, 1002, 1003, 1007, 1011, 3000, 4999}) {
+    EXPECT_TRUE(ss::ws::isValidCloseCode(code)) << code;
+  }
+  for (uint16_t code : {0, 999, 1004, 1005, 1006, 1015, 1016, 2999, 5000}) {
+    EXPECT_FALSE(ss::ws::isValidCloseCode(code)) << code;
+  }
+}
+
+TEST_F(WebSocketTest, maskedTextFrame) {
+  this->handshake();
+
+  // single-frame masked text message from RFC 6455 5.7
+  const char frame[] =
+      "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+  ASSERT_FALSE(this->feed(std::string_view{frame, sizeof(frame) - 1}).failed());
+  ASSERT_EQ(handler_->messages.size(), 1);
+  EXPECT_EQ(handler_->messages[0], "Hello");
+  EXPECT_EQ(output_, ss::ws::makeFrame(ss::ws::Opcode::Text, "Hello"));
+  EXPECT_TRUE(buffer_.empty());
+}
+
+TEST_F(WebSocketTest, framesByBytes) {
+  this->handshake();
+
+  std::string big(70000, 'x');
+  for (size_t i = 0; i < big.size(); ++i) {
+    big[i] = static_cast<char>('a' + i % 26);
+  }
+
+  std::string data = maskedFrame(0x81, "first") + maskedFrame(0x82, big) +
+                     maskedFrame(0x81, std::string(300, 'y'));
+  for (char c : data) {
+    ASSERT_FALSE(this->feed(std::string_view{&c, 1}).failed());
+  }
+
+  ASSERT_EQ(handler_->messages.size(), 3);
+  EXPECT_EQ(handler_->messages[0], "first");
+  EXPECT_EQ(handler_->messages[1], big);
+  EXPECT_EQ(handler_->messages[2], std::string(300, 'y'));
+  EXPECT_TRUE(buffer_.empty());
+}
+
+TEST_F(WebSocketTest, fragmentedMessageWithPing) {
+  this->handshake();
+
+  std::string data = maskedFrame(0x01, "Hel") + maskedFrame(0x89, "ping") +
+                     maskedFrame(0x80, "lo");
+  ASSERT_FALSE(this->feed(data).failed());
+  ASSERT_EQ(handler_->messages.size(), 1);
+  EXPECT_EQ(handler_->messages[0], "Hello");
+  EXPECT_EQ(output_,
+            ss::ws::makeFrame(ss::ws::Opcode::Pong, "ping") +
+                ss::ws::makeFrame(ss::ws::Opcode::Text, "Hello"));
+}
+
+TEST_F(WebSocketTest, notMaskedFrame) {
+  this->handshake();
+
+  ASSERT_FALSE(this->feed("\x81\x05Hello").failed());
+  EXPECT_TRUE(handler_->messages.empty());
+  EXPECT_EQ(output_, serverClose(ss::ws::CloseCode::ProtocolError));
+}
+
+TEST_F(WebSocketTest, invalidFrames) {
+  std::string frames[] = {
+      // reserved bits without extensions
+      maskedFrame(0xc1, "Hello"),
+      // unknown opcode
+      maskedFrame(0x83, "Hello"),
+      // continuation without first fragment
+      maskedFrame(0x80, "Hello"),
+      // fragmented control frame
+      maskedFrame(0x09, "ping"),
+      // too big control frame
+      maskedFrame(0x89, std::string(126, 'p')),
+  };
+
+  for (const std::string &frame : frames) {
+    this->reset();
+    this->handshake();
+
+    ASSERT_FALSE(this->feed(frame).failed());
+    EXPECT_TRUE(handler_->messages.empty());
+    EXPECT_EQ(output_, serverClose(ss::ws::CloseCode::ProtocolError));
+  }
+}
+
+TEST_F(WebSocketTest, tooBigMessage) {
+  this->handshake();
+
+  std::string data = maskedFrame(0x02, std::string(1024 * 1024, 'a')) +
+                     maskedFrame(0x80, "b");
+  ASSERT_FALSE(this->feed(data).failed());
+  EXPECT_TRUE(handler_->messages.empty());
+  EXPECT_EQ(output_, serverClose(ss::ws::CloseCode::MessageTooBig));
+}
+
+TEST_F(WebSocketTest, closeCodes) {
+  struct Case {
+    std::string payload;
+    uint16_t    expected;
+  };
+
+  Case cases[] = {
+      {"", ss::ws::CloseCode::Normal},
+      {closePayload(1000), 1000},
+      {closePayload(1001) + "bye", 1001},
+      {closePayload(4000), 4000},
+      {"\x03", ss::ws::CloseCode::ProtocolError},
+      // codes, which must not be sent on the wire
+      {closePayload(1005), ss::ws::CloseCode::ProtocolError},
+      {closePayload(1006), ss::ws::CloseCode::ProtocolError},
+      {closePayload(1015), ss::ws::CloseCode::ProtocolError},
+      {closePayload(999), ss::ws::CloseCode::ProtocolError},
+      {closePayload(2000), ss::ws::CloseCode::ProtocolError},
+      {closePayload(5000), ss::ws::CloseCode::ProtocolError},
+  };
+
+  for (const Case &test : cases) {
+    this->reset();
+    this->handshake();
+
+    ASSERT_FALSE(this->feed(maskedFrame(0x88, test.payload)).failed());
+    EXPECT_EQ(output_, serverClose(test.expected)) << test.expected;
+
+    // nothing is handled after close
+    output_.clear();
+    ASSERT_FALSE(this->feed(maskedFrame(0x81, "Hello")).failed());
+    EXPECT_TRUE(output_.empty());
+    EXPECT_TRUE(handler_->messages.empty());
+  }
+}
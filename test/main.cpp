@@ -87,10 +87,14 @@ int main(int argc, char *argv[]) {
   }
 
 
+  ss::ThreadPoolOptions threadPoolOptions;
+  threadPoolOptions.ioThreads = 3;
+
   ss::ServerBuilder builder{ioContext};
   ss::ServerPtr     server =
       builder.setEndpoint(proto, endpoint)
           .setRequestHandlerFactory(std::make_shared<EchoReqHandlerFactory>())
+          .setThreadPool(threadPoolOptions)
           .build();
 
   server->asyncRun();
@@ -116,19 +120,9 @@ int main(int argc, char *argv[]) {
   });
 
 
-  std::list<std::thread> threadPool;
-  for (int i = 0; i < 3; ++i) {
-    threadPool.emplace_back([&ioContext]() {
-      ioContext.run();
-    });
-  }
-
+  // sessions are run by threads of the server, so here only accepting
   ioContext.run();
 
-  for (std::thread &th : threadPool) {
-    th.join();
-  }
-
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,343 @@
+// replay.cpp
+/**\file
+ * ss_replay: replays traffic, captured by ServerBuilder::setCapture, to any
+ * server. Every captured connection is opened, sends its chunks and is closed
+ * at the same time (relative to start of the capture) as in original, so
+ * concurrency of connections is the same. With speed factor the timing is
+ * scaled, and with speed 0 every connection sends its chunks as fast as
+ * possible.
+ *
+ * Latency of a chunk is time since it was sent until first bytes received
+ * after that. So for request/response protocols it is latency of the
+ * response.
+ *
+ * usage: ss_replay <capture file> <endpoint> [tcp|unix] [speed]
+ */
+
+#include "CaptureFormat.hpp"
+#include <algorithm>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <regex>
+#include <simple_logs/logs.hpp>
+#include <vector>
+
+namespace asio   = boost::asio;
+using error_code = boost::system::error_code;
+using Clock      = std::chrono::steady_clock;
+
+
+struct CapturedChunk {
+  std::chrono::microseconds time;
+  std::string               data;
+};
+
+struct CapturedConnection {
+  std::chrono::microseconds  openTime{0};
+  std::chrono::microseconds  closeTime{0};
+  std::vector<CapturedChunk> chunks;
+};
+
+struct ReplayStats {
+  size_t connections   = 0;
+  size_t failed        = 0;
+  size_t chunksSent    = 0;
+  size_t bytesSent     = 0;
+  size_t bytesReceived = 0;
+
+  std::vector<std::chrono::microseconds> latencies;
+};
+
+
+std::vector<CapturedConnection> loadCapture(const std::string &path) {
+  std::ifstream file{path, std::ios::binary};
+  if (file.is_open() == false) {
+    LOG_THROW(std::runtime_error, "can not open capture file: %1%", path);
+  }
+
+  std::string magic(ss::capture::CAPTURE_MAGIC.size(), '\0');
+  file.read(magic.data(), magic.size());
+  if (magic != ss::capture::CAPTURE_MAGIC) {
+    LOG_THROW(std::runtime_error, "invalid capture file: %1%", path);
+  }
+
+  std::map<uint32_t, CapturedConnection> connections;
+  ss::capture::Record                    record;
+  while (ss::capture::readRecord(file, record)) {
+    CapturedConnection &connection = connections[record.connection];
+    std::chrono::microseconds time{record.time};
+
+    switch (record.type) {
+    case ss::capture::RecordType::Open:
+      connection.openTime  = time;
+      connection.closeTime = time;
+      break;
+    case ss::capture::RecordType::Data:
+      connection.chunks.emplace_back(
+          CapturedChunk{time, std::move(record.data)});
+      connection.closeTime = time;
+      break;
+    case ss::capture::RecordType::Close:
+      connection.closeTime = time;
+      break;
+    }
+  }
+
+  if (file.eof() == false) {
+    LOG_WARNING("capture file is broken, replay only readed part");
+  }
+
+  std::vector<CapturedConnection> retval;
+  retval.reserve(connections.size());
+  for (auto &[id, connection] : connections) {
+    retval.emplace_back(std::move(connection));
+  }
+  return retval;
+}
+
+
+template <typename Protocol>
+class ReplayConnection
+    : public std::enable_shared_from_this<ReplayConnection<Protocol>> {
+public:
+  using Endpoint = typename Protocol::endpoint;
+  using Socket   = typename Protocol::socket;
+
+  ReplayConnection(asio::io_context &        ioContext,
+                   const CapturedConnection &captured,
+                   Endpoint                  endpoint,
+                   Clock::time_point         start,
+                   double                    speed,
+                   ReplayStats &             stats)
+      : socket_{ioContext}
+      , timer_{ioContext}
+      , captured_{captured}
+      , endpoint_{std::move(endpoint)}
+      , start_{start}
+      , speed_{speed}
+      , stats_{stats} {
+  }
+
+  void run() {
+    this->waitFor(captured_.openTime, [this](auto self) {
+      socket_.async_connect(endpoint_, [this, self](error_code err) {
+        if (err.failed()) {
+          LOG_ERROR("can not connect: %1%", err.message());
+          ++stats_.failed;
+          return;
+        }
+
+        ++stats_.connections;
+        this->read(self);
+        this->sendNext();
+      });
+    });
+  }
+
+private:
+  /**\brief call the function at the time since start of replay, scaled by
+   * speed
+   */
+  template <typename Function>
+  void waitFor(std::chrono::microseconds time, Function function) {
+    auto self = this->shared_from_this();
+
+    Clock::time_point at = start_;
+    if (speed_ != 0) {
+      at += std::chrono::duration_cast<Clock::duration>(time / speed_);
+    }
+
+    timer_.expires_at(at);
+    timer_.async_wait([self, function](error_code err) {
+      if (err.failed()) {
+        return;
+      }
+      function(self);
+    });
+  }
+
+  void sendNext() {
+    if (next_ == captured_.chunks.size()) {
+      this->waitFor(captured_.closeTime, [this](auto) {
+        error_code err;
+        socket_.shutdown(Socket::shutdown_send, err);
+      });
+      return;
+    }
+
+    this->waitFor(captured_.chunks[next_].time, [this](auto self) {
+      const std::string &data = captured_.chunks[next_].data;
+      sent_.emplace_back(Clock::now());
+
+      asio::async_write(socket_,
+                        asio::buffer(data),
+                        [this, self](error_code err, size_t transfered) {
+                          if (err.failed()) {
+                            LOG_ERROR("can not send: %1%", err.message());
+                            socket_.close(err);
+                            return;
+                          }
+
+                          ++stats_.chunksSent;
+                          stats_.bytesSent += transfered;
+                          ++next_;
+                          this->sendNext();
+                        });
+    });
+  }
+
+  template <typename Self>
+  void read(Self self) {
+    socket_.async_read_some(
+        asio::buffer(readBuffer_),
+        [this, self](error_code err, size_t transfered) {
+          if (err.failed()) {
+            if (err != asio::error::eof &&
+                err != asio::error::operation_aborted) {
+              LOG_ERROR("can not read: %1%", err.message());
+            }
+            timer_.cancel();
+            return;
+          }
+
+          Clock::time_point now = Clock::now();
+          for (Clock::time_point sent : sent_) {
+            stats_.latencies.emplace_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                      sent));
+          }
+          sent_.clear();
+
+          stats_.bytesReceived += transfered;
+          this->read(self);
+        });
+  }
+
+private:
+  Socket                    socket_;
+  asio::steady_timer        timer_;
+  const CapturedConnection &captured_;
+  Endpoint                  endpoint_;
+  Clock::time_point         start_;
+  double                    speed_;
+  ReplayStats &             stats_;
+
+  size_t                        next_ = 0;
+  std::deque<Clock::time_point> sent_;
+  char                          readBuffer_[1024 * 64];
+};
+
+
+template <typename Protocol>
+void replay(const std::vector<CapturedConnection> &captured,
+            typename Protocol::endpoint             endpoint,
+            double                                  speed,
+            ReplayStats &                           stats) {
+  asio::io_context  ioContext;
+  Clock::time_point start = Clock::now();
+
+  for (const CapturedConnection &connection : captured) {
+    std::make_shared<ReplayConnection<Protocol>>(ioContext,
+                                                 connection,
+                                                 endpoint,
+                                                 start,
+                                                 speed,
+                                                 stats)
+        ->run();
+  }
+
+  ioContext.run();
+}
+
+void printStats(ReplayStats &stats, std::chrono::microseconds duration) {
+  double seconds = duration.count() / 1000000.;
+
+  std::cout << "connections:   " << stats.connections << " (failed "
+            << stats.failed << ")" << std::endl;
+  std::cout << "duration:      " << seconds << "s" << std::endl;
+  std::cout << "chunks sent:   " << stats.chunksSent << " ("
+            << stats.chunksSent / seconds << "/s)" << std::endl;
+  std::cout << "bytes sent:    " << stats.bytesSent << " ("
+            << stats.bytesSent / seconds / 1024 / 1024 << "Mb/s)" << std::endl;
+  std::cout << "bytes received:" << stats.bytesReceived << " ("
+            << stats.bytesReceived / seconds / 1024 / 1024 << "Mb/s)"
+            << std::endl;
+
+  if (stats.latencies.empty()) {
+    return;
+  }
+
+  std::sort(stats.latencies.begin(), stats.latencies.end());
+  auto percentile = [&stats](double p) {
+    size_t index = static_cast<size_t>(p * (stats.latencies.size() - 1));
+    return stats.latencies[index].count();
+  };
+
+  std::cout << "latency (us):  p50 " << percentile(0.5) << ", p90 "
+            << percentile(0.9) << ", p99 " << percentile(0.99) << ", max "
+            << stats.latencies.back().count() << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  auto back  = std::make_shared<logs::TextStreamBackend>(std::cerr);
+  auto front = std::make_shared<logs::LightFrontend>();
+  LOGGER_ADD_SINK(front, back);
+
+  if (argc < 3) {
+    LOG_FAILURE("usage: ss_replay <capture file> <endpoint> [tcp|unix] "
+                "[speed]");
+  }
+
+  std::string capturePath = argv[1];
+  std::string endpoint    = argv[2];
+  std::string protocol    = argc >= 4 ? argv[3] : "tcp";
+  double      speed       = argc >= 5 ? std::stod(argv[4]) : 1;
+  if (speed < 0) {
+    LOG_FAILURE("invalid speed: %1%", speed);
+  }
+
+
+  std::vector<CapturedConnection> captured = loadCapture(capturePath);
+  LOG_INFO("loaded %1% connections", captured.size());
+
+
+  ReplayStats       stats;
+  Clock::time_point start = Clock::now();
+
+  if (protocol == "tcp") {
+    std::regex  hostAndPortReg{R"(([^:]+):(\d{1,5}))"};
+    std::smatch match;
+    if (std::regex_match(endpoint, match, hostAndPortReg) == false) {
+      LOG_FAILURE("invalid host or port");
+    }
+
+    asio::ip::tcp::endpoint tcpEndpoint{asio::ip::make_address(match[1].str()),
+                                        static_cast<unsigned short>(
+                                            std::stoi(match[2].str()))};
+    replay<asio::ip::tcp>(captured, tcpEndpoint, speed, stats);
+  } else if (protocol == "unix") {
+    replay<asio::local::stream_protocol>(
+        captured,
+        asio::local::stream_protocol::endpoint{endpoint},
+        speed,
+        stats);
+  } else {
+    LOG_FAILURE("unknown protocol: %1%", protocol);
+  }
+
+  printStats(stats,
+             std::chrono::duration_cast<std::chrono::microseconds>(
+                 Clock::now() - start));
+
+  return EXIT_SUCCESS;
+}